@@ -31,11 +31,11 @@ PLUGIN_C_API(bool) plugin_report(Plugin const* context, PluginReportedData* repo
     return true;
 }
 
-PLUGIN_C_API(bool) __cdecl plugin_init(bool firstRun)
+PLUGIN_C_API(bool) plugin_init(bool firstRun)
 {
     printf("PluginControlUI: plugin_init() called\n");
 
-    if (firstRun)
+    if (firstRun && !game->getApplication()->isHeadless()) //Nothing to show without a display
     {
         {
             WindowGUIRenderPipeline* renderer = new WindowGUIRenderPipeline();
@@ -73,11 +73,11 @@ PLUGIN_C_API(bool) __cdecl plugin_init(bool firstRun)
     return true;
 }
 
-PLUGIN_C_API(void) __cdecl plugin_cleanup(bool shutdown)
+PLUGIN_C_API(void) plugin_cleanup(bool shutdown)
 {
     printf("PluginControlUI: plugin_cleanup() called\n");
 
-    if (shutdown)
+    if (shutdown && ctlWindow)
     {
         ctlGuiRoot->removeWidget(ui);
         ui = nullptr;
@@ -50,26 +50,32 @@ bool RectangleCollider::CheckCollision(RectangleCollider const* other) const
 bool RectangleCollider::CheckCollisionAny() const
 {
 	TypedMemoryPool<RectangleCollider>* pool = getEngine()->getApplication()->getMemoryManager()->getSpecificPool<RectangleCollider>(false);
-	for (auto it = ((RawMemoryPool*)pool)->cbegin(); it != ((RawMemoryPool*)pool)->cend(); ++it)
-	{
-		if (*it != this && CheckCollision((RectangleCollider*)*it)) return true;
-	}
-	return false;
+	bool hit = false;
+	pool->foreachLive(
+		[&](void* obj)
+		{
+			RectangleCollider* c = (RectangleCollider*)obj;
+			hit = hit || (c != this && CheckCollision(c)); //Skip remaining checks once we have a hit
+		}
+	);
+	return hit;
 }
 
 int RectangleCollider::GetCollisions(RectangleCollider** outArr) const
 {
 	int nHits = 0;
 	TypedMemoryPool<RectangleCollider>* pool = getEngine()->getApplication()->getMemoryManager()->getSpecificPool<RectangleCollider>(false);
-	for (auto it = pool->cbegin(); it != pool->cend(); ++it)
-	{
-		RectangleCollider* c = (RectangleCollider*)*it;
-
-		if (c != this && CheckCollision(c))
+	pool->foreachLive(
+		[&](void* obj)
 		{
-			if (outArr) outArr[nHits] = c; //Array it optional, only write if it is present
-			++nHits;
+			RectangleCollider* c = (RectangleCollider*)obj;
+
+			if (c != this && CheckCollision(c))
+			{
+				if (outArr) outArr[nHits] = c; //Array it optional, only write if it is present
+				++nHits;
+			}
 		}
-	}
+	);
 	return nHits;
 }
@@ -3,6 +3,7 @@
 #include <glm/glm.hpp>
 
 #include "game/Component.hpp"
+#include "ParallelSafe.hpp"
 
 class ObjectSpinner : public Component, public IUpdatable
 {
@@ -14,3 +15,5 @@ public:
 
 	virtual void Update() override;
 };
+
+template<> struct is_parallel_safe<ObjectSpinner> : std::true_type {}; //Only touches its own Transform, and spun objects are never parented to each other
@@ -57,22 +57,25 @@ PLUGIN_C_API(bool) plugin_init(bool firstRun)
         camera->CreateComponent<PlayerController>(0.01f);
         camera->CreateComponent<ManualObjectRotator>();
 
+        if (!application->isHeadless()) //GPU resources need a GL context, which headless runs don't have
         {
-            //CMesh cmesh("resources/bunny.fbx");
-            CMesh cmesh("resources/dragon.fbx");
-            mesh = new GMesh(cmesh);
-        }
+            {
+                //CMesh cmesh("resources/bunny.fbx");
+                CMesh cmesh("resources/dragon.fbx");
+                mesh = new GMesh(cmesh);
+            }
+
+            shader = new ShaderProgram("resources/shaders/fresnel");
+            shader->load();
 
-        shader = new ShaderProgram("resources/shaders/fresnel");
-        shader->load();
-        
-        material = new Material(shader);
+            material = new Material(shader);
+        }
 
         for (Vector3f pos(-0.5f, -0.5f, -0.4f); pos.y < 0.5f; pos.y += 0.2f) for (pos.x = -0.5f; pos.x < 0.5f; pos.x += 0.2f)
         {
             GameObject* o = application->getGame()->addGameObject();
             o->getTransform()->setPosition(pos);
-            o->CreateComponent<MeshRenderer>(mesh, material);
+            if (mesh) o->CreateComponent<MeshRenderer>(mesh, material);
 
             Vector3f axis;
             axis.x = (float(rand())/RAND_MAX)*2 - 1;
@@ -120,7 +123,7 @@ PLUGIN_C_API(void) plugin_cleanup(bool shutdown)
         application->getGame()->destroy(obstacle);
         application->getGame()->destroy(staticObj);
 
-        delete mesh;
+        delete mesh; //Null if headless
         delete shader;
         delete material;
     }
@@ -12,6 +12,8 @@ if (WIN32)
     set(PLATFORM_DLL_EXTENSION ".dll")
 elseif(EMSCRIPTEN)
     set(PLATFORM_DLL_EXTENSION ".wasm")
+elseif(UNIX)
+    set(PLATFORM_DLL_EXTENSION ".so")
 else()
     message(ERROR " > Could not determine plugin extension: Unknown platform")
 endif()
@@ -19,6 +21,8 @@ add_compile_definitions(PLATFORM_DLL_EXTENSION="${PLATFORM_DLL_EXTENSION}")
 
 if (EMSCRIPTEN)
     add_compile_options("-fPIC") # Emscripten side modules require PIC. Might as well turn it on globally.
+elseif (UNIX)
+    set(CMAKE_POSITION_INDEPENDENT_CODE ON) # Static engine libs get linked into shared ones
 endif()
 
 # Set debug flags
@@ -64,6 +68,10 @@ function(install_dll name dest)
         )
     elseif (EMSCRIPTEN)
         install(FILES "$<TARGET_FILE_DIR:${name}>/${name}.wasm" DESTINATION "${dest}")
+    elseif (UNIX)
+        install(TARGETS "${name}"
+	        LIBRARY DESTINATION "${dest}" COMPONENT Runtime
+        )
     else()
         message(ERROR "Unknown platform, don't know how to install DLL")
     endif()
@@ -13,6 +13,12 @@
 #define API_KEEPALIVE EMSCRIPTEN_KEEPALIVE
 #endif
 
+#if __linux__ && !__EMSCRIPTEN__
+#define API_EXPORT __attribute__((visibility("default")))
+#define API_IMPORT
+#define API_KEEPALIVE
+#endif
+
 #if engine_assets_EXPORTS
 #define ENGINEASSETS_API API_EXPORT API_KEEPALIVE
 #else
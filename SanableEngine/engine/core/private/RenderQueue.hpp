@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+#include "StackAllocator.hpp"
+
+class ShaderProgram;
+class Material;
+
+//Renderables grouped by shader, then by material, in one flat frame-memory array.
+//Sorting the flat array stands in for nested maps, which made several heap allocations every frame.
+template<typename T>
+class RenderQueue
+{
+public:
+	struct Entry
+	{
+		const ShaderProgram* shader;
+		const Material* material;
+		size_t order; //Submission order, so objects stay grouped by type within a material
+		T* object;
+	};
+
+private:
+	Entry* entries;
+	size_t count;
+	size_t capacity;
+
+public:
+	RenderQueue(StackAllocator* frameMemory, size_t capacity) :
+		entries(frameMemory->alloc<Entry>(capacity)),
+		count(0),
+		capacity(capacity)
+	{
+	}
+
+	void push(T* object)
+	{
+		assert(count < capacity);
+		entries[count] = Entry{ object->getShader(), object->getMaterial(), count, object };
+		count++;
+	}
+
+	void sort()
+	{
+		std::sort(entries, entries+count, [](const Entry& a, const Entry& b)
+		{
+			if (a.shader   != b.shader  ) return std::less<const ShaderProgram*>()(a.shader  , b.shader  );
+			if (a.material != b.material) return std::less<const Material*     >()(a.material, b.material);
+			return a.order < b.order;
+		});
+	}
+
+	//Calls onShader at the start of every shader group, onMaterial at the start of every material group, then onObject for each object
+	template<typename TOnShader, typename TOnMaterial, typename TOnObject>
+	void visit(TOnShader onShader, TOnMaterial onMaterial, TOnObject onObject) const
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Entry& e = entries[i];
+			bool newShader = (i == 0 || e.shader != entries[i-1].shader);
+			if (newShader) onShader(e.shader);
+			if (newShader || e.material != entries[i-1].material) onMaterial(e.shader, e.material);
+			onObject(e.material, e.object);
+		}
+	}
+};
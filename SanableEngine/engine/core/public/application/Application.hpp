@@ -2,10 +2,13 @@
 
 #include <vector>
 #include <optional>
+#include <chrono>
 
 #include <ReflectionSpec.hpp>
 #include "MemoryManager.hpp"
-#include "StackAllocator.hpp"
+#include "FrameAllocator.hpp"
+#include "JobSystem.hpp"
+#include "TaskGraph.hpp"
 
 #include "../dllapi.h"
 
@@ -23,18 +26,35 @@ private:
     bool isAlive;
     gpr460::System* system;
     std::optional<MemoryManager> memoryManager; //Optional so we can do late initialization/early destruction
-    StackAllocator frameAllocator; //Temp memory that will be reset every frame
-    constexpr static size_t frameAllocatorSize = 4096;
+    FrameAllocator frameAllocator; //Temp memory that will be reset every frame, separate per thread
+
+    //Heap allocations per frame. See expectZeroHeapAllocs.
+    size_t lastFrameHeapAllocs = 0;
+    bool heapCheckEnabled = false;
+    size_t heapCheckWarmupFrames = 0;
+    size_t heapCheckFailedFrames = 0;
+    void checkHeapAllocs();
+
+    JobSystem jobSystem;
+    TaskGraph frameTasks; //Simulation work for each frame, run on jobSystem between event processing and drawing
     PluginManager pluginManager;
     friend class PluginManager;
 
+    //Per-frame pool defragmentation. See setCompaction.
+    bool compactionEnabled = false;
+    float compactionThreshold = 0.25f;
+    std::chrono::microseconds compactionBudget = std::chrono::microseconds(500);
+    void compactMemory();
+
     GLSettings glSettings;
     std::vector<Window*> windows;
     friend class WindowBuilder;
     friend class Window;
     Window* mainWindow = nullptr;
+    bool headless = false; //No windows, no SDL video. See initHeadless.
 
     void processEvents();
+    void initInternal(Game* game, const GLSettings& glSettings, WindowBuilder* mainWindowBuilder, gpr460::System& system, void (*userInitCallback)(Application*));
 
 public:
     bool quit = false;
@@ -44,6 +64,7 @@ public:
 
     typedef void (*UserInitFunc)(Application*);
     ENGINECORE_API void init(Game* game, const GLSettings& glSettings, WindowBuilder& mainWindowBuilder, gpr460::System& system, UserInitFunc userInitCallback);
+    ENGINECORE_API void initHeadless(Game* game, gpr460::System& system, UserInitFunc userInitCallback); //No main window, and SDL video is never started. For servers, soak tests and batch simulation.
     ENGINECORE_API void shutdown();
 
     ENGINECORE_API void doMainLoop();
@@ -52,9 +73,32 @@ public:
     ENGINECORE_API Game* getGame() const;
     ENGINECORE_API gpr460::System* getSystem();
     ENGINECORE_API MemoryManager* getMemoryManager();
-    ENGINECORE_API StackAllocator* getFrameAllocator();
+    ENGINECORE_API StackAllocator* getFrameAllocator(); //Calling thread's temp memory, freed at start of next frame
+    ENGINECORE_API StackAllocator* getTwoFrameAllocator(); //Calling thread's temp memory, freed at start of frame after next
+    ENGINECORE_API size_t getLastFrameHeapAllocs() const; //Heap allocations made anywhere in the last frameStep, by any thread. Should settle at 0. Only counted if HeapCounter::isAvailable.
+    ENGINECORE_API void expectZeroHeapAllocs(size_t warmupFrames); //After warmupFrames, report every frame that touches heap, and assert in debug builds. For soak tests.
+    ENGINECORE_API size_t getHeapCheckFailedFrames() const; //Frames that touched heap since expectZeroHeapAllocs
+    ENGINECORE_API JobSystem* getJobSystem(); //Shared worker threads, ie. for PoolCallBatcher::parallelMemberCall
+
+    //Tasks run every frame after events are processed, in parallel where dependencies allow. Plugins can add their own (ie. depending
+    //on gameUpdateTaskName to run after Update) and must remove them in plugin_cleanup. Pin anything that touches SDL or GL to the main thread.
+    //Built-in tasks, and what each waits for:
+    ENGINECORE_API TaskGraph* getFrameTasks();
+    static constexpr const char* gameSyncTaskName = "Game::sync"; //Pinned. Adds/removes buffered objects and components, and polls input.
+    static constexpr const char* gameSerialUpdateTaskName = "Game::serialUpdate"; //Pinned, after sync. Update on types that aren't is_parallel_safe.
+    //After serialUpdate, each is_parallel_safe type's Update runs as its own task, named "Game::update/<type>".
+    static constexpr const char* gameUpdateTaskName = "Game::update"; //Waits for every per-type Update. Once done, every Update is.
+    static constexpr const char* gameTransformTaskName = "Game::propagateTransforms"; //After update. Depend on this to read world transforms.
+    static constexpr const char* gameRenderQueueTaskName = "Game::buildRenderQueue"; //After serialUpdate and renderable types' Update. Sorts renderables for drawing. Skipped if headless.
+    static constexpr const char* hudLayoutTaskName = "Application::layoutHUDs"; //No dependencies. WindowRenderPipeline::layout for each window.
+
     ENGINECORE_API PluginManager* getPluginManager();
     ENGINECORE_API Window* getMainWindow();
+    ENGINECORE_API bool isHeadless() const; //Plugins should check this before opening windows
+
+    //Spend up to budget each frame moving pooled objects out of the holes left by destroyed ones, in pools at least threshold (0-1) empty.
+    //Off by default: pointers are fixed in RTTI-visible fields, Game, GameObject, Transform and the main Camera, but NOT anywhere else (ie. plugin globals).
+    ENGINECORE_API void setCompaction(bool enabled, float threshold = 0.25f, std::chrono::microseconds budget = std::chrono::microseconds(500));
 
     ENGINECORE_API WindowBuilder buildWindow(const std::string& name, int width, int height, WindowRenderPipeline* renderPipeline); //Takes ownership of render pipeline
 };
@@ -15,6 +15,11 @@ typedef void* LibHandle;
 #define InvalidLibHandle (nullptr)
 #endif
 
+#if __linux__ && !__EMSCRIPTEN__
+typedef void* LibHandle;
+#define InvalidLibHandle (nullptr)
+#endif
+
 #include <functional>
 #include <filesystem>
 #include <vector>
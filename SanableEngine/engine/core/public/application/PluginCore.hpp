@@ -9,7 +9,11 @@ struct Plugin;
 struct PluginReportedData;
 class Application;
 
+#if __linux__ && !__EMSCRIPTEN__
+#define PLUGIN_C_API_SPEC //Only one C calling convention on 64-bit Linux, and GCC doesn't know __cdecl
+#else
 #define PLUGIN_C_API_SPEC __cdecl
+#endif
 #define PLUGIN_C_API(returnVal) extern "C" API_KEEPALIVE returnVal API_EXPORT PLUGIN_C_API_SPEC
 
 //This file should be included by plugins so they can implement the following functions
@@ -28,8 +28,12 @@ private:
 	friend class WindowInputProcessor;
 	bool closeRequested;
 
+	Rect<float> viewport; //Fixed for the whole frame by beginFrame, so layout can run off the main thread
+
 	Application* engine;
 	friend class Application;
+	void beginFrame(); //Main thread only
+	void layout() const;
 	void draw() const;
 	void handleEvent(SDL_Event& ev);
 
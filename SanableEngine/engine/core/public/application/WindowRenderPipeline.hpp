@@ -16,6 +16,7 @@ public:
 protected:
 	Window* window;
 	ENGINECORE_API virtual void setup(Window* window);
+	ENGINECORE_API virtual void layout(Rect<float> viewport); //Called every frame before render, from a frame graph task on any thread. Mustn't touch GL or SDL.
 	virtual void render(Rect<float> viewport) = 0;
 	friend class Window;
 	friend class WindowBuilder;
@@ -14,6 +14,12 @@
 #define API_KEEPALIVE EMSCRIPTEN_KEEPALIVE
 #endif
 
+#if __linux__ && !__EMSCRIPTEN__
+#define API_EXPORT __attribute__((visibility("default")))
+#define API_IMPORT
+#define API_KEEPALIVE
+#endif
+
 #if engine_core_EXPORTS
 #define ENGINECORE_API API_EXPORT API_KEEPALIVE
 #else
@@ -12,9 +12,12 @@ class Component
 {
 protected:
 	GameObject* gameObject;
+	size_t componentIndex; //Where we are in gameObject->components, so removal doesn't need to search
+	ComponentTypeRegistry::id_t componentTypeId; //Concrete type, set on creation. See GameObject::GetComponent.
 
 	ENGINECORE_API virtual void BindToGameObject(GameObject* obj);
 	friend class GameObject;
+	friend class Game;
 
 	ENGINECORE_API inline Game* getEngine() const { return gameObject->engine; }
 
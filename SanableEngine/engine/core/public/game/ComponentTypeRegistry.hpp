@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include "../dllapi.h"
+#include "TypeName.hpp"
+#include "CacheSlot.hpp"
+
+class MemoryManager;
+
+//Dense ids for concrete component types, plus cached answers to "is concrete type X a T, and where is the T inside it".
+//Lets GameObject::GetComponent compare ids instead of running dynamic_cast on every component.
+//Answers come from RTTI (see TypeInfo::getParent) and are rebuilt on hot reload. Types without RTTI fall back to dynamic_cast.
+class ComponentTypeRegistry
+{
+public:
+	typedef uint32_t id_t;
+
+	//How to get from a Component* to the queried type, for each concrete type
+	struct Query
+	{
+		static constexpr ptrdiff_t noMatch = PTRDIFF_MIN;
+		static constexpr ptrdiff_t unknown = PTRDIFF_MIN+1; //Not enough RTTI, or a virtual base: use dynamic_cast
+
+		TypeName type;
+		std::vector<ptrdiff_t> offsets; //By concrete type id. Byte offset from Component* to queried type*, or noMatch/unknown.
+
+		inline ptrdiff_t getOffset(id_t concrete) const { return concrete < offsets.size() ? offsets[concrete] : unknown; }
+	};
+
+private:
+	std::mutex lock; //Lookups can miss on worker threads
+	uint64_t serial; //Keys cached slots. See CachedIdSlot.
+	uint64_t cachedStateHash;
+
+	std::vector<TypeName> concreteTypes; //By id
+	std::unordered_map<TypeName, id_t> idsByName;
+	std::deque<Query> queries; //Deque so cached pointers stay valid as more are added
+	std::unordered_map<TypeName, Query*> queriesByName;
+	size_t nTypesCovered; //Types registered after this are answered as unknown until next ensureFresh
+
+	ptrdiff_t computeOffset(id_t concrete, const TypeName& queried) const;
+	void rebuild(Query& q) const;
+
+	//Per-type caches for templated lookups, so we can skip building a TypeName. Keyed by serial rather than
+	//address, since a new registry could reuse an old one's. Filled from whichever thread misses first.
+	template<typename T>
+	struct CachedIdSlot
+	{
+		static inline CacheSlot<id_t> slot;
+	};
+	template<typename T>
+	struct CachedQuerySlot
+	{
+		static inline CacheSlot<const Query*> slot;
+	};
+
+public:
+	ENGINECORE_API ComponentTypeRegistry();
+	ENGINECORE_API ~ComponentTypeRegistry();
+
+	ComponentTypeRegistry(const ComponentTypeRegistry&) = delete;
+	ComponentTypeRegistry& operator=(const ComponentTypeRegistry&) = delete;
+
+	ENGINECORE_API id_t getId(const TypeName& concrete); //Registers if new
+	ENGINECORE_API const Query* getQuery(const TypeName& queried); //Built on first use. Stays valid as long as this registry.
+	ENGINECORE_API size_t getTypeCount();
+
+	template<typename T>
+	inline id_t getId()
+	{
+		id_t id;
+		if (CachedIdSlot<T>::slot.get(serial, 0, id)) return id;
+		id = getId(TypeName::create<T>());
+		CachedIdSlot<T>::slot.set(serial, 0, id);
+		return id;
+	}
+
+	template<typename T>
+	inline const Query* getQuery()
+	{
+		const Query* query;
+		if (CachedQuerySlot<T>::slot.get(serial, 0, query)) return query;
+		query = getQuery(TypeName::create<T>());
+		CachedQuerySlot<T>::slot.set(serial, 0, query);
+		return query;
+	}
+
+	//Rebuilds every query if pools or types changed (ie. hot reload), or if new types were registered.
+	//Queries are rebuilt in place, so call at a sync point, when nothing is calling GetComponent.
+	ENGINECORE_API void ensureFresh(MemoryManager* memory, bool force = false);
+};
@@ -1,14 +1,18 @@
 #pragma once
 
 #include <vector>
+#include <string>
+#include <mutex>
 #include "../dllapi.h"
 #include "Component.hpp"
 #include "PoolCallBatcher.hpp"
+#include "ComponentTypeRegistry.hpp"
 
 class Application;
 class PluginManager;
 class GameObject;
 class InputSystem;
+template<typename T> class RenderQueue;
 
 class Game
 {
@@ -17,6 +21,7 @@ class Game
 
     std::vector<GameObject*> objects;
     void applyConcurrencyBuffers();
+    std::mutex objectBufferLock; //Objects and components of types with thread-safe pools can be added and destroyed from worker threads. Guards the buffers below.
     std::vector<GameObject*> objectAddBuffer;
     std::vector<GameObject*> objectDelBuffer;
     std::vector<std::pair<Component*, GameObject*>> componentAddBuffer;
@@ -26,16 +31,32 @@ class Game
 
     PoolCallBatcher<IUpdatable> updateList;
     PoolCallBatcher<I3DRenderable> _3dRenderList;
+    ComponentTypeRegistry componentTypes;
+    RenderQueue<const I3DRenderable>* renderQueue; //In frame memory, so only valid during renderQueueFrame
+    int renderQueueFrame;
 
     void refreshCallBatchers(bool force = false);
+    void remapPointers(const MemoryMapper& remapper); //Follow objects moved by MemoryManager::compact
 
     void destroyImmediate(GameObject* go);
+    void destroyImmediate(std::vector<GameObject*>& gos); //Batched. Reorders and dedupes gos.
     void destroyImmediate(Component* c);
 
     friend class Application;
     void init(Application* application);
     void cleanup();
-    void tick();
+
+    //One frame, split into frame graph tasks. See Application::initInternal for how they depend on each other.
+    void beginTick(); //Main thread only: applies buffered adds/removes (calling Start) and polls input
+    void serialUpdate(); //Main thread only: Update on types that aren't is_parallel_safe
+    void propagateTransforms(); //Brings every world transform up to date, so drawing and later tasks only read them
+    void buildRenderQueue(); //Collects and sorts renderables for this frame's draw. Doesn't touch GL.
+
+    //Update on is_parallel_safe types gets one frame task per pool, so pools overlap each other, and render queue building
+    //only waits for renderable types. Rebuilt whenever updateList is, since that reorders pools.
+    std::vector<std::string> poolUpdateTaskNames;
+    bool poolUpdateTasksDirty = true;
+    void refreshPoolUpdateTasks();
 
     bool isAlive;
 public:
@@ -46,7 +67,10 @@ public:
 
 	ENGINECORE_API InputSystem* getInput();
 	ENGINECORE_API const PoolCallBatcher<I3DRenderable>* get3DRenderables() const;
+    ENGINECORE_API const RenderQueue<const I3DRenderable>* getRenderQueue(); //This frame's renderables, sorted for drawing. Built now if the frame graph didn't.
+	ENGINECORE_API ComponentTypeRegistry* getComponentTypes();
 
+    //From worker threads only if GameObject's pool was made thread-safe first (ie. by a plugin at init). Goes live at the next sync point.
     ENGINECORE_API GameObject* addGameObject();
     ENGINECORE_API void destroy(GameObject* go);
 
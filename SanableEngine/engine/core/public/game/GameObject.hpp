@@ -8,6 +8,7 @@
 #include "MemoryManager.hpp"
 #include "application/Application.hpp"
 #include "Transform.hpp"
+#include "ComponentTypeRegistry.hpp"
 
 class ModuleTypeRegistry;
 class Component;
@@ -18,7 +19,10 @@ class GameObject
 protected:
     Transform transform;
 
-    std::vector<Component*> components;
+    std::vector<Component*> components; //Unordered: removal swaps the last one into the hole. See Component::componentIndex.
+    std::vector<ComponentTypeRegistry::id_t> componentTypes; //Parallel to components: concrete type of each, so lookups don't touch the components themselves
+    size_t gameIndex = invalidIndex; //Where we are in Game::objects, so removal doesn't need to search. Invalid until added.
+    static constexpr size_t invalidIndex = ~size_t(0);
     friend class Game;
     friend class Component;
 
@@ -26,6 +30,20 @@ protected:
 
     void BindComponent(Component* c);
     void InvokeStart();
+    void remapPointers(const MemoryMapper& remapper); //Called by Game after pooled memory was compacted
+    ENGINECORE_API ComponentTypeRegistry* getComponentTypes() const;
+    ENGINECORE_API MemoryManager* getMemoryManager() const; //Out of line, since Game isn't complete here
+    ENGINECORE_API void queueBindComponent(Component* c); //Thread-safe. Bound and started at the next sync point.
+
+    //Returns null if component i isn't a T
+    template<typename T>
+    inline T* castComponent(size_t i, const ComponentTypeRegistry::Query* query) const
+    {
+        ptrdiff_t offset = query->getOffset(componentTypes[i]);
+        if (offset == ComponentTypeRegistry::Query::noMatch) return nullptr;
+        if (offset == ComponentTypeRegistry::Query::unknown) return dynamic_cast<T*>(components[i]);
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(components[i]) + offset);
+    }
 
 public:
     GameObject(Game* engine);
@@ -40,16 +58,58 @@ public:
     {
         T* component;
         assert((component = GetComponent<T>()) == nullptr);
-        component = engine->getApplication()->getMemoryManager()->create<T>(ctorArgs...);
-        engine->componentAddBuffer.push_back(std::pair<Component*, GameObject*>(component, this));
+        //Worker threads may only add components marked is_spawned_concurrently. Either way, the new one is bound and started at the next sync point.
+        getMemoryManager()->createPool<T>(RawMemoryPool::StorageMode::Paged); //Growable, since a type's first component is usually far from its last
+        component = getMemoryManager()->create<T>(ctorArgs...);
+        component->componentTypeId = getComponentTypes()->getId<T>();
+        queueBindComponent(component);
         return component;
     }
 
     template<typename T>
     inline T* GetComponent()
     {
-        T* out = nullptr;
-        for (Component* c : components) if (( out = dynamic_cast<T*>(c) )) return out;
+        const ComponentTypeRegistry::Query* query = getComponentTypes()->getQuery<T>();
+        for (size_t i = 0; i < components.size(); ++i) if (T* out = castComponent<T>(i, query)) return out;
         return nullptr;
     }
+
+    //Every attached component that is a T. Iterate with range-for. Doesn't allocate.
+    template<typename T>
+    class ComponentView
+    {
+        const GameObject* owner;
+        const ComponentTypeRegistry::Query* query;
+        friend class GameObject;
+        ComponentView(const GameObject* owner, const ComponentTypeRegistry::Query* query) : owner(owner), query(query) {}
+
+    public:
+        class iterator
+        {
+            const ComponentView* view;
+            size_t index;
+            T* current;
+            friend class ComponentView;
+            iterator(const ComponentView* view, size_t index) : view(view), index(index), current(nullptr) { seek(); }
+            void seek()
+            {
+                for (; index < view->owner->components.size(); ++index) if (( current = view->owner->template castComponent<T>(index, view->query) )) return;
+                current = nullptr;
+            }
+        public:
+            inline T* operator*() const { return current; }
+            inline iterator& operator++() { ++index; seek(); return *this; }
+            inline bool operator!=(const iterator& other) const { return index != other.index; }
+            inline bool operator==(const iterator& other) const { return index == other.index; }
+        };
+
+        inline iterator begin() const { return iterator(this, 0); }
+        inline iterator end() const { return iterator(this, owner->components.size()); }
+    };
+
+    template<typename T>
+    inline ComponentView<T> GetComponents()
+    {
+        return ComponentView<T>(this, getComponentTypes()->getQuery<T>());
+    }
 };
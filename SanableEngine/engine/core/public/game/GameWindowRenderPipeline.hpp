@@ -17,5 +17,6 @@ public:
 
 protected:
 	ENGINECORE_API virtual void setup(Window* window) override;
+	ENGINECORE_API virtual void layout(Rect<float> viewport) override;
 	ENGINECORE_API virtual void render(Rect<float> viewport) override;
 };
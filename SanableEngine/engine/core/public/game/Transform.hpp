@@ -8,6 +8,7 @@
 #include "math/Vector3.inl"
 
 class ModuleTypeRegistry;
+class MemoryMapper;
 
 class Transform
 {
@@ -31,6 +32,15 @@ private:
 	void ensureUpToDate() const;
 	mutable Data global; //Cached
 
+	//Refresh self and everything below, top-down, so children of moved parents aren't left stale. Afterwards, reads are
+	//safe from any thread until something moves again. Done once per frame by Game's transform propagation task.
+	friend class Game;
+	void propagate(bool parentChanged = false) const;
+
+	//Follow parent/children after pooled memory was compacted
+	friend class GameObject;
+	void remapPointers(const MemoryMapper& remapper);
+
 public:
 	Transform();
 	~Transform();
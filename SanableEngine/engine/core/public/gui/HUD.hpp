@@ -5,6 +5,7 @@
 #include "CallBatcher.inl"
 #include "Widget.hpp"
 #include "MemoryManager.hpp"
+#include "StackAllocator.hpp"
 
 class HUD
 {
@@ -30,7 +31,7 @@ public:
 	ENGINEGUI_API void tick();
 	ENGINEGUI_API void render(Rect<float> viewport, Renderer* renderer);
 
-	ENGINEGUI_API void raycast(Vector2f pos, const std::function<void(Widget*)>& visitor) const;
+	ENGINEGUI_API void raycast(Vector2f pos, StackAllocator* scratch, const std::function<void(Widget*)>& visitor) const; //Front to back
 
 	ENGINEGUI_API WidgetTransform const* getRootTransform() const;
 	ENGINEGUI_API WidgetTransform* getRootTransform();
@@ -8,6 +8,7 @@
 #include "math/Rect.inl"
 
 struct WidgetTransform;
+class StackAllocator;
 
 namespace LayoutUtil
 {
@@ -21,14 +22,16 @@ namespace LayoutUtil
 	
 	namespace Stretch
 	{
-		//Writes to WidgetTransforms
+		//Writes to WidgetTransforms. Never allocates.
 		ENGINEGUI_API void vertical  (UIRect container, const std::vector<std::pair<WidgetTransform*, float>>& widgets, Padding padding);
 		ENGINEGUI_API void horizontal(UIRect container, const std::vector<std::pair<WidgetTransform*, float>>& widgets, Padding padding);
 
-		ENGINEGUI_API std::vector<UIRect> vertical  (UIRect container, const std::vector<float>& weights);
-		ENGINEGUI_API std::vector<UIRect> horizontal(UIRect container, const std::vector<float>& weights);
+		//Writes count rects to out. Never allocates.
+		ENGINEGUI_API void vertical  (UIRect container, const float* weights, size_t count, Padding padding, UIRect* out);
+		ENGINEGUI_API void horizontal(UIRect container, const float* weights, size_t count, Padding padding, UIRect* out);
 
-		ENGINEGUI_API std::vector<UIRect> vertical  (UIRect container, const std::vector<float>& weights, Padding padding);
-		ENGINEGUI_API std::vector<UIRect> horizontal(UIRect container, const std::vector<float>& weights, Padding padding);
+		//Returns count rects allocated from arena, ie. Application::getFrameAllocator
+		ENGINEGUI_API UIRect* vertical  (UIRect container, const float* weights, size_t count, Padding padding, StackAllocator* arena);
+		ENGINEGUI_API UIRect* horizontal(UIRect container, const float* weights, size_t count, Padding padding, StackAllocator* arena);
 	}
 }
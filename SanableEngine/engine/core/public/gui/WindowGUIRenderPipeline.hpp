@@ -16,5 +16,6 @@ public:
 	float zNear = 0;
 	float zFar = 1000;
 
+	ENGINECORE_API virtual void layout(Rect<float> viewport) override;
 	ENGINECORE_API virtual void render(Rect<float> viewport) override;
 };
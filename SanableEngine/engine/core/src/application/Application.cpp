@@ -6,6 +6,7 @@
 #include <SDL.h>
 
 #include "System.hpp"
+#include "HeapCounter.hpp"
 #include "GlobalTypeRegistry.hpp"
 #include "application/Window.hpp"
 #include "game/Game.hpp"
@@ -73,14 +74,24 @@ Application::~Application()
 
 void engine_reportTypes(ModuleTypeRegistry* registry);
 
-void Application::init(Game* game, const GLSettings& glSettings, WindowBuilder& mainWindowBuilder, gpr460::System& _system, UserInitFunc userInitCallback)
+void Application::init(Game* game, const GLSettings& glSettings, WindowBuilder& mainWindowBuilder, gpr460::System& system, UserInitFunc userInitCallback)
+{
+    headless = false;
+    initInternal(game, glSettings, &mainWindowBuilder, system, userInitCallback);
+}
+
+void Application::initHeadless(Game* game, gpr460::System& system, UserInitFunc userInitCallback)
+{
+    headless = true;
+    initInternal(game, GLSettings(), nullptr, system, userInitCallback);
+}
+
+void Application::initInternal(Game* game, const GLSettings& glSettings, WindowBuilder* mainWindowBuilder, gpr460::System& _system, UserInitFunc userInitCallback)
 {
     assert(!isAlive);
     isAlive = true;
     quit = false;
 
-    frameAllocator.resize(frameAllocatorSize);
-
     this->system = &_system;
     system->Init(this);
 
@@ -92,16 +103,30 @@ void Application::init(Game* game, const GLSettings& glSettings, WindowBuilder&
     }
 
     memoryManager.emplace();
-    memoryManager.value().getSpecificPool<GameObject>(true); //Force create GameObject pool now so it's owned by main module (avoiding nasty access violation errors)
-    memoryManager.value().getSpecificPool<Camera>(true); //Same with Camera
-    memoryManager.value().getSpecificPool<MeshRenderer>(true); //And MeshRenderer
+    memoryManager.value().loadCapacityProfile(system->GetBaseDir()/"pool_profile.txt"); //Pre-size pools to last session's peaks, so loading doesn't pay for growth
+    //Force create pools now so they're owned by main module (avoiding nasty access violation errors)
+    memoryManager.value().createPool<GameObject>(RawMemoryPool::StorageMode::Reserved, true); //Hot, so back with huge pages where possible
+    memoryManager.value().createPool<Camera>(RawMemoryPool::StorageMode::Paged);
+    memoryManager.value().createPool<MeshRenderer>(RawMemoryPool::StorageMode::Reserved, true);
     memoryManager.value().ensureFresh();
 
     this->game = game;
     game->init(this);
 
+    //Start() and non-parallel-safe Update code expect the main thread. The rest runs wherever there's room.
+    //Each task only waits for what it reads. Game adds one Update task per parallel-safe pool between serialUpdate and
+    //the update join, and makes the render queue wait for the ones that are also renderable (see Game::refreshPoolUpdateTasks).
+    TaskGraph::id_t syncTask = frameTasks.add(gameSyncTaskName, [this]() { this->game->beginTick(); });
+    TaskGraph::id_t serialUpdateTask = frameTasks.add(gameSerialUpdateTaskName, [this]() { this->game->serialUpdate(); }, { syncTask });
+    TaskGraph::id_t updateTask = frameTasks.add(gameUpdateTaskName, []() {}, { serialUpdateTask });
+    frameTasks.add(gameTransformTaskName, [this]() { this->game->propagateTransforms(); }, { updateTask });
+    frameTasks.add(gameRenderQueueTaskName, [this]() { if (!this->headless) this->game->buildRenderQueue(); }, { serialUpdateTask });
+    frameTasks.add(hudLayoutTaskName, [this]() { for (Window* w : this->windows) w->layout(); }); //Widgets are only edited outside the frame graph
+    frameTasks.setCallingThreadOnly(syncTask, true);
+    frameTasks.setCallingThreadOnly(serialUpdateTask, true);
+
     this->glSettings = glSettings;
-    mainWindow = mainWindowBuilder.build();
+    if (mainWindowBuilder) mainWindow = mainWindowBuilder->build();
 
     pluginManager.discoverAll(system->GetBaseDir()/"plugins");
     std::cout << "Discovered " << pluginManager.plugins.size() << " plugins" << std::endl;
@@ -121,6 +146,7 @@ void Application::shutdown()
 
     game->applyConcurrencyBuffers();
     pluginManager.unhookAll(true); //FIXME: Pools destroyed automatically here, but Component and GameObject need to interface with Game
+    frameTasks.clear(); //Anything plugins forgot to remove would point into unloaded code
     game->applyConcurrencyBuffers();
     game->cleanup();
     game->applyConcurrencyBuffers();
@@ -130,12 +156,14 @@ void Application::shutdown()
     mainWindow = nullptr;
     
     memoryManager.value().destroyPool<GameObject>(); //Clean up memory, GameObject pool first so remaining components are released
+    memoryManager.value().getArchetypes()->clear(); //Component dtors may live in plugin code
     pluginManager.unloadAll(); //Unload plugin code, handling destructors of globals in module
 
     //RTTI and plugin info shouldn't appear on the leaks report
     GlobalTypeRegistry::clear();
     pluginManager.forgetAll();
 
+    memoryManager.value().saveCapacityProfile(system->GetBaseDir()/"pool_profile.txt"); //Every pool's peak, including ones already destroyed
     memoryManager.reset(); //Finish cleaning up memory
     system->Shutdown();
 }
@@ -148,17 +176,69 @@ void Application::doMainLoop()
 void Application::frameStep(void* arg)
 {
     Application* engine = (Application*)arg;
+    size_t heapAllocsBefore = HeapCounter::getAllocCount();
 
-    engine->frameAllocator.restoreCheckpoint(StackAllocator::Checkpoint());
+    engine->frameAllocator.beginFrame();
 
     engine->game->refreshCallBatchers(false);
-    engine->processEvents();
+    if (!engine->headless) engine->processEvents(); //SDL video was never started
+    for (Window* w : engine->windows) w->beginFrame();
     engine->game->refreshCallBatchers(false);
-    engine->game->tick();
+    engine->frameTasks.run(&engine->jobSystem);
     engine->game->refreshCallBatchers(false);
     for (Window* w : engine->windows) w->draw();
 
     if (engine->pluginManager.executeCommandBuffer() != 0) engine->memoryManager.value().ensureFresh();
+
+    if (engine->compactionEnabled) engine->compactMemory();
+
+    engine->lastFrameHeapAllocs = HeapCounter::getAllocCount() - heapAllocsBefore;
+    if (engine->heapCheckEnabled) engine->checkHeapAllocs();
+}
+
+void Application::checkHeapAllocs()
+{
+    if (heapCheckWarmupFrames > 0)
+    {
+        --heapCheckWarmupFrames;
+        return;
+    }
+
+    if (lastFrameHeapAllocs == 0) return;
+    ++heapCheckFailedFrames;
+    std::cerr << "Warm frame made " << lastFrameHeapAllocs << " heap allocations" << std::endl;
+    assert(false && "Warm frame touched heap. Use the frame allocator or grow buffers during warmup instead.");
+}
+
+void Application::expectZeroHeapAllocs(size_t warmupFrames)
+{
+    heapCheckEnabled = HeapCounter::isAvailable();
+    heapCheckWarmupFrames = warmupFrames;
+    heapCheckFailedFrames = 0;
+    if (!heapCheckEnabled) std::cerr << "Heap allocation check requested, but HeapCounter isn't available in this build" << std::endl;
+}
+
+size_t Application::getHeapCheckFailedFrames() const
+{
+    return heapCheckFailedFrames;
+}
+
+void Application::compactMemory()
+{
+    MemoryMapper remapper;
+    memoryManager.value().compact(compactionThreshold, compactionBudget, &remapper);
+    if (remapper.isEmpty()) return;
+
+    //Fix what RTTI can't see
+    game->remapPointers(remapper);
+    if (Camera* mainCamera = Camera::getMain()) remapper.transformAddress(mainCamera)->setMain();
+}
+
+void Application::setCompaction(bool enabled, float threshold, std::chrono::microseconds budget)
+{
+    compactionEnabled = enabled;
+    compactionThreshold = threshold;
+    compactionBudget = budget;
 }
 
 Game* Application::getGame() const
@@ -178,7 +258,27 @@ MemoryManager* Application::getMemoryManager()
 
 StackAllocator* Application::getFrameAllocator()
 {
-    return &frameAllocator;
+    return frameAllocator.thisFrame();
+}
+
+StackAllocator* Application::getTwoFrameAllocator()
+{
+    return frameAllocator.untilNextFrame();
+}
+
+JobSystem* Application::getJobSystem()
+{
+    return &jobSystem;
+}
+
+size_t Application::getLastFrameHeapAllocs() const
+{
+    return lastFrameHeapAllocs;
+}
+
+TaskGraph* Application::getFrameTasks()
+{
+    return &frameTasks;
 }
 
 PluginManager* Application::getPluginManager()
@@ -191,6 +291,11 @@ Window* Application::getMainWindow()
     return !windows.empty() ? windows[0] : nullptr; //FIXME hacky
 }
 
+bool Application::isHeadless() const
+{
+    return headless;
+}
+
 WindowBuilder Application::buildWindow(const std::string& name, int width, int height, WindowRenderPipeline* renderPipeline)
 {
     return WindowBuilder(this, name, width, height, glSettings, renderPipeline);
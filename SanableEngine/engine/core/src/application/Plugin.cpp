@@ -5,7 +5,7 @@
 #include "GlobalTypeRegistry.hpp"
 #include "MemoryManager.hpp"
 
-#if __EMSCRIPTEN__
+#if __EMSCRIPTEN__ || __linux__
 #include <dlfcn.h>
 #endif
 
@@ -42,7 +42,7 @@ void* Plugin::getSymbol(const char* name) const
 #ifdef _WIN32
 	return reinterpret_cast<void*>(GetProcAddress(dll, name));
 #endif
-#ifdef __EMSCRIPTEN__
+#if __EMSCRIPTEN__ || __linux__
 	return dlsym(dll, name);
 #endif
 }
@@ -71,7 +71,7 @@ bool Plugin::load(Application const* context)
 #ifdef _WIN32
 	dll = LoadLibraryW(path.c_str());
 #endif
-#ifdef __EMSCRIPTEN__
+#if __EMSCRIPTEN__ || __linux__
 	dll = dlopen(path.c_str(), RTLD_LAZY);
 #endif
 
@@ -82,7 +82,7 @@ bool Plugin::load(Application const* context)
 		DWORD err = GetLastError();
 		printf_s("Error: Code %u\n", err);
 #endif
-#ifdef __EMSCRIPTEN__
+#if __EMSCRIPTEN__ || __linux__
 		printf("Error: %s\n", dlerror());
 #endif
 		return false;
@@ -185,7 +185,7 @@ void Plugin::unload(Application* context)
 	BOOL success = FreeLibrary(dll);
 	assert(success);
 #endif
-#ifdef __EMSCRIPTEN__
+#if __EMSCRIPTEN__ || __linux__
 	int failure = dlclose(dll);
 	assert(!failure);
 #endif
@@ -13,7 +13,8 @@ Window::Window(const std::string& name, int width, int height, const GLSettings&
     renderPipeline(renderPipeline),
     inputProcessor(inputProcessor),
     engine(engine),
-    closeRequested(false)
+    closeRequested(false),
+    viewport({ Vector2f(0,0), Vector2f(width, height) })
 {
     SDL_InitSubSystem(SDL_INIT_VIDEO); //Internally refcounted, no checks necessary
 
@@ -76,16 +77,26 @@ bool Window::wasCloseRequested() const
     return closeRequested;
 }
 
+void Window::beginFrame()
+{
+    int width, height;
+    SDL_GetWindowSize(handle, &width, &height);
+    viewport = { Vector2f(0,0), Vector2f(width, height) };
+}
+
+void Window::layout() const
+{
+    if (renderPipeline) renderPipeline->layout(viewport);
+}
+
 void Window::draw() const
 {
     //Reset to default state
     setActiveDrawTarget(this);
-    int width, height;
-    SDL_GetWindowSize(handle, &width, &height);
-    glViewport(0, 0, width, height);
+    glViewport(0, 0, (int)viewport.size.x, (int)viewport.size.y);
 
     //Delegate draw
-    if (renderPipeline) renderPipeline->render({ Vector2f(0,0), Vector2f(width, height) });
+    if (renderPipeline) renderPipeline->render(viewport);
 
     //Swap back buffer
     SDL_GL_SwapWindow(handle);
@@ -13,3 +13,7 @@ void WindowRenderPipeline::setup(Window* window)
 {
 	this->window = window;
 }
+
+void WindowRenderPipeline::layout(Rect<float> viewport)
+{
+}
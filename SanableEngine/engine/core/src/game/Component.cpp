@@ -13,7 +13,9 @@ void Component::BindToGameObject(GameObject* obj)
 }
 
 Component::Component() :
-	gameObject(nullptr)
+	gameObject(nullptr),
+	componentIndex(GameObject::invalidIndex),
+	componentTypeId(~ComponentTypeRegistry::id_t(0)) //Not a real id, so lookups fall back to dynamic_cast until CreateComponent sets it
 {
 }
 
@@ -0,0 +1,99 @@
+#include "game/ComponentTypeRegistry.hpp"
+
+#include <atomic>
+#include <optional>
+
+#include "GlobalTypeRegistry.hpp"
+#include "MemoryManager.hpp"
+#include "game/Component.hpp"
+
+static std::atomic<uint64_t> nextSerial = 1;
+
+ComponentTypeRegistry::ComponentTypeRegistry() :
+	serial(nextSerial++),
+	cachedStateHash(0),
+	nTypesCovered(0)
+{
+}
+
+ComponentTypeRegistry::~ComponentTypeRegistry()
+{
+}
+
+ComponentTypeRegistry::id_t ComponentTypeRegistry::getId(const TypeName& concrete)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	auto it = idsByName.find(concrete);
+	if (it != idsByName.end()) return it->second;
+
+	id_t id = (id_t)concreteTypes.size();
+	concreteTypes.push_back(concrete);
+	idsByName.emplace(concrete, id);
+	return id;
+}
+
+const ComponentTypeRegistry::Query* ComponentTypeRegistry::getQuery(const TypeName& queried)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	auto it = queriesByName.find(queried);
+	if (it != queriesByName.end()) return it->second;
+
+	Query& q = queries.emplace_back();
+	q.type = queried;
+	rebuild(q);
+	queriesByName.emplace(queried, &q);
+	return &q;
+}
+
+size_t ComponentTypeRegistry::getTypeCount()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return concreteTypes.size();
+}
+
+ptrdiff_t ComponentTypeRegistry::computeOffset(id_t concrete, const TypeName& queried) const
+{
+	const TypeInfo* type = GlobalTypeRegistry::lookupType(concreteTypes[concrete]);
+	if (!type) return Query::unknown;
+
+	//Where a base lives inside the concrete type. Virtual bases can move around, so leave those to dynamic_cast.
+	auto findBase = [&](const TypeName& base) -> std::optional<ptrdiff_t>
+	{
+		if (base == type->name) return 0;
+		std::optional<ParentInfo> p = type->getParent(base, MemberVisibility::All);
+		if (!p.has_value()) return std::nullopt;
+		if (p.value().virtualness != ParentInfo::Virtualness::NonVirtual) return Query::unknown;
+		return p.value().offset;
+	};
+
+	std::optional<ptrdiff_t> component = findBase(TypeName::create<Component>());
+	if (!component.has_value() || component.value() == Query::unknown) return Query::unknown; //RTTI doesn't know it's a Component, so can't be trusted
+
+	//Only a definite no if we could see every ancestor. Otherwise the queried type might be behind one we can't.
+	std::optional<ptrdiff_t> target = findBase(queried);
+	if (!target.has_value()) return type->isParentChainResolved() ? Query::noMatch : Query::unknown;
+	if (target.value() == Query::unknown) return Query::unknown;
+	return target.value() - component.value();
+}
+
+void ComponentTypeRegistry::rebuild(Query& q) const
+{
+	q.offsets.resize(concreteTypes.size());
+	for (id_t i = 0; i < concreteTypes.size(); ++i) q.offsets[i] = computeOffset(i, q.type);
+}
+
+void ComponentTypeRegistry::ensureFresh(MemoryManager* memory, bool force)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	//Hot reloads refresh pools, which changes the state hash
+	uint64_t newHash = memory->getPoolStateHash();
+	if (force || cachedStateHash != newHash || nTypesCovered != concreteTypes.size())
+	{
+		cachedStateHash = newHash;
+		nTypesCovered = concreteTypes.size();
+		for (Query& q : queries) rebuild(q);
+	}
+}
@@ -1,17 +1,23 @@
 #include "game/Game.hpp"
 
 #include <cassert>
+#include <algorithm>
+#include <new>
 
 #include "game/GameObject.hpp"
 #include "game/Component.hpp"
 #include "game/InputSystem.hpp"
+#include "application/Application.hpp"
+#include "RenderQueue.hpp"
 
 Game::Game() :
     application(nullptr),
     inputSystem(nullptr),
     isAlive(false),
     updateList(),
-    _3dRenderList()
+    _3dRenderList(),
+    renderQueue(nullptr),
+    renderQueueFrame(-1)
 {
 }
 
@@ -27,6 +33,7 @@ void Game::init(Application* application)
 
     this->application = application;
     frame = 0;
+    poolUpdateTasksDirty = true;
 
     this->inputSystem = new InputSystem();
 }
@@ -47,20 +54,26 @@ void Game::cleanup()
     componentDelBuffer.clear(); componentDelBuffer.shrink_to_fit();
     objectAddBuffer   .clear(); objectAddBuffer   .shrink_to_fit();
     objectDelBuffer   .clear(); objectDelBuffer   .shrink_to_fit();
+    poolUpdateTaskNames.clear(); poolUpdateTaskNames.shrink_to_fit(); //Tasks themselves were already cleared by Application
     
     delete inputSystem;
 }
 
 void Game::applyConcurrencyBuffers()
 {
+    //Objects allocated or released from other threads only take effect here
+    application->getMemoryManager()->flushDeferred();
+
     for (Component* c : componentDelBuffer) destroyImmediate(c);
     componentDelBuffer.clear();
 
-    for (GameObject* go : objectDelBuffer) destroyImmediate(go);
+    destroyImmediate(objectDelBuffer);
     objectDelBuffer.clear();
+    application->getMemoryManager()->flushDeferred(); //Releases are deferred too, so make them happen now
 
     for (GameObject* go : objectAddBuffer)
     {
+        go->gameIndex = objects.size();
         objects.push_back(go);
         go->InvokeStart();
     }
@@ -73,40 +86,115 @@ void Game::applyConcurrencyBuffers()
 
 void Game::refreshCallBatchers(bool force)
 {
-    updateList   .ensureFresh(application->getMemoryManager(), force);
-    _3dRenderList.ensureFresh(application->getMemoryManager(), force);
+    if (updateList   .ensureFresh(application->getMemoryManager(), force)) poolUpdateTasksDirty = true;
+    if (_3dRenderList.ensureFresh(application->getMemoryManager(), force)) poolUpdateTasksDirty = true;
+    componentTypes.ensureFresh(application->getMemoryManager(), force);
+    if (poolUpdateTasksDirty) refreshPoolUpdateTasks();
+}
+
+void Game::refreshPoolUpdateTasks()
+{
+    TaskGraph* tasks = application->getFrameTasks();
+    TaskGraph::id_t serialUpdateTask = tasks->find(Application::gameSerialUpdateTaskName);
+    TaskGraph::id_t updateTask       = tasks->find(Application::gameUpdateTaskName);
+    TaskGraph::id_t renderQueueTask  = tasks->find(Application::gameRenderQueueTaskName);
+    if (serialUpdateTask == TaskGraph::npos || updateTask == TaskGraph::npos || renderQueueTask == TaskGraph::npos) return; //Frame graph isn't built yet
+
+    //Found by name, since indices may have been recycled if the graph was cleared
+    for (const std::string& name : poolUpdateTaskNames)
+    {
+        TaskGraph::id_t id = tasks->find(name);
+        if (id != TaskGraph::npos) tasks->remove(id);
+    }
+    poolUpdateTaskNames.clear();
+
+    for (size_t i = 0; i < updateList.count(); ++i)
+    {
+        const GenericTypedMemoryPool* pool = updateList.getPool(i);
+        if (!pool->isParallelSafe()) continue; //Covered by serialUpdate
+
+        //Serial Update code may touch any object, so it goes first. Parallel-safe Update only touches its own object, so pools are siblings.
+        std::string name = std::string(Application::gameUpdateTaskName) + "/" + pool->getContentsType()->name.as_str();
+        TaskGraph::id_t id = tasks->add(name, [this, i]() { updateList.poolMemberCall(application->getJobSystem(), i, &IUpdatable::Update); }, { serialUpdateTask });
+        tasks->addDependency(updateTask, id);
+        if (_3dRenderList.contains(pool)) tasks->addDependency(renderQueueTask, id); //Might change its own material
+        poolUpdateTaskNames.push_back(name);
+    }
+
+    poolUpdateTasksDirty = false;
+}
+
+void Game::remapPointers(const MemoryMapper& remapper)
+{
+    //Call batchers only hold pools, which don't move, so they can be left alone
+    for (GameObject*& go : objects        ) go = remapper.transformAddress(go);
+    for (GameObject*& go : objectAddBuffer) go = remapper.transformAddress(go);
+    for (GameObject*& go : objectDelBuffer) go = remapper.transformAddress(go);
+    for (auto& i : componentAddBuffer)
+    {
+        i.first  = remapper.transformAddress(i.first );
+        i.second = remapper.transformAddress(i.second);
+    }
+    for (Component*& c : componentDelBuffer) c = remapper.transformAddress(c);
+
+    //Objects fix their own internal links. Pending objects aren't in the list yet, but can already have children and components.
+    for (GameObject* go : objects        ) go->remapPointers(remapper);
+    for (GameObject* go : objectAddBuffer) go->remapPointers(remapper);
 }
 
 GameObject* Game::addGameObject()
 {
     GameObject* o = application->getMemoryManager()->create<GameObject>(this);
+    std::lock_guard<std::mutex> guard(objectBufferLock);
     objectAddBuffer.push_back(o);
     return o;
 }
 
 void Game::destroy(GameObject* go)
 {
+    std::lock_guard<std::mutex> guard(objectBufferLock);
     objectDelBuffer.push_back(go);
 }
 
 void Game::destroyImmediate(GameObject* go)
 {
-    assert(std::find(objects.cbegin(), objects.cend(), go) != objects.cend());
-    objects.erase(std::find(objects.begin(), objects.end(), go));
+    //Swap and pop
+    size_t i = go->gameIndex;
+    assert(i < objects.size() && objects[i] == go);
+    objects[i] = objects.back();
+    objects[i]->gameIndex = i;
+    objects.pop_back();
+
     application->getMemoryManager()->destroy(go);
 }
 
+void Game::destroyImmediate(std::vector<GameObject*>& gos)
+{
+    //Back to front, so each swap-and-pop only pulls in objects that are staying. Mass despawns (and cleanup) become a series of plain pops.
+    std::sort(gos.begin(), gos.end(), [](GameObject* a, GameObject* b) { return a->gameIndex > b->gameIndex; });
+    gos.erase(std::unique(gos.begin(), gos.end()), gos.end()); //Destroying twice in one frame is harmless
+    for (GameObject* go : gos) destroyImmediate(go);
+}
+
 void Game::destroyImmediate(Component* c)
 {
-    assert(std::find(objects.cbegin(), objects.cend(), c->getGameObject()) != objects.cend());
-    auto& l = c->getGameObject()->components;
-    auto it = std::find(l.cbegin(), l.cend(), c);
-    assert(it != l.cend());
-    l.erase(it);
+    GameObject* go = c->getGameObject();
+    assert(go->gameIndex < objects.size() && objects[go->gameIndex] == go);
+
+    //Swap and pop
+    auto& l = go->components;
+    size_t i = c->componentIndex;
+    assert(i < l.size() && l[i] == c);
+    l[i] = l.back();
+    l[i]->componentIndex = i;
+    l.pop_back();
+    go->componentTypes[i] = go->componentTypes.back();
+    go->componentTypes.pop_back();
+
     application->getMemoryManager()->destroy(c);
 }
 
-void Game::tick()
+void Game::beginTick()
 {
     assert(isAlive);
 
@@ -114,7 +202,37 @@ void Game::tick()
 
     applyConcurrencyBuffers();
     inputSystem->onTick();
-    updateList.memberCall(&IUpdatable::Update);
+}
+
+void Game::serialUpdate()
+{
+    updateList.serialMemberCall(&IUpdatable::Update);
+}
+
+void Game::propagateTransforms()
+{
+    //From each root, so parents are always done before their children
+    for (GameObject* go : objects) if (!go->getTransform()->getParent()) go->getTransform()->propagate();
+}
+
+void Game::buildRenderQueue()
+{
+    //Counted first so the queue can come from frame memory in one piece
+    StackAllocator* frameMemory = application->getFrameAllocator();
+    size_t nRenderables = 0;
+    _3dRenderList.staticCall([&](const I3DRenderable*) { nRenderables++; });
+    RenderQueue<const I3DRenderable>* queue = new (frameMemory->alloc<RenderQueue<const I3DRenderable>>()) RenderQueue<const I3DRenderable>(frameMemory, nRenderables);
+    _3dRenderList.staticCall([&](const I3DRenderable* r) { queue->push(r); }); //Note: No need for a CallBatcher here, we're guaranteed renderables will be grouped by type since our data source is a CallBatcher
+    queue->sort();
+
+    renderQueue = queue;
+    renderQueueFrame = frame;
+}
+
+const RenderQueue<const I3DRenderable>* Game::getRenderQueue()
+{
+    if (renderQueueFrame != frame) buildRenderQueue();
+    return renderQueue;
 }
 
 InputSystem* Game::getInput()
@@ -126,3 +244,8 @@ const PoolCallBatcher<I3DRenderable>* Game::get3DRenderables() const
 {
     return &_3dRenderList;
 }
+
+ComponentTypeRegistry* Game::getComponentTypes()
+{
+    return &componentTypes;
+}
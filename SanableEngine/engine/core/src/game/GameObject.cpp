@@ -2,6 +2,7 @@
 
 #include <utility>
 #include <cassert>
+#include <mutex>
 
 #include "application/Application.hpp"
 #include "game/Game.hpp"
@@ -10,19 +11,47 @@
 void GameObject::BindComponent(Component* c)
 {
 	assert(c->gameObject == nullptr || c->gameObject == this);
-	assert(std::find(components.cbegin(), components.cend(), c) == components.cend());
+	assert(c->componentIndex == invalidIndex);
 
+	c->componentIndex = components.size();
 	components.push_back(c);
+	componentTypes.push_back(c->componentTypeId);
 	c->BindToGameObject(this);
 
 	c->onStart();
 }
 
+void GameObject::remapPointers(const MemoryMapper& remapper)
+{
+	transform.remapPointers(remapper);
+	for (Component*& c : components)
+	{
+		c = remapper.transformAddress(c);
+		c->gameObject = this; //We might have moved too
+	}
+}
+
 void GameObject::InvokeStart()
 {
 	for (Component* c : components) c->onStart();
 }
 
+ComponentTypeRegistry* GameObject::getComponentTypes() const
+{
+	return engine->getComponentTypes();
+}
+
+MemoryManager* GameObject::getMemoryManager() const
+{
+	return engine->getApplication()->getMemoryManager();
+}
+
+void GameObject::queueBindComponent(Component* c)
+{
+	std::lock_guard<std::mutex> guard(engine->objectBufferLock);
+	engine->componentAddBuffer.push_back(std::pair<Component*, GameObject*>(c, this));
+}
+
 GameObject::GameObject(Game* engine) :
 	engine(engine)
 {
@@ -34,5 +63,6 @@ GameObject::~GameObject()
 	{
 		for (Component* c : components) engine->getApplication()->getMemoryManager()->destroy(c);
 		components.clear();
+		componentTypes.clear();
 	}
 }
@@ -1,8 +1,9 @@
 #include "game/GameWindowRenderPipeline.hpp"
 
-#include <unordered_map>
 #include <GL/glew.h>
 #include "game/Game.hpp"
+#include "application/Application.hpp"
+#include "RenderQueue.hpp"
 #include "application/Window.hpp"
 #include "Camera.hpp"
 #include "Material.hpp"
@@ -22,6 +23,11 @@ void GameWindowRenderPipeline::setup(Window* window)
 	WindowRenderPipeline::setup(window);
 }
 
+void GameWindowRenderPipeline::layout(Rect<float> viewport)
+{
+	hud.refreshLayout(viewport);
+}
+
 void GameWindowRenderPipeline::render(Rect<float> viewport)
 {
 	//Set projection matrix
@@ -32,52 +38,40 @@ void GameWindowRenderPipeline::render(Rect<float> viewport)
 	glClearColor(0, 0, 0, 1);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	//Collect objects to buffer
-	std::unordered_map<
-		const ShaderProgram*, //Group by shader
-		std::unordered_map<
-			const Material*, //Then by material
-			std::vector<const I3DRenderable*>
-		>
-	> renderables; //Note: No need for a CallBatcher here, we're guaranteed renderables will be grouped by type since our data source is a CallBatcher
-	game->get3DRenderables()->staticCall([&](const I3DRenderable* r)
-	{
-		renderables[r->getShader()][r->getMaterial()].push_back(r);
-	});
+	//Usually already collected and sorted by the frame graph, off the main thread
+	const RenderQueue<const I3DRenderable>& renderables = *game->getRenderQueue();
 
 	glMatrixMode(GL_MODELVIEW);
 	glPushMatrix();
 
 	//Process buffer
 	Renderer* renderInterface = window->getRenderer();
-	for (const auto& shaderGroup : renderables)
-	{
-		//Activate shader
-		if (shaderGroup.first) shaderGroup.first->activate();
-		else ShaderProgram::clear();
-
-		for (const auto& materialGroup : shaderGroup.second)
+	renderables.visit(
+		[&](const ShaderProgram* shader)
+		{
+			//Activate shader
+			if (shader) shader->activate();
+			else ShaderProgram::clear();
+		},
+		[&](const ShaderProgram* shader, const Material* material)
 		{
 			//Activate material
-			if (materialGroup.first) materialGroup.first->writeSharedUniforms(renderInterface);
-			assert(materialGroup.first == nullptr || materialGroup.first->getShader() == shaderGroup.first);
-
-			for (const I3DRenderable* r : materialGroup.second)
-			{
-				r->loadModelTransform(renderInterface);
+			if (material) material->writeSharedUniforms(renderInterface);
+			assert(material == nullptr || material->getShader() == shader);
+		},
+		[&](const Material* material, const I3DRenderable* r)
+		{
+			r->loadModelTransform(renderInterface);
 
-				if (materialGroup.first) materialGroup.first->writeInstanceUniforms(renderInterface, r);
+			if (material) material->writeInstanceUniforms(renderInterface, r);
 
-				assert(r->getMaterial() == materialGroup.first);
-				assert(r->getMaterial() == nullptr || r->getMaterial()->getShader() == shaderGroup.first);
-				r->renderImmediate(renderInterface);
-			}
+			assert(r->getMaterial() == material);
+			r->renderImmediate(renderInterface);
 		}
-	}
+	);
 
 	glPopMatrix();
 
-	hud.refreshLayout(viewport);
 	hud.tick(); //FIXME logic shouldn't be in render, move elsewhere
 	hud.render(viewport, renderInterface);
 }
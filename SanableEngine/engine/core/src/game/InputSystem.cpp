@@ -1,5 +1,6 @@
 #include "game/InputSystem.hpp"
 
+#include <cstdio>
 #include <SDL_keyboard.h>
 #include <SDL_mouse.h>
 
@@ -3,6 +3,8 @@
 #include <cassert>
 #include <algorithm>
 
+#include "MemoryMapper.hpp"
+
 Transform::Transform() :
 	parent(nullptr),
 	local(),
@@ -24,6 +26,12 @@ Transform::~Transform()
 	for (Transform* t : children) t->parent = nullptr;
 }
 
+void Transform::remapPointers(const MemoryMapper& remapper)
+{
+	if (parent) parent = remapper.transformAddress(parent);
+	for (Transform*& t : children) t = remapper.transformAddress(t);
+}
+
 bool Transform::isDirty() const
 {
 	return isDirtySelf || (parent && parent->isDirty());
@@ -61,6 +69,13 @@ void Transform::ensureUpToDate() const
 	if (isDirty()) recompute();
 }
 
+void Transform::propagate(bool parentChanged) const
+{
+	bool changed = parentChanged || isDirtySelf;
+	if (changed) recompute(); //Parent was done first, so this doesn't walk back up
+	for (Transform* c : children) c->propagate(changed);
+}
+
 Transform* Transform::getParent() const
 {
 	return parent;
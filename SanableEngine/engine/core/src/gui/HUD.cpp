@@ -1,10 +1,13 @@
 #include "gui/HUD.hpp"
 
-#include <unordered_map>
 #include <algorithm>
 
 #include "ShaderProgram.hpp"
 #include "Material.hpp"
+#include "Renderer.hpp"
+#include "application/Window.hpp"
+#include "application/Application.hpp"
+#include "RenderQueue.hpp"
 
 void HUD::applyConcurrencyBuffers()
 {
@@ -65,57 +68,58 @@ void HUD::render(Rect<float> viewport, Renderer* renderer)
 
 	applyConcurrencyBuffers();
 	
-	//Collect objects to buffer
-	std::unordered_map<
-		const ShaderProgram*, //Group by shader
-		std::unordered_map<
-			const Material*, //Then by material
-			std::vector<Widget*>
-		>
-	> renderables; //Note: No need for a CallBatcher here, we're guaranteed widgets will be grouped by type since our data source is a CallBatcher
-	widgets.staticCall([&](Widget* w)
-	{
-		renderables[w->getShader()][w->getMaterial()].push_back(w);
-	});
+	//Collect objects to buffer. Counted first so the queue can come from frame memory in one piece.
+	size_t nWidgets = 0;
+	widgets.staticCall([&](Widget*) { nWidgets++; });
+	RenderQueue<Widget> renderables(renderer->getOwner()->getEngine()->getFrameAllocator(), nWidgets);
+	widgets.staticCall([&](Widget* w) { renderables.push(w); }); //Note: No need for a CallBatcher here, we're guaranteed widgets will be grouped by type since our data source is a CallBatcher
+	renderables.sort();
 
 	glMatrixMode(GL_MODELVIEW);
 	glPushMatrix();
 
 	//Process buffer
-	for (const auto& shaderGroup : renderables)
-	{
-		//Activate shader
-		if (shaderGroup.first) shaderGroup.first->activate();
-		else ShaderProgram::clear();
-
-		for (const auto& materialGroup : shaderGroup.second)
+	renderables.visit(
+		[&](const ShaderProgram* shader)
+		{
+			//Activate shader
+			if (shader) shader->activate();
+			else ShaderProgram::clear();
+		},
+		[&](const ShaderProgram* shader, const Material* material)
 		{
 			//Activate material
-			if (materialGroup.first) materialGroup.first->writeSharedUniforms(renderer);
-			assert(materialGroup.first == nullptr || materialGroup.first->getShader() == shaderGroup.first);
-
-			for (Widget* w : materialGroup.second)
-			{
-				w->loadModelTransform(renderer);
+			if (material) material->writeSharedUniforms(renderer);
+			assert(material == nullptr || material->getShader() == shader);
+		},
+		[&](const Material* material, Widget* w)
+		{
+			w->loadModelTransform(renderer);
 
-				if (materialGroup.first) materialGroup.first->writeInstanceUniforms(renderer, w);
+			if (material) material->writeInstanceUniforms(renderer, w);
 
-				assert(w->getMaterial() == materialGroup.first);
-				assert(w->getMaterial() == nullptr || w->getMaterial()->getShader() == shaderGroup.first);
-				w->renderImmediate(renderer);
-			}
+			assert(w->getMaterial() == material);
+			w->renderImmediate(renderer);
 		}
-	}
+	);
 
 	glPopMatrix();
 }
 
-void HUD::raycast(Vector2f pos, const std::function<void(Widget*)>& visitor) const
+void HUD::raycast(Vector2f pos, StackAllocator* scratch, const std::function<void(Widget*)>& visitor) const
 {
-	std::vector<Widget*> hits;
-	widgets.staticCall([&](Widget* w) { if (w->transform.getRect().contains(pos)) hits.push_back(w); }); //FIXME inefficient as heck, especially without cached transforms
-	std::sort(hits.begin(), hits.end(), [](Widget* a, Widget* b) { return a->transform.getRenderDepth() > b->transform.getRenderDepth(); });
-	for (Widget* w : hits) visitor(w);
+	//Worst case every widget is hit. Scratch memory is handed back once we're done.
+	StackAllocator::Checkpoint mark = scratch->markCheckpoint();
+	size_t nWidgets = 0;
+	widgets.staticCall([&](Widget*) { nWidgets++; });
+	Widget** hits = scratch->alloc<Widget*>(nWidgets);
+
+	size_t nHits = 0;
+	widgets.staticCall([&](Widget* w) { if (w->transform.getRect().contains(pos)) hits[nHits++] = w; }); //FIXME inefficient as heck, especially without cached transforms
+	std::sort(hits, hits+nHits, [](Widget* a, Widget* b) { return a->transform.getRenderDepth() > b->transform.getRenderDepth(); });
+	for (size_t i = 0; i < nHits; ++i) visitor(hits[i]);
+
+	scratch->restoreCheckpoint(mark);
 }
 
 WidgetTransform const* HUD::getRootTransform() const
@@ -1,117 +1,77 @@
 #include "gui/LayoutUtil.hpp"
 
 #include "gui/WidgetTransform.hpp"
+#include "StackAllocator.hpp"
 
-void LayoutUtil::Stretch::vertical(UIRect container, const std::vector<std::pair<WidgetTransform*, float>>& widgets, Padding padding)
-{
-	//Retrieve only weights
-	std::vector<float> weights;
-	weights.reserve(widgets.size());
-	for (const auto& p : widgets) weights.push_back(p.second);
-
-	//Defer
-	std::vector<UIRect> rects = vertical(container, weights, padding);
+using LayoutUtil::UIRect;
+using LayoutUtil::Padding;
 
-	//Apply
-	for (int i = 0; i < rects.size(); ++i) widgets[i].first->setRectByOffsets(rects[i]);
-}
-
-void LayoutUtil::Stretch::horizontal(UIRect container, const std::vector<std::pair<WidgetTransform*, float>>& widgets, Padding padding)
+//Shared by all overloads. Element i gets a share of the container along the given axis (0 = x, 1 = y)
+//proportional to getWeight(i), and is handed to emit(i, rect) as soon as it's known, so no buffers are needed.
+template<int axis, typename TGetWeight, typename TEmit>
+static void stretch(UIRect container, size_t count, Padding padding, TGetWeight getWeight, TEmit emit)
 {
-	//Retrieve only weights
-	std::vector<float> weights;
-	weights.reserve(widgets.size());
-	for (const auto& p : widgets) weights.push_back(p.second);
+	if (count == 0) return;
 
-	//Defer
-	std::vector<UIRect> rects = horizontal(container, weights, padding);
-
-	//Apply
-	for (int i = 0; i < rects.size(); ++i) widgets[i].first->setRectByOffsets(rects[i]);
-}
-
-std::vector<LayoutUtil::UIRect> LayoutUtil::Stretch::vertical(UIRect container, const std::vector<float>& weights)
-{
 	float weightSum = 0;
-	for (float w : weights) weightSum += w;
+	for (size_t i = 0; i < count; ++i) weightSum += getWeight(i);
 
-	Vector2f cursor = container.topLeft;
+	//Calc inner rect
+	UIRect inner = UIRect::fromMinMax(
+		container.topLeft       + Vector2f(padding.left , padding.top   ),
+		container.bottomRight()	- Vector2f(padding.right, padding.bottom)
+	);
+	float available = (axis == 0 ? inner.size.x : inner.size.y) - (count-1)*padding.betweenElements;
 
-	std::vector<UIRect> out;
-	out.reserve(weights.size());
-	for (float w : weights)
+	Vector2f cursor = inner.topLeft;
+	for (size_t i = 0; i < count; ++i)
 	{
-		float elementHeight = container.size.y * (w/weightSum);
-		out.push_back( UIRect::fromMinMax(cursor, cursor+Vector2f(container.size.x, elementHeight)) ); //Output rect
-		cursor.y += elementHeight; //Advance cursor
-	}
+		float elementSize = available * (getWeight(i)/weightSum);
+		Vector2f extent = (axis == 0) ? Vector2f(elementSize, inner.size.y) : Vector2f(inner.size.x, elementSize);
+		emit(i, UIRect::fromMinMax(cursor, cursor+extent)); //Output rect
 
-	return out;
+		//Advance cursor
+		if (axis == 0) cursor.x += elementSize + padding.betweenElements;
+		else           cursor.y += elementSize + padding.betweenElements;
+	}
 }
 
-std::vector<LayoutUtil::UIRect> LayoutUtil::Stretch::horizontal(UIRect container, const std::vector<float>& weights)
+void LayoutUtil::Stretch::vertical(UIRect container, const std::vector<std::pair<WidgetTransform*, float>>& widgets, Padding padding)
 {
-	float weightSum = 0;
-	for (float w : weights) weightSum += w;
-
-	Vector2f cursor = container.topLeft;
-
-	std::vector<UIRect> out;
-	out.reserve(weights.size());
-	for (float w : weights)
-	{
-		float elementWidth = container.size.x * (w/weightSum);
-		out.push_back( UIRect::fromMinMax(cursor, cursor+Vector2f(elementWidth, container.size.y)) ); //Output rect
-		cursor.x += elementWidth; //Advance cursor
-	}
-
-	return out;
+	stretch<1>(container, widgets.size(), padding,
+		[&](size_t i) { return widgets[i].second; },
+		[&](size_t i, const UIRect& r) { widgets[i].first->setRectByOffsets(r); }
+	);
 }
 
-std::vector<LayoutUtil::UIRect> LayoutUtil::Stretch::vertical(UIRect container, const std::vector<float>& weights, Padding padding)
+void LayoutUtil::Stretch::horizontal(UIRect container, const std::vector<std::pair<WidgetTransform*, float>>& widgets, Padding padding)
 {
-	//Calc inner rect
-	UIRect containerWithOuterPadding = UIRect::fromMinMax(
-		container.topLeft       + Vector2f(padding.left , padding.top   ),
-		container.bottomRight()	- Vector2f(padding.right, padding.bottom)
+	stretch<0>(container, widgets.size(), padding,
+		[&](size_t i) { return widgets[i].second; },
+		[&](size_t i, const UIRect& r) { widgets[i].first->setRectByOffsets(r); }
 	);
+}
 
-	//Defer
-	std::vector<LayoutUtil::UIRect> out = vertical(
-		UIRect::fromMinMax(
-			containerWithOuterPadding.topLeft,
-			containerWithOuterPadding.bottomRight() - Vector2f(0, (weights.size()-1)*padding.betweenElements)
-		),
-		weights
-	);
+void LayoutUtil::Stretch::vertical(UIRect container, const float* weights, size_t count, Padding padding, UIRect* out)
+{
+	stretch<1>(container, count, padding, [&](size_t i) { return weights[i]; }, [&](size_t i, const UIRect& r) { out[i] = r; });
+}
 
-	//Adjust for padding between elements
-	for (int i = 0; i < out.size(); ++i) out[i].topLeft.y += i*padding.betweenElements;
+void LayoutUtil::Stretch::horizontal(UIRect container, const float* weights, size_t count, Padding padding, UIRect* out)
+{
+	stretch<0>(container, count, padding, [&](size_t i) { return weights[i]; }, [&](size_t i, const UIRect& r) { out[i] = r; });
+}
 
-	//Done
+UIRect* LayoutUtil::Stretch::vertical(UIRect container, const float* weights, size_t count, Padding padding, StackAllocator* arena)
+{
+	UIRect* out = arena->alloc<UIRect>(count);
+	vertical(container, weights, count, padding, out);
 	return out;
 }
 
-std::vector<LayoutUtil::UIRect> LayoutUtil::Stretch::horizontal(UIRect container, const std::vector<float>& weights, Padding padding)
+UIRect* LayoutUtil::Stretch::horizontal(UIRect container, const float* weights, size_t count, Padding padding, StackAllocator* arena)
 {
-	//Calc inner rect
-	UIRect containerWithOuterPadding = UIRect::fromMinMax(
-		container.topLeft       + Vector2f(padding.left , padding.top   ),
-		container.bottomRight()	- Vector2f(padding.right, padding.bottom)
-	);
-
-	//Defer
-	std::vector<LayoutUtil::UIRect> out = horizontal(
-		UIRect::fromMinMax(
-			containerWithOuterPadding.topLeft,
-			containerWithOuterPadding.bottomRight() - Vector2f((weights.size()-1)*padding.betweenElements, 0)
-		),
-		weights
-	);
-
-	//Adjust for padding between elements
-	for (int i = 0; i < out.size(); ++i) out[i].topLeft.x += i*padding.betweenElements;
-
-	//Done
+	UIRect* out = arena->alloc<UIRect>(count);
+	horizontal(container, weights, count, padding, out);
 	return out;
 }
@@ -3,6 +3,7 @@
 #include "math/Vector2.inl"
 #include "gui/HUD.hpp"
 #include "application/Window.hpp"
+#include "application/Application.hpp"
 
 WindowGUIInputProcessor::WindowGUIInputProcessor(HUD* hud) :
 	hud(hud)
@@ -23,7 +24,7 @@ void WindowGUIInputProcessor::handleEvent(SDL_Event& ev)
 		case SDL_EventType::SDL_MOUSEBUTTONDOWN:
 		{
 			Vector2f mousePos = getMousePos();
-			hud->raycast(mousePos, [&](Widget* w) {
+			hud->raycast(mousePos, window->getEngine()->getFrameAllocator(), [&](Widget* w) {
 				if (!consumed && w->onMouseDown(mousePos)) consumed = true;
 			});
 			break;
@@ -32,7 +33,7 @@ void WindowGUIInputProcessor::handleEvent(SDL_Event& ev)
 		case SDL_EventType::SDL_MOUSEBUTTONUP:
 		{
 			Vector2f mousePos = getMousePos();
-			hud->raycast(mousePos, [&](Widget* w) {
+			hud->raycast(mousePos, window->getEngine()->getFrameAllocator(), [&](Widget* w) {
 				if (!consumed && w->onMouseUp(mousePos)) consumed = true;
 			});
 			break;
@@ -11,6 +11,11 @@ WindowGUIRenderPipeline::~WindowGUIRenderPipeline()
 {
 }
 
+void WindowGUIRenderPipeline::layout(Rect<float> viewport)
+{
+	hud.refreshLayout(viewport);
+}
+
 void WindowGUIRenderPipeline::render(Rect<float> viewport)
 {
 	//Set flags
@@ -26,8 +31,7 @@ void WindowGUIRenderPipeline::render(Rect<float> viewport)
 	glClearColor(0, 0, 0, 1);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	//Tick and render GUI
-	hud.refreshLayout(viewport);
+	//Tick and render GUI. Layout was already done by the frame graph.
 	hud.tick();
 	hud.render(viewport, window->getRenderer());
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "ShaderStage.hpp"
 #include "ShaderUniform.hpp"
 
@@ -1,6 +1,7 @@
 #include "GLContext.hpp"
 
 #include <cassert>
+#include <cstdio>
 #include <GL/glew.h>
 
 std::unordered_map<SDL_GLContext, int> GLContext::handles; //ptr -> refcount
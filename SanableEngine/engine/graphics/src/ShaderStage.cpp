@@ -2,6 +2,7 @@
 
 #include <fstream>
 #include <cassert>
+#include <cstring>
 
 ShaderStage::ShaderStage():
 	handle(0),
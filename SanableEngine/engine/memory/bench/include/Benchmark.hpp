@@ -0,0 +1,212 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+
+#if __linux__ && __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cstring>
+#define BENCH_HAS_PERF_COUNTERS 1
+#else
+#define BENCH_HAS_PERF_COUNTERS 0
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h> //_ReadWriteBarrier
+#endif
+
+/*
+ * Minimal benchmarking harness. Cases register themselves with BENCHMARK_CASE
+ * and are run in registration order by entry.cpp. Build in Release for
+ * meaningful numbers. Every report is also recorded, so entry.cpp can write
+ * results as JSON for tracking regressions.
+ */
+
+namespace bench
+{
+	typedef void (*case_fn_t)();
+
+	struct Case
+	{
+		const char* name;
+		case_fn_t fn;
+	};
+
+	inline std::vector<Case>& registry()
+	{
+		static std::vector<Case> cases;
+		return cases;
+	}
+
+	struct Registrar
+	{
+		inline Registrar(const char* name, case_fn_t fn) { registry().push_back(Case{ name, fn }); }
+	};
+
+	//Object counts for scaling cases: 1k-1M, capped by --max-n
+	inline size_t& maxN()
+	{
+		static size_t val = 1000000;
+		return val;
+	}
+	inline std::vector<size_t> sizes()
+	{
+		std::vector<size_t> out;
+		for (size_t n = 1000; n <= maxN(); n *= 10) out.push_back(n);
+		return out;
+	}
+
+	//Hardware cache misses on the calling thread. Reads 0 where unavailable (ie. not Linux, or perf_event_paranoid forbids it).
+	class CacheMissCounter
+	{
+		int fd = -1;
+	public:
+		inline CacheMissCounter()
+		{
+#if BENCH_HAS_PERF_COUNTERS
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = PERF_COUNT_HW_CACHE_MISSES;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+		}
+		inline ~CacheMissCounter()
+		{
+#if BENCH_HAS_PERF_COUNTERS
+			if (fd >= 0) close(fd);
+#endif
+		}
+		inline bool isAvailable() const { return fd >= 0; }
+		inline uint64_t read() const
+		{
+			uint64_t val = 0;
+#if BENCH_HAS_PERF_COUNTERS
+			if (fd >= 0 && ::read(fd, &val, sizeof(val)) != sizeof(val)) val = 0;
+#endif
+			return val;
+		}
+
+		static inline CacheMissCounter& get()
+		{
+			static thread_local CacheMissCounter counter;
+			return counter;
+		}
+	};
+
+	class Stopwatch
+	{
+		std::chrono::steady_clock::time_point start;
+		uint64_t startMisses;
+	public:
+		inline Stopwatch() : start(std::chrono::steady_clock::now()), startMisses(CacheMissCounter::get().read()) {}
+		inline double elapsedNs() const { return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(); }
+		inline double cacheMisses() const { return CacheMissCounter::get().isAvailable() ? double(CacheMissCounter::get().read() - startMisses) : -1; } //-1 if unavailable
+	};
+
+	struct Result
+	{
+		std::string caseName;
+		std::string label;
+		size_t n;
+		double nsPerOp;
+		double bytesPerOp; //Memory touched per op, if known. 0 = unknown.
+		double missesPerOp; //Cache misses per op. -1 = unavailable.
+	};
+
+	inline std::vector<Result>& results()
+	{
+		static std::vector<Result> val;
+		return val;
+	}
+
+	inline std::string& currentCase()
+	{
+		static std::string val;
+		return val;
+	}
+
+	//Print and record a single measurement
+	inline void report(const char* label, size_t n, double totalNs, size_t nOps, double bytesPerOp = 0, double totalMisses = -1)
+	{
+		if (!nOps) nOps = 1;
+		Result r = { currentCase(), label, n, totalNs / nOps, bytesPerOp, totalMisses >= 0 ? totalMisses / nOps : -1 };
+		printf("  %-40s n=%-8zu %12.2f ns/op", label, n, r.nsPerOp);
+		if (r.bytesPerOp > 0) printf(" %8.2f GB/s", r.bytesPerOp / r.nsPerOp);
+		if (r.missesPerOp >= 0) printf(" %8.3f misses/op", r.missesPerOp);
+		printf("\n");
+		results().push_back(r);
+	}
+
+	//Same, but also picks up cache misses from the stopwatch
+	inline void report(const char* label, size_t n, const Stopwatch& t, size_t nOps, double bytesPerOp = 0)
+	{
+		double ns = t.elapsedNs();
+		report(label, n, ns, nOps, bytesPerOp, t.cacheMisses());
+	}
+
+	inline void writeJsonString(FILE* f, const std::string& s)
+	{
+		fputc('"', f);
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\') fputc('\\', f);
+			fputc(c, f);
+		}
+		fputc('"', f);
+	}
+
+	//Writes every recorded result as a JSON array
+	inline bool writeJson(const char* path)
+	{
+		FILE* f = fopen(path, "w");
+		if (!f) return false;
+
+		fprintf(f, "[\n");
+		for (size_t i = 0; i < results().size(); ++i)
+		{
+			const Result& r = results()[i];
+			fprintf(f, "  { \"case\": ");
+			writeJsonString(f, r.caseName);
+			fprintf(f, ", \"label\": ");
+			writeJsonString(f, r.label);
+			fprintf(f, ", \"n\": %zu, \"ns_per_op\": %.3f", r.n, r.nsPerOp);
+			if (r.bytesPerOp > 0) fprintf(f, ", \"bytes_per_op\": %.1f, \"gb_per_s\": %.3f", r.bytesPerOp, r.bytesPerOp / r.nsPerOp);
+			if (r.missesPerOp >= 0) fprintf(f, ", \"cache_misses_per_op\": %.4f", r.missesPerOp);
+			fprintf(f, " }%s\n", i+1 < results().size() ? "," : "");
+		}
+		fprintf(f, "]\n");
+
+		fclose(f);
+		return true;
+	}
+
+	//Keep the optimizer from discarding results. Claims to read val's memory, so whatever produced it has to actually run.
+	template<typename T>
+	inline void doNotOptimize(const T& val)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r"(&val) : "memory");
+#else
+		static const void* volatile sink; //Pointer itself must be volatile, or the store is dead
+		sink = &val;
+		_ReadWriteBarrier();
+#endif
+	}
+}
+
+#define BENCH_CONCAT_INNER(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_INNER(a, b)
+#define BENCHMARK_CASE(name) \
+	static void BENCH_CONCAT(bench_case_, __LINE__)(); \
+	static ::bench::Registrar BENCH_CONCAT(bench_registrar_, __LINE__)(name, &BENCH_CONCAT(bench_case_, __LINE__)); \
+	static void BENCH_CONCAT(bench_case_, __LINE__)()
@@ -0,0 +1,95 @@
+#include "Benchmark.hpp"
+
+#include <vector>
+
+#include "MemoryManager.hpp"
+#include "ArchetypeStorage.hpp"
+
+//Component-per-object layout: hot position/velocity next to cold data, each object in its own pool slot
+struct PooledBody
+{
+	float position[3] = { 0, 0, 0 };
+	float velocity[3] = { 1, 2, 3 };
+	float rotation[4] = { 0, 0, 0, 1 };
+	void* owner = nullptr;
+	char name[32] = { 0 };
+};
+
+struct EcsPosition { float v[3] = { 0, 0, 0 }; };
+struct EcsVelocity { float v[3] = { 1, 2, 3 }; };
+struct EcsCold { float rotation[4] = { 0, 0, 0, 1 }; void* owner = nullptr; char name[32] = { 0 }; };
+struct EcsFrozen {};
+
+BENCHMARK_CASE("ArchetypeStorage: update scaling, pool vs query")
+{
+	constexpr float dt = 1.0f / 60;
+
+	for (size_t n : bench::sizes())
+	{
+		//Baseline: whole objects in a pool
+		{
+			MemoryManager memory;
+			memory.createPool<PooledBody>(RawMemoryPool::StorageMode::Paged);
+			std::vector<PooledBody*> objs(n);
+			for (size_t i = 0; i < n; ++i) objs[i] = memory.create<PooledBody>();
+			TypedMemoryPool<PooledBody>* pool = memory.getSpecificPool<PooledBody>(false);
+
+			bench::Stopwatch t;
+			pool->foreachLive([&](void* obj)
+			{
+				PooledBody* b = (PooledBody*)obj;
+				for (int k = 0; k < 3; ++k) b->position[k] += b->velocity[k] * dt;
+			});
+			bench::report("pool foreachLive", n, t, n, sizeof(PooledBody));
+			for (PooledBody* obj : objs) memory.destroy(obj);
+		}
+
+		//Same data split into components, with a quarter of entities in a second table
+		{
+			ArchetypeStorage storage;
+			for (size_t i = 0; i < n; ++i)
+			{
+				ArchetypeStorage::Entity e = storage.create();
+				storage.add<EcsPosition>(e);
+				storage.add<EcsVelocity>(e);
+				storage.add<EcsCold>(e);
+				if (i % 4 == 0) storage.add<EcsFrozen>(e);
+			}
+			auto moving = storage.query<EcsPosition, const EcsVelocity>();
+
+			bench::Stopwatch t;
+			moving.foreachChunk([&](size_t count, const ArchetypeStorage::Entity*, EcsPosition* positions, const EcsVelocity* velocities)
+			{
+				for (size_t i = 0; i < count; ++i) for (int k = 0; k < 3; ++k) positions[i].v[k] += velocities[i].v[k] * dt;
+			});
+			bench::report("query foreachChunk", n, t, n, sizeof(EcsPosition)+sizeof(EcsVelocity));
+		}
+	}
+}
+
+BENCHMARK_CASE("ArchetypeStorage: structural change scaling")
+{
+	for (size_t n : bench::sizes())
+	{
+		ArchetypeStorage storage;
+		std::vector<ArchetypeStorage::Entity> entities(n);
+
+		bench::Stopwatch t;
+		for (size_t i = 0; i < n; ++i)
+		{
+			entities[i] = storage.create();
+			storage.add<EcsPosition>(entities[i]);
+			storage.add<EcsVelocity>(entities[i]);
+		}
+		bench::report("create + 2 adds", n, t, n);
+
+		bench::Stopwatch t2;
+		for (ArchetypeStorage::Entity e : entities) storage.add<EcsFrozen>(e);
+		for (ArchetypeStorage::Entity e : entities) storage.remove<EcsFrozen>(e);
+		bench::report("add/remove tag (moves tables)", n, t2, n*2);
+
+		bench::Stopwatch t3;
+		for (ArchetypeStorage::Entity e : entities) storage.destroy(e);
+		bench::report("destroy", n, t3, n);
+	}
+}
@@ -0,0 +1,47 @@
+#include "Benchmark.hpp"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "MemoryManager.hpp"
+
+struct ManagedBody
+{
+	float position[3] = { 0, 0, 0 };
+	float velocity[3] = { 0, 0, 0 };
+	int flags = 0;
+};
+
+BENCHMARK_CASE("MemoryManager: create/destroy scaling")
+{
+	for (size_t n : bench::sizes())
+	{
+		std::vector<ManagedBody*> objs(n);
+
+		//Cold: pool grows on demand
+		{
+			MemoryManager memory;
+			memory.createPool<ManagedBody>(RawMemoryPool::StorageMode::Paged);
+			bench::Stopwatch t;
+			for (size_t i = 0; i < n; ++i) objs[i] = memory.create<ManagedBody>();
+			bench::report("create (pool grows)", n, t, n);
+			for (ManagedBody* obj : objs) memory.destroy(obj);
+		}
+
+		//Warm: pool already sized by a previous session
+		{
+			MemoryManager memory;
+			memory.getSpecificPool<ManagedBody>(true);
+			memory.getSpecificPool(TypeName::create<ManagedBody>())->setMaxNumObjects(n);
+			bench::Stopwatch t;
+			for (size_t i = 0; i < n; ++i) objs[i] = memory.create<ManagedBody>();
+			bench::report("create (pre-sized)", n, t, n);
+
+			std::shuffle(objs.begin(), objs.end(), std::mt19937(12345));
+			bench::Stopwatch t2;
+			for (ManagedBody* obj : objs) memory.destroy(obj);
+			bench::report("destroy (random order)", n, t2, n);
+		}
+	}
+}
@@ -0,0 +1,47 @@
+#include "Benchmark.hpp"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+
+#include "MemoryMapper.hpp"
+
+BENCHMARK_CASE("MemoryMapper: transformAddress with large op logs")
+{
+	constexpr size_t blockSize = 64;
+	char* base = reinterpret_cast<char*>(uintptr_t(1) << 32); //Only logged, never dereferenced
+
+	for (size_t nOps : bench::sizes())
+	{
+		//Compaction-like: live objects from the back half fill holes in the front half, in no particular order
+		std::vector<size_t> order(nOps);
+		for (size_t i = 0; i < nOps; ++i) order[i] = i;
+		std::mt19937 rng(12345);
+		std::shuffle(order.begin(), order.end(), rng);
+
+		MemoryMapper remapper;
+		{
+			bench::Stopwatch t;
+			for (size_t i = 0; i < nOps; ++i) remapper.logMove(base + i*2*blockSize, base + (2*nOps + order[i])*blockSize, blockSize);
+			bench::report("logMove", nOps, t, nOps);
+		}
+
+		{
+			bench::Stopwatch t;
+			bench::doNotOptimize(remapper.transformAddress(base, 1)); //First lookup compiles the log
+			bench::report("compile (first transformAddress)", nOps, t, nOps);
+		}
+
+		//Mix of moved and untouched addresses
+		std::vector<char*> queries(nOps);
+		for (size_t i = 0; i < nOps; ++i) queries[i] = base + (rng() % (3*nOps))*blockSize + rng() % blockSize;
+		{
+			uintptr_t sum = 0;
+			bench::Stopwatch t;
+			for (char* p : queries) sum += (uintptr_t) remapper.transformAddress(p, 1);
+			bench::report("transformAddress", nOps, t, nOps);
+			bench::doNotOptimize(sum);
+		}
+	}
+}
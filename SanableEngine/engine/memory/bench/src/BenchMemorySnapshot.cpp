@@ -0,0 +1,60 @@
+#include "Benchmark.hpp"
+
+#include <vector>
+
+#include "MemoryManager.hpp"
+
+struct SnapshotBody
+{
+	float position[3];
+	float velocity[3];
+	int flags;
+	char payload[36];
+};
+
+BENCHMARK_CASE("MemoryManager: snapshot a 100MB world")
+{
+	constexpr size_t n = 100 * 1024 * 1024 / sizeof(SnapshotBody);
+
+	MemoryManager memory;
+	memory.createPool<SnapshotBody>(RawMemoryPool::StorageMode::Reserved); //Lets deltas use write tracking
+	std::vector<SnapshotBody*> objs(n);
+	for (size_t i = 0; i < n; ++i) objs[i] = memory.create<SnapshotBody>();
+
+	MemorySnapshot full;
+	{
+		bench::Stopwatch t;
+		full = memory.snapshot();
+		bench::report("full snapshot", n, t.elapsedNs(), n);
+	}
+
+	//Typical frame: a few percent of objects touched
+	for (size_t i = 0; i < n; i += 50) objs[i]->position[0] += 1;
+
+	{
+		bench::Stopwatch t;
+		MemorySnapshot delta = memory.snapshot(&full);
+		double ns = t.elapsedNs();
+		bench::report("delta snapshot (2% touched)", n, ns, n);
+		printf("  %-40s %.2f ms, %zu of %zu bytes copied\n", "", ns / 1e6, delta.getOwnBytes(), full.getOwnBytes());
+	}
+
+	//Sparse frame: changes clustered, so most chunks match
+	MemorySnapshot base = memory.snapshot();
+	for (size_t i = 0; i < n/100; ++i) objs[i]->flags++;
+	{
+		bench::Stopwatch t;
+		MemorySnapshot delta = memory.snapshot(&base);
+		double ns = t.elapsedNs();
+		bench::report("delta snapshot (1% clustered)", n, ns, n);
+		printf("  %-40s %.2f ms, %zu of %zu bytes copied\n", "", ns / 1e6, delta.getOwnBytes(), base.getOwnBytes());
+	}
+
+	{
+		bench::Stopwatch t;
+		memory.restore(full);
+		bench::report("restore", n, t.elapsedNs(), n);
+	}
+
+	for (SnapshotBody* obj : objs) memory.destroy(obj);
+}
@@ -0,0 +1,118 @@
+#include "Benchmark.hpp"
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+#include "ModuleTypeRegistry.hpp"
+#include "TypeBuilder.hpp"
+
+#include "TypedMemoryPool.hpp"
+#include "ObjectPatch.hpp"
+
+struct ReloadV1
+{
+	int id = 1;
+	float x = 2, y = 3, z = 4;
+	void* owner = nullptr;
+	int flags = 5;
+};
+
+//Typical edit: fields reordered, one removed, one added
+struct ReloadV2
+{
+	void* owner;
+	float x, y, z;
+	int id;
+	double mass;
+};
+
+//Returns ReloadV1 and ReloadV2, with V2 renamed to look like V1 post-reload
+static std::pair<TypeInfo, TypeInfo> createReloadTypes()
+{
+	ModuleTypeRegistry m;
+	{
+		TypeBuilder b = TypeBuilder::create<ReloadV1>();
+		b.addField<int  >("id"   , [](const void*) { return ptrdiff_t(offsetof(ReloadV1, id   )); });
+		b.addField<float>("x"    , [](const void*) { return ptrdiff_t(offsetof(ReloadV1, x    )); });
+		b.addField<float>("y"    , [](const void*) { return ptrdiff_t(offsetof(ReloadV1, y    )); });
+		b.addField<float>("z"    , [](const void*) { return ptrdiff_t(offsetof(ReloadV1, z    )); });
+		b.addField<void*>("owner", [](const void*) { return ptrdiff_t(offsetof(ReloadV1, owner)); });
+		b.addField<int  >("flags", [](const void*) { return ptrdiff_t(offsetof(ReloadV1, flags)); });
+		b.registerType(&m);
+	}
+	{
+		TypeBuilder b = TypeBuilder::create<ReloadV2>();
+		b.addField<void* >("owner", [](const void*) { return ptrdiff_t(offsetof(ReloadV2, owner)); });
+		b.addField<float >("x"    , [](const void*) { return ptrdiff_t(offsetof(ReloadV2, x    )); });
+		b.addField<float >("y"    , [](const void*) { return ptrdiff_t(offsetof(ReloadV2, y    )); });
+		b.addField<float >("z"    , [](const void*) { return ptrdiff_t(offsetof(ReloadV2, z    )); });
+		b.addField<int   >("id"   , [](const void*) { return ptrdiff_t(offsetof(ReloadV2, id   )); });
+		b.addField<double>("mass" , [](const void*) { return ptrdiff_t(offsetof(ReloadV2, mass )); });
+		b.registerType(&m);
+	}
+	TypeInfo oldType = *m.lookupType(TypeName::create<ReloadV1>());
+	TypeInfo newType = *m.lookupType(TypeName::create<ReloadV2>());
+	newType.name = oldType.name; //Pretend it's the same type, post-reload
+	return { oldType, newType };
+}
+
+BENCHMARK_CASE("ObjectPatch: reload type with live objects")
+{
+	auto [oldType, newType] = createReloadTypes();
+
+	constexpr size_t n = 100000;
+
+	{
+		ObjectPatch patch = ObjectPatch::create(oldType, newType);
+		RawMemoryPool pool(n, std::max(sizeof(ReloadV1), sizeof(ReloadV2)), alignof(ReloadV2));
+		for (size_t i = 0; i < n; ++i) new (pool.allocate()) ReloadV1();
+
+		bench::Stopwatch t;
+		pool.foreachLive([&](void* obj) { patch.apply(obj); });
+		bench::report("apply (plan only)", n, t.elapsedNs(), n);
+	}
+
+	{
+		bench::Stopwatch t;
+		ObjectPatch patch = ObjectPatch::create(oldType, newType);
+		bench::report("create (once per type)", n, t.elapsedNs(), 1);
+		bench::doNotOptimize(patch);
+	}
+
+	{
+		GenericTypedMemoryPool* pool = GenericTypedMemoryPool::create<ReloadV1>(n);
+		pool->refreshObjects(oldType, nullptr);
+		std::vector<void*> objs(n);
+		for (size_t i = 0; i < n; ++i) objs[i] = pool->getView<ReloadV1>()->emplace();
+
+		MemoryMapper remapper;
+		bench::Stopwatch t;
+		pool->refreshObjects(newType, &remapper);
+		bench::report("refreshObjects (resize + apply + log)", n, t.elapsedNs(), n);
+
+		for (void* obj : objs) pool->release(remapper.transformAddress(obj, sizeof(ReloadV2)));
+		delete pool;
+	}
+}
+
+BENCHMARK_CASE("ObjectPatch: refreshObjects scaling")
+{
+	auto [oldType, newType] = createReloadTypes();
+
+	for (size_t n : bench::sizes())
+	{
+		GenericTypedMemoryPool* pool = GenericTypedMemoryPool::create<ReloadV1>(n);
+		pool->refreshObjects(oldType, nullptr);
+		std::vector<void*> objs(n);
+		for (size_t i = 0; i < n; ++i) objs[i] = pool->getView<ReloadV1>()->emplace();
+
+		MemoryMapper remapper;
+		bench::Stopwatch t;
+		pool->refreshObjects(newType, &remapper);
+		bench::report("refreshObjects", n, t, n, double(sizeof(ReloadV1) + sizeof(ReloadV2)));
+
+		for (void* obj : objs) pool->release(remapper.transformAddress(obj, sizeof(ReloadV2)));
+		delete pool;
+	}
+}
@@ -0,0 +1,220 @@
+#include "Benchmark.hpp"
+
+#include <vector>
+#include <functional>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+
+#include "ModuleTypeRegistry.hpp"
+#include "GlobalTypeRegistry.hpp"
+#include "TypeBuilder.hpp"
+
+#include "MemoryManager.hpp"
+#include "PoolCallBatcher.hpp"
+
+//Same shape as IUpdatable in engine-core
+class BenchUpdatable
+{
+public:
+	virtual ~BenchUpdatable() {}
+	virtual void Update() = 0;
+};
+
+class BenchMover : public BenchUpdatable
+{
+public:
+	float x = 0, v = 1;
+	virtual void Update() override { x += v; }
+};
+
+//ObjectSpinner-style: a little math on its own data only
+class BenchSpinner : public BenchUpdatable
+{
+public:
+	float rot[4] = { 0, 0, 0, 1 };
+	float spin[4] = { 0.01f, 0.02f, 0.005f, 0.9997f };
+	virtual void Update() override
+	{
+		//Quaternion multiply, then renormalize
+		float x = spin[3]*rot[0] + spin[0]*rot[3] + spin[1]*rot[2] - spin[2]*rot[1];
+		float y = spin[3]*rot[1] - spin[0]*rot[2] + spin[1]*rot[3] + spin[2]*rot[0];
+		float z = spin[3]*rot[2] + spin[0]*rot[1] - spin[1]*rot[0] + spin[2]*rot[3];
+		float w = spin[3]*rot[3] - spin[0]*rot[0] - spin[1]*rot[1] - spin[2]*rot[2];
+		float invLen = 1.0f / std::sqrt(x*x + y*y + z*z + w*w);
+		rot[0] = x*invLen; rot[1] = y*invLen; rot[2] = z*invLen; rot[3] = w*invLen;
+	}
+};
+template<> struct is_parallel_safe<BenchSpinner> : std::true_type {};
+
+//Reproduces the original iteration strategy: std::function per object, with type lookup and cast per object
+class LegacyPoolCallBatcher : public PoolCallBatcher<BenchUpdatable>
+{
+public:
+	void foreachLegacy(const std::function<void(void*)>& visitor) const
+	{
+		for (const CachedPool& i : cachedPoolList)
+		{
+			if (!skipUnloaded || i.pool->isLoaded())
+			{
+				i.pool->foreachLive([&](void* obj) { visitor(i.pool->getContentsType()->layout.upcast(obj, i.caster)); });
+			}
+		}
+	}
+};
+
+BENCHMARK_CASE("PoolCallBatcher: Update() on 100k objects")
+{
+	{
+		GlobalTypeRegistry::clear();
+		ModuleTypeRegistry m;
+		TypeBuilder::create<BenchUpdatable>().registerType(&m);
+		{
+			TypeBuilder b = TypeBuilder::create<BenchMover>();
+			b.addParent<BenchMover, BenchUpdatable>(MemberVisibility::Public, ParentInfo::Virtualness::NonVirtual);
+			b.registerType(&m);
+		}
+		GlobalTypeRegistry::loadModule("PoolCallBatcher bench", m);
+	}
+
+	constexpr size_t n = 100000;
+	constexpr size_t nPasses = 20;
+
+	{
+		MemoryManager memory;
+		memory.createPool<BenchMover>(RawMemoryPool::StorageMode::Paged);
+		std::vector<BenchUpdatable*> objs(n);
+		for (size_t i = 0; i < n; ++i) objs[i] = memory.create<BenchMover>();
+		memory.ensureFresh();
+
+		LegacyPoolCallBatcher batcher;
+		batcher.ensureFresh(&memory);
+
+		{
+			bench::Stopwatch t;
+			for (size_t pass = 0; pass < nPasses; ++pass) for (BenchUpdatable* o : objs) o->Update();
+			bench::report("baseline: vector of pointers", n, t.elapsedNs(), n*nPasses);
+		}
+
+		{
+			bench::Stopwatch t;
+			for (size_t pass = 0; pass < nPasses; ++pass) batcher.foreachLegacy([](void* o) { static_cast<BenchUpdatable*>(o)->Update(); });
+			bench::report("std::function, cast per object", n, t.elapsedNs(), n*nPasses);
+		}
+
+		{
+			bench::Stopwatch t;
+			for (size_t pass = 0; pass < nPasses; ++pass) batcher.memberCall(&BenchUpdatable::Update);
+			bench::report("memberCall (inlined)", n, t.elapsedNs(), n*nPasses);
+		}
+
+		{
+			bench::Stopwatch t;
+			for (size_t pass = 0; pass < nPasses; ++pass) batcher.staticCall([](BenchUpdatable* o) { o->Update(); });
+			bench::report("staticCall (inlined)", n, t.elapsedNs(), n*nPasses);
+		}
+
+		bench::doNotOptimize(static_cast<BenchMover*>(objs[0])->x);
+		for (BenchUpdatable* o : objs) memory.destroy(o);
+	}
+
+	GlobalTypeRegistry::clear();
+}
+
+BENCHMARK_CASE("PoolCallBatcher: parallel Update() on 200k objects")
+{
+	{
+		GlobalTypeRegistry::clear();
+		ModuleTypeRegistry m;
+		TypeBuilder::create<BenchUpdatable>().registerType(&m);
+		{
+			TypeBuilder b = TypeBuilder::create<BenchSpinner>();
+			b.addParent<BenchSpinner, BenchUpdatable>(MemberVisibility::Public, ParentInfo::Virtualness::NonVirtual);
+			b.registerType(&m);
+		}
+		GlobalTypeRegistry::loadModule("PoolCallBatcher bench", m);
+	}
+
+	constexpr size_t n = 200000;
+	constexpr size_t nPasses = 20;
+
+	{
+		MemoryManager memory;
+		memory.createPool<BenchSpinner>(RawMemoryPool::StorageMode::Paged);
+		std::vector<BenchUpdatable*> objs(n);
+		for (size_t i = 0; i < n; ++i) objs[i] = memory.create<BenchSpinner>();
+		memory.ensureFresh();
+
+		PoolCallBatcher<BenchUpdatable> batcher;
+		batcher.ensureFresh(&memory);
+
+		{
+			bench::Stopwatch t;
+			for (size_t pass = 0; pass < nPasses; ++pass) batcher.memberCall(&BenchUpdatable::Update);
+			bench::report("memberCall (serial)", n, t.elapsedNs(), n*nPasses);
+		}
+
+		size_t maxWorkers = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+		for (size_t nWorkers : { 0, 1, 3, 7, 15 })
+		{
+			if (nWorkers > maxWorkers && nWorkers != 0) continue;
+
+			JobSystem jobs(nWorkers);
+			char label[64];
+			snprintf(label, sizeof(label), "parallelMemberCall, %zu workers", nWorkers);
+
+			bench::Stopwatch t;
+			for (size_t pass = 0; pass < nPasses; ++pass) batcher.parallelMemberCall(&jobs, &BenchUpdatable::Update);
+			bench::report(label, n, t.elapsedNs(), n*nPasses);
+		}
+
+		bench::doNotOptimize(static_cast<BenchSpinner*>(objs[0])->rot[0]);
+		for (BenchUpdatable* o : objs) memory.destroy(o);
+	}
+
+	GlobalTypeRegistry::clear();
+}
+
+BENCHMARK_CASE("PoolCallBatcher: memberCall dispatch scaling")
+{
+	{
+		GlobalTypeRegistry::clear();
+		ModuleTypeRegistry m;
+		TypeBuilder::create<BenchUpdatable>().registerType(&m);
+		{
+			TypeBuilder b = TypeBuilder::create<BenchMover>();
+			b.addParent<BenchMover, BenchUpdatable>(MemberVisibility::Public, ParentInfo::Virtualness::NonVirtual);
+			b.registerType(&m);
+		}
+		GlobalTypeRegistry::loadModule("PoolCallBatcher bench", m);
+	}
+
+	for (size_t n : bench::sizes())
+	{
+		size_t nPasses = std::max<size_t>(4000000 / n, 1); //Keep total work roughly constant
+
+		MemoryManager memory;
+		memory.createPool<BenchMover>(RawMemoryPool::StorageMode::Paged);
+		std::vector<BenchUpdatable*> objs(n);
+		for (size_t i = 0; i < n; ++i) objs[i] = memory.create<BenchMover>();
+		memory.ensureFresh();
+
+		PoolCallBatcher<BenchUpdatable> batcher;
+		{
+			bench::Stopwatch t;
+			batcher.ensureFresh(&memory);
+			bench::report("ensureFresh", n, t, 1);
+		}
+
+		{
+			bench::Stopwatch t;
+			for (size_t pass = 0; pass < nPasses; ++pass) batcher.memberCall(&BenchUpdatable::Update);
+			bench::report("memberCall", n, t, n*nPasses, sizeof(BenchMover));
+		}
+
+		bench::doNotOptimize(static_cast<BenchMover*>(objs[0])->x);
+		for (BenchUpdatable* o : objs) memory.destroy(o);
+	}
+
+	GlobalTypeRegistry::clear();
+}
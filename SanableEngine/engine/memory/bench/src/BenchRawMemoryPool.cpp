@@ -0,0 +1,286 @@
+#include "Benchmark.hpp"
+
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <mutex>
+
+#include "RawMemoryPool.hpp"
+
+//Reproduces the original allocation strategy: walk every slot from id 0 until a free one is found
+class LinearScanMemoryPool : public RawMemoryPool
+{
+public:
+	LinearScanMemoryPool(size_t maxNumObjects, size_t objectSize, size_t objectAlign) : RawMemoryPool(maxNumObjects, objectSize, objectAlign) {}
+
+	void* allocateLinear()
+	{
+		if (mNumAllocatedObjects >= mMaxNumObjects) return nullptr;
+		mNumAllocatedObjects++;
+
+		id_t id = 0;
+		void* ptr;
+		for (ptr = idToPtr(id); contains(ptr); ptr = idToPtr(++id))
+		{
+			if (!isAlive(ptr)) break;
+		}
+
+		setAlive(id, true);
+		return ptr;
+	}
+
+	//Original iteration strategy: test every slot one bit at a time
+	template<typename TFunc>
+	void foreachLinear(TFunc&& visitor) const
+	{
+		for (id_t id = 0; id < mMaxNumObjects; ++id) if (isAliveById(id)) visitor(idToPtr(id));
+	}
+};
+
+static constexpr size_t poolSizes[] = { 1<<10, 1<<16, 1<<20 };
+static constexpr size_t objectSize = 16;
+
+//Linear scan is quadratic to fill, so past this size only steady-state churn is measured
+static constexpr size_t maxLinearFillSize = 1<<16;
+
+BENCHMARK_CASE("RawMemoryPool: fill empty pool")
+{
+	for (size_t n : poolSizes)
+	{
+		std::vector<void*> objs(n);
+
+		{
+			RawMemoryPool pool(n, objectSize, alignof(std::max_align_t));
+			bench::Stopwatch t;
+			for (size_t i = 0; i < n; ++i) objs[i] = pool.allocate();
+			bench::report("allocate() x n", n, t.elapsedNs(), n);
+			bench::doNotOptimize(objs[n-1]);
+		}
+
+		{
+			RawMemoryPool pool(n, objectSize, alignof(std::max_align_t));
+			bench::Stopwatch t;
+			size_t nAllocated = pool.allocate(n, objs.data());
+			bench::report("allocate(n, out)", n, t.elapsedNs(), nAllocated);
+			bench::doNotOptimize(objs[n-1]);
+		}
+
+		if (n <= maxLinearFillSize)
+		{
+			LinearScanMemoryPool pool(n, objectSize, alignof(std::max_align_t));
+			bench::Stopwatch t;
+			for (size_t i = 0; i < n; ++i) objs[i] = pool.allocateLinear();
+			bench::report("linear scan (old) x n", n, t.elapsedNs(), n);
+			bench::doNotOptimize(objs[n-1]);
+		}
+	}
+}
+
+BENCHMARK_CASE("RawMemoryPool: churn in nearly-full pool")
+{
+	for (size_t n : poolSizes)
+	{
+		//Release a random object, then allocate to replace it
+		size_t nOps = std::min<size_t>(n, 4096);
+		std::mt19937 rng(12345);
+		std::vector<size_t> victims(nOps);
+		for (size_t& v : victims) v = std::uniform_int_distribution<size_t>(0, n-1)(rng);
+		std::vector<void*> objs(n);
+
+		{
+			RawMemoryPool pool(n, objectSize, alignof(std::max_align_t));
+			(void)pool.allocate(n, objs.data());
+			bench::Stopwatch t;
+			for (size_t v : victims)
+			{
+				pool.release(objs[v]);
+				objs[v] = pool.allocate();
+			}
+			bench::report("release + allocate()", n, t.elapsedNs(), nOps);
+		}
+
+		{
+			LinearScanMemoryPool pool(n, objectSize, alignof(std::max_align_t));
+			(void)pool.allocate(n, objs.data());
+			bench::Stopwatch t;
+			for (size_t v : victims)
+			{
+				pool.release(objs[v]);
+				objs[v] = pool.allocateLinear();
+			}
+			bench::report("release + linear scan (old)", n, t.elapsedNs(), nOps);
+		}
+	}
+}
+
+BENCHMARK_CASE("RawMemoryPool: grow from empty")
+{
+	for (size_t n : poolSizes)
+	{
+		//Contiguous pools can't grow by themselves, so double manually. Every growth copies everything.
+		{
+			RawMemoryPool pool(1, objectSize, alignof(std::max_align_t));
+			bench::Stopwatch t;
+			for (size_t i = 0; i < n; ++i)
+			{
+				if (!pool.getNumFreeObjects()) pool.setMaxNumObjects(pool.getMaxNumObjects()*2);
+				bench::doNotOptimize(pool.allocate());
+			}
+			bench::report("Contiguous (manual doubling)", n, t.elapsedNs(), n);
+		}
+
+		{
+			RawMemoryPool pool(0, objectSize, alignof(std::max_align_t), RawMemoryPool::StorageMode::Paged);
+			bench::Stopwatch t;
+			for (size_t i = 0; i < n; ++i) bench::doNotOptimize(pool.allocate());
+			bench::report("Paged", n, t.elapsedNs(), n);
+		}
+
+		{
+			RawMemoryPool pool(0, objectSize, alignof(std::max_align_t), RawMemoryPool::StorageMode::Reserved);
+			bench::Stopwatch t;
+			for (size_t i = 0; i < n; ++i) bench::doNotOptimize(pool.allocate());
+			bench::report("Reserved", n, t.elapsedNs(), n);
+		}
+	}
+}
+
+BENCHMARK_CASE("RawMemoryPool: iterate sparse pool")
+{
+	constexpr size_t n = 1<<20;
+	constexpr int livePercents[] = { 1, 10, 50, 100 };
+	for (int livePercent : livePercents)
+	{
+		LinearScanMemoryPool pool(n, objectSize, alignof(std::max_align_t));
+		std::vector<void*> objs(n);
+		(void)pool.allocate(n, objs.data());
+		std::mt19937 rng(12345);
+		for (void* obj : objs) if (int(rng() % 100) >= livePercent) pool.release(obj);
+		size_t nLive = pool.getNumAllocatedObjects();
+		printf("  (%d%% live)\n", livePercent);
+
+		{
+			size_t sum = 0;
+			bench::Stopwatch t;
+			pool.foreachLinear([&](void* obj) { sum += *(size_t*)obj; });
+			bench::report("bit at a time (old)", n, t.elapsedNs(), nLive);
+			bench::doNotOptimize(sum);
+		}
+
+		{
+			size_t sum = 0;
+			bench::Stopwatch t;
+			for (auto it = pool.cbegin(); it != pool.cend(); ++it) sum += *(size_t*)*it;
+			bench::report("const_iterator", n, t.elapsedNs(), nLive);
+			bench::doNotOptimize(sum);
+		}
+
+		{
+			size_t sum = 0;
+			bench::Stopwatch t;
+			pool.foreachLive([&](void* obj) { sum += *(size_t*)obj; });
+			bench::report("foreachLive", n, t.elapsedNs(), nLive);
+			bench::doNotOptimize(sum);
+		}
+	}
+}
+
+BENCHMARK_CASE("RawMemoryPool: concurrent allocate + release")
+{
+	constexpr size_t threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+	constexpr size_t nRounds = 4; //Deferred frees are flushed between rounds, like once per frame
+	constexpr size_t nOpsPerThread = 20000;
+	constexpr size_t nLiveAtOnce = 16;
+
+	//Allocate a few, then release them, over and over
+	auto churn = [](auto&& allocate, auto&& release)
+	{
+		void* objs[nLiveAtOnce];
+		for (size_t i = 0; i < nOpsPerThread; i += nLiveAtOnce)
+		{
+			for (void*& obj : objs) obj = allocate();
+			for (void*  obj : objs) release(obj);
+		}
+	};
+
+	for (size_t nThreads : threadCounts)
+	{
+		size_t nOps = nThreads * nOpsPerThread * nRounds;
+
+		{
+			RawMemoryPool pool(0, objectSize, alignof(std::max_align_t), RawMemoryPool::StorageMode::Reserved);
+			std::mutex lock;
+			double totalNs = 0;
+			for (size_t r = 0; r < nRounds; ++r)
+			{
+				std::vector<std::thread> threads;
+				bench::Stopwatch t;
+				for (size_t i = 0; i < nThreads; ++i) threads.emplace_back([&]() {
+					churn(
+						[&]() { std::lock_guard<std::mutex> guard(lock); return pool.allocate(); },
+						[&](void* obj) { std::lock_guard<std::mutex> guard(lock); pool.release(obj); }
+					);
+				});
+				for (std::thread& th : threads) th.join();
+				totalNs += t.elapsedNs();
+			}
+			bench::report("global mutex", nThreads, totalNs, nOps);
+		}
+
+		{
+			RawMemoryPool pool(0, objectSize, alignof(std::max_align_t), RawMemoryPool::StorageMode::Reserved);
+			pool.setThreadSafe(true);
+			double totalNs = 0;
+			for (size_t r = 0; r < nRounds; ++r)
+			{
+				std::vector<std::thread> threads;
+				bench::Stopwatch t;
+				for (size_t i = 0; i < nThreads; ++i) threads.emplace_back([&]() {
+					churn(
+						[&]() { return pool.allocate(); },
+						[&](void* obj) { pool.release(obj); }
+					);
+				});
+				for (std::thread& th : threads) th.join();
+				pool.flushDeferred();
+				totalNs += t.elapsedNs();
+			}
+			bench::report("thread-safe (thread caches)", nThreads, totalNs, nOps);
+		}
+	}
+}
+
+BENCHMARK_CASE("RawMemoryPool: allocate/iterate/release scaling")
+{
+	constexpr size_t bodySize = 64; //One cache line per object
+	for (size_t n : bench::sizes())
+	{
+		RawMemoryPool pool(n, bodySize, alignof(std::max_align_t));
+		std::vector<void*> objs(n);
+
+		{
+			bench::Stopwatch t;
+			for (size_t i = 0; i < n; ++i) objs[i] = pool.allocate();
+			bench::report("allocate", n, t, n);
+		}
+		for (void* obj : objs) memset(obj, 1, bodySize);
+
+		{
+			size_t sum = 0;
+			bench::Stopwatch t;
+			pool.foreachLive([&](void* obj) { sum += *(size_t*)obj; });
+			bench::report("iterate (foreachLive)", n, t, n, bodySize);
+			bench::doNotOptimize(sum);
+		}
+
+		std::shuffle(objs.begin(), objs.end(), std::mt19937(12345));
+		{
+			bench::Stopwatch t;
+			for (void* obj : objs) pool.release(obj);
+			bench::report("release (random order)", n, t, n);
+		}
+	}
+}
@@ -0,0 +1,91 @@
+#include "Benchmark.hpp"
+
+#include <utility>
+#include <vector>
+
+#include "MemoryManager.hpp"
+
+//Stand-in for a plugin full of small component types, 8-64 bytes each
+template<size_t N>
+struct ManySmall
+{
+	char data[8 + (N%8)*8];
+};
+
+constexpr size_t nTypes = 150;
+constexpr size_t nPerType = 5;
+
+template<size_t... Ns>
+static void createAll(MemoryManager& memory, bool shared, std::index_sequence<Ns...>)
+{
+	for (size_t i = 0; i < nPerType; ++i)
+	{
+		if (shared) (memory.createShared<ManySmall<Ns>>(), ...);
+		else (memory.create<ManySmall<Ns>>(), ...);
+	}
+}
+
+template<size_t... Ns>
+static size_t iterateAll(MemoryManager& memory, bool shared, std::index_sequence<Ns...>)
+{
+	size_t sum = 0;
+	if (shared) (memory.getSizeClasses()->foreach<ManySmall<Ns>>([&](ManySmall<Ns>* o) { sum += o->data[0]; }), ...);
+	else (memory.getSpecificPool<ManySmall<Ns>>(false)->foreachLive([&](void* o) { sum += ((ManySmall<Ns>*)o)->data[0]; }), ...);
+	return sum;
+}
+
+template<size_t N>
+static void destroyType(MemoryManager& memory)
+{
+	std::vector<ManySmall<N>*> objs;
+	memory.getSpecificPool<ManySmall<N>>(false)->foreachLive([&](void* o) { objs.push_back((ManySmall<N>*)o); });
+	for (ManySmall<N>* o : objs) memory.destroy(o);
+}
+
+template<size_t... Ns>
+static void destroyAll(MemoryManager& memory, std::index_sequence<Ns...>)
+{
+	(destroyType<Ns>(memory), ...);
+}
+
+BENCHMARK_CASE("SizeClassAllocator: 150 small types, 5 objects each")
+{
+	auto types = std::make_index_sequence<nTypes>();
+
+	{
+		MemoryManager memory;
+		bench::Stopwatch t;
+		createAll(memory, false, types);
+		bench::report("create (pool per type)", nTypes*nPerType, t.elapsedNs(), nTypes*nPerType);
+
+		size_t nPools = 0;
+		size_t bytes = 0;
+		memory.foreachPool([&](const GenericTypedMemoryPool* p) { ++nPools; bytes += p->getStorageBytes(); });
+		printf("  %-40s %zu pools, %zu bytes\n", "", nPools, bytes);
+
+		bench::Stopwatch t2;
+		size_t sum = 0;
+		for (int i = 0; i < 100; ++i) sum += iterateAll(memory, false, types);
+		bench::report("iterate each type (pool per type)", nTypes*nPerType, t2.elapsedNs(), nTypes*nPerType*100);
+		bench::doNotOptimize(sum);
+
+		destroyAll(memory, types);
+	}
+
+	{
+		MemoryManager memory;
+		bench::Stopwatch t;
+		createAll(memory, true, types);
+		bench::report("create (size classes)", nTypes*nPerType, t.elapsedNs(), nTypes*nPerType);
+
+		size_t nPools = 0;
+		memory.foreachPool([&](const GenericTypedMemoryPool*) { ++nPools; });
+		printf("  %-40s %zu pools, %zu size classes, %zu bytes\n", "", nPools, memory.getSizeClasses()->getSizeClassCount(), memory.getSizeClasses()->getStorageBytes());
+
+		bench::Stopwatch t2;
+		size_t sum = 0;
+		for (int i = 0; i < 100; ++i) sum += iterateAll(memory, true, types);
+		bench::report("iterate each type (size classes)", nTypes*nPerType, t2.elapsedNs(), nTypes*nPerType*100);
+		bench::doNotOptimize(sum);
+	}
+}
@@ -0,0 +1,101 @@
+#include "Benchmark.hpp"
+
+#include <cstddef>
+
+#include "ModuleTypeRegistry.hpp"
+#include "TypeBuilder.hpp"
+
+#include "RawMemoryPool.hpp"
+#include "SoAMemoryPool.hpp"
+
+//Typical transform-like component: a few hot floats buried among cold data
+struct BenchTransform
+{
+	float px, py, pz;
+	float vx, vy, vz;
+	float rotation[4];
+	float scale[3];
+	void* owner;
+	int flags;
+	char name[32];
+};
+
+BENCHMARK_CASE("SoAMemoryPool: transform update, AoS vs SoA")
+{
+	ModuleTypeRegistry m;
+	{
+		TypeBuilder b = TypeBuilder::create<BenchTransform>();
+		b.addField<float>("px", [](const void*) { return ptrdiff_t(offsetof(BenchTransform, px)); });
+		b.addField<float>("py", [](const void*) { return ptrdiff_t(offsetof(BenchTransform, py)); });
+		b.addField<float>("pz", [](const void*) { return ptrdiff_t(offsetof(BenchTransform, pz)); });
+		b.addField<float>("vx", [](const void*) { return ptrdiff_t(offsetof(BenchTransform, vx)); });
+		b.addField<float>("vy", [](const void*) { return ptrdiff_t(offsetof(BenchTransform, vy)); });
+		b.addField<float>("vz", [](const void*) { return ptrdiff_t(offsetof(BenchTransform, vz)); });
+		b.addField<float[4]>("rotation", [](const void*) { return ptrdiff_t(offsetof(BenchTransform, rotation)); });
+		b.addField<float[3]>("scale"   , [](const void*) { return ptrdiff_t(offsetof(BenchTransform, scale   )); });
+		b.addField<void*>("owner", [](const void*) { return ptrdiff_t(offsetof(BenchTransform, owner)); });
+		b.addField<int  >("flags", [](const void*) { return ptrdiff_t(offsetof(BenchTransform, flags)); });
+		b.addField<char[32]>("name", [](const void*) { return ptrdiff_t(offsetof(BenchTransform, name)); });
+		b.registerType(&m);
+	}
+	const TypeInfo& type = *m.lookupType(TypeName::create<BenchTransform>());
+
+	constexpr size_t n = 1000000;
+	constexpr int nFrames = 10;
+	constexpr float dt = 1.0f / 60;
+	BenchTransform init = {};
+	init.vx = 1;
+	init.vy = 2;
+	init.vz = 3;
+
+	//Baseline: whole objects, pos += vel*dt
+	{
+		RawMemoryPool pool(n, sizeof(BenchTransform), alignof(BenchTransform));
+		for (size_t i = 0; i < n; ++i) new (pool.allocate()) BenchTransform(init);
+
+		bench::Stopwatch t;
+		for (int f = 0; f < nFrames; ++f)
+		{
+			pool.foreachLiveSpan(
+				[&](const RawMemoryPool::LiveSpan& span)
+				{
+					BenchTransform* objs = (BenchTransform*)span.first;
+					for (size_t i = 0; i < span.count; ++i)
+					{
+						objs[i].px += objs[i].vx * dt;
+						objs[i].py += objs[i].vy * dt;
+						objs[i].pz += objs[i].vz * dt;
+					}
+				}
+			);
+		}
+		bench::report("AoS (RawMemoryPool)", n, t.elapsedNs(), n*nFrames);
+		bench::doNotOptimize(*(BenchTransform*)*pool.cbegin());
+	}
+
+	//Same update over hot columns only
+	{
+		SoAMemoryPool pool(type, { "px", "py", "pz", "vx", "vy", "vz" }, n);
+		for (size_t i = 0; i < n; ++i) pool.insert(&init);
+
+		bench::Stopwatch t;
+		for (int f = 0; f < nFrames; ++f)
+		{
+			float* px = pool.getColumn<float>("px").data;
+			float* py = pool.getColumn<float>("py").data;
+			float* pz = pool.getColumn<float>("pz").data;
+			const float* vx = pool.getColumn<float>("vx").data;
+			const float* vy = pool.getColumn<float>("vy").data;
+			const float* vz = pool.getColumn<float>("vz").data;
+			size_t count = pool.size();
+			for (size_t i = 0; i < count; ++i)
+			{
+				px[i] += vx[i] * dt;
+				py[i] += vy[i] * dt;
+				pz[i] += vz[i] * dt;
+			}
+		}
+		bench::report("SoA (SoAMemoryPool)", n, t.elapsedNs(), n*nFrames);
+		bench::doNotOptimize(pool.getColumn<float>("px")[0]);
+	}
+}
@@ -0,0 +1,37 @@
+#include "Benchmark.hpp"
+
+#include <cstring>
+#include <cstdlib>
+
+//Usage: engine-memory-bench [filter] [--json out.json] [--max-n N]
+// filter: only run cases whose name contains this
+// --json: also write every result to a file, for tracking regressions
+// --max-n: cap object counts for scaling cases (default 1M)
+int main(int argc, char** argv)
+{
+	const char* filter = nullptr;
+	const char* jsonPath = nullptr;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "--json") && i+1 < argc) jsonPath = argv[++i];
+		else if (!strcmp(argv[i], "--max-n") && i+1 < argc) bench::maxN() = strtoull(argv[++i], nullptr, 10);
+		else filter = argv[i];
+	}
+
+	if (!bench::CacheMissCounter::get().isAvailable()) printf("(Cache miss counters unavailable)\n");
+
+	for (const bench::Case& c : bench::registry())
+	{
+		if (filter && !strstr(c.name, filter)) continue;
+		printf("%s\n", c.name);
+		bench::currentCase() = c.name;
+		c.fn();
+	}
+
+	if (jsonPath && !bench::writeJson(jsonPath))
+	{
+		printf("ERROR: Couldn't write %s\n", jsonPath);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,36 @@
+#include "HeapCounter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+//Replaces global operator new/delete to feed HeapCounter. Only linked into final executables, and only
+//when SANABLE_COUNT_HEAP_ALLOCS is on (see memory/CMakeLists.txt), so plugins and libraries never carry it.
+//Aligned forms are left to the standard library, which frees them separately, so they aren't counted.
+//MSVC debug builds count with a CRT alloc hook instead, see HeapCounter.cpp.
+
+#if !_MSC_VER
+
+static struct MarkAvailable
+{
+	MarkAvailable() { HeapCounter::setHooked(); }
+} markAvailable;
+
+static void* countedAlloc(size_t size)
+{
+	HeapCounter::recordAlloc();
+	return malloc(size ? size : 1);
+}
+
+void* operator new  (size_t size) { if (void* p = countedAlloc(size)) return p; throw std::bad_alloc(); }
+void* operator new[](size_t size) { if (void* p = countedAlloc(size)) return p; throw std::bad_alloc(); }
+void* operator new  (size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+
+void operator delete  (void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete  (void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete  (void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+
+#endif
@@ -5,6 +5,7 @@
 #define ALIGNED_ALLOC(size, align) _aligned_malloc(size, align)
 #define ALIGNED_FREE(obj) _aligned_free(obj)
 #else
-#define ALIGNED_ALLOC(size, align) ::std::aligned_alloc(size, align)
+#include <cstdlib>
+#define ALIGNED_ALLOC(size, align) ::std::aligned_alloc(align, ((size)+(align)-1)/(align)*(align)) //Size must be a multiple of alignment
 #define ALIGNED_FREE(obj) ::std::free(obj)
 #endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+#if _MSC_VER
+#include <intrin.h>
+#endif
+
+//Word type used by the living list bitset. Scanning is done a word at a time.
+typedef uint64_t bitword_t;
+constexpr size_t BITS_PER_WORD = sizeof(bitword_t)*8;
+constexpr bitword_t BITWORD_FULL = ~bitword_t(0);
+
+inline size_t bitwordCount(size_t nBits) { return (nBits + BITS_PER_WORD - 1) / BITS_PER_WORD; }
+
+//Index of lowest set bit. Undefined if word is 0.
+inline size_t bitCountTrailingZeros(bitword_t word)
+{
+#if _MSC_VER && (_M_X64 || _M_ARM64)
+	unsigned long idx;
+	_BitScanForward64(&idx, word);
+	return idx;
+#elif _MSC_VER
+	unsigned long idx;
+	if (_BitScanForward(&idx, (unsigned long)word)) return idx;
+	_BitScanForward(&idx, (unsigned long)(word >> 32));
+	return idx + 32;
+#else
+	return __builtin_ctzll(word);
+#endif
+}
+
+//Index of highest set bit. Undefined if word is 0.
+inline size_t bitIndexOfHighest(bitword_t word)
+{
+#if _MSC_VER && (_M_X64 || _M_ARM64)
+	unsigned long idx;
+	_BitScanReverse64(&idx, word);
+	return idx;
+#elif _MSC_VER
+	unsigned long idx;
+	if (_BitScanReverse(&idx, (unsigned long)(word >> 32))) return idx + 32;
+	_BitScanReverse(&idx, (unsigned long)word);
+	return idx;
+#else
+	return BITS_PER_WORD-1 - __builtin_clzll(word);
+#endif
+}
+
+//Number of set bits
+inline size_t bitCountSet(bitword_t word)
+{
+#if _MSC_VER
+	size_t n = 0;
+	for (; word; word &= word-1) ++n;
+	return n;
+#else
+	return __builtin_popcountll(word);
+#endif
+}
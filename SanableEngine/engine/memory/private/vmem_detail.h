@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Thin wrapper over the OS virtual memory API. Reserved address space isn't
+//backed by physical memory until committed.
+
+#if (_WIN32 || __unix__ || __APPLE__) && !__EMSCRIPTEN__
+#define VMEM_SUPPORTED 1
+#else
+#define VMEM_SUPPORTED 0
+#endif
+
+size_t vmemPageSize();
+
+//Returns null on failure, or if not supported on this platform. Alignment must be a power of two.
+//trackWrites: allow vmemCollectWrites on this range. Best-effort: the reservation still succeeds if tracking can't be set up.
+void* vmemReserve(size_t bytes, size_t align, bool trackWrites = false);
+void vmemRelease(void* base, size_t bytes);
+
+//Ranges must be page-aligned and inside a reservation
+bool vmemCommit(void* ptr, size_t bytes);
+void vmemDecommit(void* ptr, size_t bytes);
+
+//Hint that a reservation should be backed by huge pages (Linux THP). Returns false if unsupported.
+bool vmemAdviseHugePages(void* base, size_t bytes);
+
+//Range must be page-aligned, committed, and inside a reservation made with trackWrites.
+//Sets out to one bit per page, set if the page was written since the last call (every page counts as written on the first call),
+//then starts tracking over. Returns false if tracking is unavailable, in which case out is meaningless and every page must be
+//assumed written.
+//Windows: GetWriteWatch. Linux 6.7+: PAGEMAP_SCAN over userfaultfd async write-protect, so each page costs one minor fault on
+//its first write after a call. Nothing is write-protected until the first call, so ranges nobody asks about cost nothing.
+bool vmemCollectWrites(void* ptr, size_t bytes, std::vector<uint64_t>& out);
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#include "RawMemoryPool.hpp"
+#include "TypeInfo.hpp"
+
+//Entity-component storage grouped by archetype: all entities with exactly the same set of component types share one table.
+//Tables are split into fixed-size chunks, each holding a densely packed column per component type, so queries walk memory
+//front to back and only touch the columns they ask for.
+//Adding or removing a component moves the entity to another table. Components are moved bitwise, same as pool compaction,
+//so pointers to them only last until that entity's next structural change. Hold an Entity instead.
+//Any destructible type can be a component, including existing Component classes. Lives alongside pools, not instead of them.
+//Not thread-safe: make structural changes at a sync point. Not reload-safe: layouts aren't patched if a type changes.
+class ArchetypeStorage
+{
+public:
+	static constexpr size_t CHUNK_BYTES = 16 * 1024;
+	static constexpr size_t COLUMN_ALIGN = 64; //Every column starts on a cache line
+
+	//Generational reference to an entity. Stops resolving once it's destroyed, even if its index is reused since.
+	struct Entity
+	{
+		uint32_t index = 0;
+		uint32_t generation = 0; //0 = null
+
+		inline bool isNull() const { return generation == 0; }
+		inline bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+		inline bool operator!=(const Entity& other) const { return !(*this == other); }
+	};
+
+	typedef uint16_t typeid_t; //Dense index of a component type, only meaningful to the storage that assigned it
+
+	ENGINEMEM_API ArchetypeStorage();
+	ENGINEMEM_API ~ArchetypeStorage(); //Destroys remaining entities
+
+	ArchetypeStorage(const ArchetypeStorage&) = delete;
+	ArchetypeStorage& operator=(const ArchetypeStorage&) = delete;
+
+	//Entities start out with no components
+	ENGINEMEM_API Entity create();
+	ENGINEMEM_API void destroy(Entity entity); //Calls every component's dtor. Does nothing if already destroyed.
+	ENGINEMEM_API bool isAlive(Entity entity) const;
+	ENGINEMEM_API void clear(); //Destroys every entity. Tables, types and queries stay valid.
+
+	//Constructs a T on entity, moving it to the matching table.
+	//Returns null if entity is dead or already has a T.
+	template<typename T, typename... TCtorArgs>
+	inline T* add(Entity entity, const TCtorArgs&... ctorArgs)
+	{
+		static_assert(!std::is_abstract_v<T>);
+		void* mem = addRaw(entity, getTypeId<T>());
+		return mem ? new (mem) T(ctorArgs...) : nullptr;
+	}
+
+	//Destroys entity's T, moving it to the matching table. Returns false if entity is dead or has no T.
+	template<typename T>
+	inline bool remove(Entity entity) { return removeRaw(entity, getTypeId<T>()); }
+
+	//Returns null if entity is dead or has no T. Only valid until entity's next structural change.
+	template<typename T>
+	inline T* get(Entity entity) { return static_cast<T*>(getRaw(entity, getTypeId<T>())); }
+	template<typename T>
+	inline bool has(Entity entity) { return getRaw(entity, getTypeId<T>()) != nullptr; }
+
+	//Untyped access, for tools and plugins that only know a name. Null if the type was never stored here.
+	ENGINEMEM_API void* get(Entity entity, const TypeName& type);
+
+	template<typename T>
+	inline typeid_t getTypeId()
+	{
+		typedef CachedTypeSlot<std::remove_cv_t<T>> slot;
+		if (slot::ownerSerial == serial) return slot::id;
+
+		typeid_t id = registerType(TypeInfo::createDummy<std::remove_cv_t<T>>());
+		slot::ownerSerial = serial;
+		slot::id = id;
+		return id;
+	}
+
+	inline size_t getEntityCount() const { return nEntities; }
+	inline size_t getTypeCount() const { return types.size(); }
+	inline size_t getArchetypeCount() const { return archetypes.size(); }
+	ENGINEMEM_API size_t getStorageBytes() const; //Memory actually backing chunks, see RawMemoryPool::getStorageBytes
+
+	template<typename... Ts>
+	class Query;
+
+	//Matching tables are cached in the query, and later runs only check tables created since. Keep one around rather than
+	//making a new one every frame.
+	template<typename... Ts>
+	inline Query<Ts...> query() { return Query<Ts...>(this); }
+
+private:
+	struct ComponentType
+	{
+		TypeName name;
+		size_t size;
+		size_t align;
+		dtor_t dtor; //May be null if trivially destructible
+	};
+	std::vector<ComponentType> types; //Index is typeid_t
+	std::unordered_map<TypeName, typeid_t> typesByName;
+	ENGINEMEM_API typeid_t registerType(const TypeInfo& type);
+
+	struct Archetype
+	{
+		std::vector<typeid_t> signature; //Sorted
+		std::vector<uint32_t> columnOffsets; //Parallel to signature. Entity column is always first, at offset 0.
+		std::vector<uint32_t> columnSizes; //Parallel to signature
+		uint32_t chunkCapacity; //Rows per chunk
+		std::vector<char*> chunks; //Every chunk is full except the last
+		size_t count = 0;
+
+		//Neighbouring tables, cached so repeated adds and removes skip the signature lookup
+		std::vector<std::pair<typeid_t, Archetype*>> addEdges;
+		std::vector<std::pair<typeid_t, Archetype*>> removeEdges;
+
+		ENGINEMEM_API int findColumn(typeid_t type) const; //-1 if not present
+		inline size_t getChunkRows(size_t chunk) const { return std::min<size_t>(chunkCapacity, count - chunk*chunkCapacity); }
+		inline void* getCell(size_t column, size_t row) const { return chunks[row/chunkCapacity] + columnOffsets[column] + columnSizes[column]*(row%chunkCapacity); }
+		inline Entity& getEntity(size_t row) const { return reinterpret_cast<Entity*>(chunks[row/chunkCapacity])[row%chunkCapacity]; }
+	};
+	std::deque<Archetype> archetypes; //Never removed, so queries can hold pointers. Index 0 is the empty archetype.
+	std::map<std::vector<typeid_t>, Archetype*> archetypesBySignature;
+	Archetype* getOrCreateArchetype(std::vector<typeid_t>&& signature);
+	Archetype* getNeighbour(Archetype* from, typeid_t type, bool adding);
+
+	RawMemoryPool chunkPool;
+	size_t pushRow(Archetype* archetype, Entity entity); //Returns row. Cells are left uninitialized.
+	void removeRow(Archetype* archetype, size_t row); //Fills the hole with the last row. Doesn't call dtors.
+
+	struct EntityRecord
+	{
+		Archetype* archetype; //Null if dead
+		size_t row;
+		uint32_t generation;
+	};
+	std::vector<EntityRecord> records; //Index is Entity::index
+	std::vector<uint32_t> freeRecords;
+	size_t nEntities;
+
+	//Moves entity's components to another table, destroying any the new table doesn't have. Returns cell of changedType, if present.
+	void* migrate(Entity entity, Archetype* to, typeid_t changedType);
+	ENGINEMEM_API void* addRaw(Entity entity, typeid_t type);
+	ENGINEMEM_API bool removeRaw(Entity entity, typeid_t type);
+	ENGINEMEM_API void* getRaw(Entity entity, typeid_t type);
+
+	//Per-type cache for templated lookups, so we can skip building a TypeName. Types are never removed, so an ID stays valid
+	//for as long as its storage lives. Keyed by serial rather than address, since a new storage could reuse an old one's.
+	uint64_t serial;
+	template<typename T>
+	struct CachedTypeSlot
+	{
+		static inline uint64_t ownerSerial = 0;
+		static inline typeid_t id = 0;
+	};
+};
+
+//Every entity that has all of Ts, and maybe others. Iterates table by table, chunk by chunk.
+//Don't create, destroy, add or remove components while iterating. Writing to components is fine.
+template<typename... Ts>
+class ArchetypeStorage::Query
+{
+	static_assert(sizeof...(Ts) > 0, "Query must name at least one component type");
+
+	ArchetypeStorage* storage;
+	typeid_t ids[sizeof...(Ts)];
+
+	struct Match
+	{
+		const Archetype* archetype;
+		uint32_t offsets[sizeof...(Ts)]; //Column of each of Ts
+	};
+	std::vector<Match> matches;
+	size_t nChecked = 0; //Tables are never removed, so only ones past this need checking
+
+	void refresh()
+	{
+		for (; nChecked < storage->archetypes.size(); ++nChecked)
+		{
+			const Archetype* a = &storage->archetypes[nChecked];
+			Match m { a, {} };
+			bool matched = true;
+			for (size_t i = 0; i < sizeof...(Ts) && matched; ++i)
+			{
+				int column = a->findColumn(ids[i]);
+				if (column != -1) m.offsets[i] = a->columnOffsets[column];
+				else matched = false;
+			}
+			if (matched) matches.push_back(m);
+		}
+	}
+
+	template<typename TFunc, size_t... I>
+	inline static void visitChunk(TFunc& visitor, const Match& m, size_t chunk, std::index_sequence<I...>)
+	{
+		char* data = m.archetype->chunks[chunk];
+		visitor(m.archetype->getChunkRows(chunk), reinterpret_cast<const Entity*>(data), reinterpret_cast<Ts*>(data + m.offsets[I])...);
+	}
+
+	friend class ArchetypeStorage;
+	Query(ArchetypeStorage* storage) : storage(storage), ids { storage->getTypeId<Ts>()... } {}
+
+public:
+	//Calls visitor(size_t count, const Entity* entities, Ts*... columns) once per chunk. Each array holds count rows.
+	template<typename TFunc>
+	inline void foreachChunk(TFunc&& visitor)
+	{
+		refresh();
+		for (const Match& m : matches)
+		{
+			for (size_t chunk = 0; chunk < m.archetype->chunks.size(); ++chunk) visitChunk(visitor, m, chunk, std::index_sequence_for<Ts...>());
+		}
+	}
+
+	//Calls visitor(Entity, Ts&...) once per matching entity
+	template<typename TFunc>
+	inline void foreach(TFunc&& visitor)
+	{
+		foreachChunk([&](size_t count, const Entity* entities, Ts*... columns)
+		{
+			for (size_t i = 0; i < count; ++i) visitor(entities[i], columns[i]...);
+		});
+	}
+
+	inline size_t count()
+	{
+		refresh();
+		size_t out = 0;
+		for (const Match& m : matches) out += m.archetype->count;
+		return out;
+	}
+};
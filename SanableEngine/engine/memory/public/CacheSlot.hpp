@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+
+//One-entry cache that any number of threads can read and fill at once. Meant for per-type static lookup caches.
+//Seqlock: readers treat a slot that changed under them as a miss instead of retrying, and a writer that loses a race
+//to another writer just doesn't cache. Empty slots have both keys 0, so lookups with a nonzero key always miss them.
+template<typename TValue>
+class CacheSlot
+{
+	std::atomic<uint32_t> sequence { 0 }; //Odd while being written
+	std::atomic<uint64_t> key0 { 0 };
+	std::atomic<uint64_t> key1 { 0 };
+	std::atomic<TValue> value { TValue() };
+
+public:
+	inline bool get(uint64_t k0, uint64_t k1, TValue& out) const
+	{
+		uint32_t before = sequence.load(std::memory_order_acquire);
+		if (before & 1) return false;
+		uint64_t foundK0 = key0.load(std::memory_order_relaxed);
+		uint64_t foundK1 = key1.load(std::memory_order_relaxed);
+		TValue found = value.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sequence.load(std::memory_order_relaxed) != before || foundK0 != k0 || foundK1 != k1) return false;
+		out = found;
+		return true;
+	}
+
+	inline void set(uint64_t k0, uint64_t k1, TValue val)
+	{
+		uint32_t before = sequence.load(std::memory_order_relaxed);
+		if ((before & 1) || !sequence.compare_exchange_strong(before, before+1, std::memory_order_relaxed)) return;
+		std::atomic_thread_fence(std::memory_order_release);
+		key0.store(k0, std::memory_order_relaxed);
+		key1.store(k1, std::memory_order_relaxed);
+		value.store(val, std::memory_order_relaxed);
+		sequence.store(before+2, std::memory_order_release);
+	}
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "dllapi.h"
+#include "StackAllocator.hpp"
+
+//Per-frame scratch memory, with a separate set of arenas for each thread so allocating never locks.
+//Arenas are only reset in beginFrame, which must be called while no other thread is allocating.
+class FrameAllocator
+{
+private:
+	struct ThreadArenas
+	{
+		std::thread::id owner;
+		StackAllocator thisFrame;
+		StackAllocator twoFrame[2]; //Double buffered: one receives this frame's allocations, the other still holds last frame's
+	};
+	std::mutex lock; //Only taken the first time each thread allocates
+	uint64_t serial; //Unique per FrameAllocator, so stale thread-local lookups can't hit a new one at the same address
+	std::vector<std::unique_ptr<ThreadArenas>> threads;
+	size_t initialSize;
+	size_t frameParity;
+
+	ThreadArenas* getThreadArenas();
+
+public:
+	ENGINEMEM_API FrameAllocator(size_t initialSize = 4096);
+	ENGINEMEM_API ~FrameAllocator();
+
+	FrameAllocator(const FrameAllocator&) = delete;
+	FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+	//Calling thread's arena for memory that lives until the start of next frame
+	ENGINEMEM_API StackAllocator* thisFrame();
+
+	//Calling thread's arena for memory that lives until the start of the frame after next, ie. can be read back next frame
+	ENGINEMEM_API StackAllocator* untilNextFrame();
+
+	//Frees everything allocated from thisFrame last frame, and from untilNextFrame the frame before that
+	ENGINEMEM_API void beginFrame();
+
+	ENGINEMEM_API size_t getHighWaterMark() const; //Largest any single thread's arenas have grown, in bytes
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "RawMemoryPool.hpp"
+
+//Typed generational reference to a pooled object. 12 bytes, trivially copyable, safe to store anywhere.
+//Unlike a pointer, it never dangles: compaction and capacity changes don't break it, and once the object is
+//released it resolves to null. Issued by TypedMemoryPool<TObj>::getHandle or MemoryManager::getHandle.
+//Only refers to objects of exactly TObj, since resolving can't adjust for base class offsets.
+template<typename TObj>
+class Handle
+{
+	RawMemoryPool::RawHandle raw;
+
+public:
+	Handle() = default;
+	explicit Handle(const RawMemoryPool::RawHandle& raw) : raw(raw) {}
+
+	//O(1): registry lookup, then generation check. Null if released or the pool is gone.
+	inline TObj* get() const { return (TObj*) RawMemoryPool::resolveAny(raw); }
+	inline TObj* operator->() const { return get(); }
+	inline explicit operator bool() const { return get() != nullptr; }
+
+	inline bool isNull() const { return raw.pool == 0; } //True if never assigned. Released objects aren't null, just unresolvable.
+	inline const RawMemoryPool::RawHandle& getRaw() const { return raw; }
+
+	inline bool operator==(const Handle& other) const { return raw == other.raw; }
+	inline bool operator!=(const Handle& other) const { return raw != other.raw; }
+};
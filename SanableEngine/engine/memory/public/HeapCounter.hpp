@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+#include "dllapi.h"
+
+//Count of heap allocations made by any thread, for checking that hot paths stay allocation-free.
+//MSVC debug builds count every CRT heap allocation through a CRT alloc hook. Elsewhere, nothing is counted unless the
+//executable was built with SANABLE_COUNT_HEAP_ALLOCS, which links a global operator new replacement into it (never into
+//a library). That only sees unaligned new, not plain malloc or aligned new.
+namespace HeapCounter
+{
+	ENGINEMEM_API bool isAvailable();
+	ENGINEMEM_API size_t getAllocCount(); //Running total. Always 0 if unavailable.
+
+	//For the counting hooks only
+	ENGINEMEM_API void recordAlloc();
+	ENGINEMEM_API void setHooked();
+}
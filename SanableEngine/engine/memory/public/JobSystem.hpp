@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <type_traits>
+
+#include "dllapi.h"
+
+//Work-stealing thread pool. Each worker has its own queue of index ranges: it splits ranges off the back of its own queue,
+//and when that runs dry it steals the largest range off the front of another's. Threads that submit work help run it.
+class JobSystem
+{
+private:
+	struct Batch;
+	struct Range;
+	struct Queue;
+	std::vector<std::unique_ptr<Queue>> queues; //One per worker, plus one shared by all other threads
+	std::vector<std::thread> workers;
+
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	std::atomic<size_t> pending; //Indices submitted but not yet run, across all batches
+	bool stopping;
+
+	void workerMain(size_t queueIndex);
+	bool runOne(size_t queueIndex); //Returns false if no work could be found
+	size_t getOwnQueue() const;
+
+	ENGINEMEM_API void parallelFor_internal(size_t count, void(*fn)(void*, size_t), void* ctx);
+	void submit(Batch* batch, size_t count);
+
+public:
+	ENGINEMEM_API JobSystem(); //One worker per core, minus the calling thread
+	ENGINEMEM_API JobSystem(size_t nWorkers);
+	ENGINEMEM_API ~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	inline size_t getWorkerCount() const { return workers.size(); }
+
+	//Calls task(i) for every i in [0, count), spread across workers, and returns once all are done.
+	//May be called from inside a task.
+	template<typename TFunc>
+	inline void parallelFor(size_t count, TFunc&& task)
+	{
+		parallelFor_internal(count, [](void* ctx, size_t i) { (*static_cast<std::remove_reference_t<TFunc>*>(ctx))(i); }, (void*)&task);
+	}
+
+	//Queues fn(ctx, i) for every i in [0, count) and returns immediately. ctx must outlive every call; the caller tracks completion.
+	//For work whose submitter shouldn't block, ie. TaskGraph handing off tasks from the thread that has to stay free for pinned ones.
+	ENGINEMEM_API void parallelForAsync(size_t count, void(*fn)(void*, size_t), void* ctx);
+
+	//Runs one piece of queued work on the calling thread, if there is any. Returns false if there was nothing to run.
+	//For threads waiting on something other than their own parallelFor, so they help instead of idling.
+	ENGINEMEM_API bool tryRunOne();
+
+	//True while the calling thread is running a queued task for any JobSystem. For asserting that something only happens at a sync point.
+	ENGINEMEM_API static bool isInTask();
+};
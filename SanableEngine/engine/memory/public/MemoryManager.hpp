@@ -3,7 +3,17 @@
 #include <unordered_map>
 #include <vector>
 #include <functional>
+#include <chrono>
+#include <string>
+#include <filesystem>
+#include <mutex>
+#include <atomic>
 #include "TypedMemoryPool.hpp"
+#include "CacheSlot.hpp"
+#include "MemorySnapshot.hpp"
+#include "SizeClassAllocator.hpp"
+#include "ArchetypeStorage.hpp"
+#include "JobSystem.hpp"
 
 class GameObject;
 class Application;
@@ -14,82 +24,226 @@ class _PoolCallBatcherBase;
 class MemoryManager
 {
 private:
-	std::vector<GenericTypedMemoryPool*> pools;
-	//std::unordered_map<std::string, RawMemoryPool*> pools;
-	ENGINEMEM_API void registerPool(GenericTypedMemoryPool* pool);
+	std::vector<GenericTypedMemoryPool*> pools; //In creation order
+	std::unordered_map<TypeName, GenericTypedMemoryPool*> poolsByType;
+	//Pools can be looked up and created from worker threads. Guards pools, poolsByType and ownerIndex.
+	//Recursive, since hooks run while walking pools (ie. release hooks in flushDeferred) can look up or create pools.
+	//Walks go by index, so a pool created mid-walk doesn't invalidate them.
+	mutable std::recursive_mutex poolsLock;
+	ENGINEMEM_API GenericTypedMemoryPool* registerPool(GenericTypedMemoryPool* pool); //If another thread got there first, deletes pool and returns theirs
+
+	std::atomic<uint64_t> poolStateHash;
+	ENGINEMEM_API void updatePoolStateHash(const TypeName& changedType);
+
+	//Per-type cache for templated lookups, so we can skip building a TypeName. Only valid while serial and state hash match.
+	//Keyed by serial rather than address, since a new manager could reuse an old one's.
+	uint64_t serial;
+	template<typename TObj>
+	struct CachedPoolSlot
+	{
+		static inline CacheSlot<GenericTypedMemoryPool*> slot;
+	};
+	template<typename TObj>
+	inline GenericTypedMemoryPool* getCachedPool();
 
-	uint64_t poolStateHash;
+	//Sorted address ranges of every pool, rebuilt lazily when pools are added/removed or move their storage
+	struct OwnerRange
+	{
+		void* begin;
+		void* end;
+		GenericTypedMemoryPool* pool;
+	};
+	std::vector<OwnerRange> ownerIndex;
+	uint64_t ownerIndexStateHash;
+	uint64_t ownerIndexEpoch;
+	ENGINEMEM_API void rebuildOwnerIndex();
+
+	SizeClassAllocator sizeClasses;
+	ArchetypeStorage archetypes;
+
+	//RTTI-visible pointer fields of one pool's objects, for fixing up after compaction
+	struct PointerFields
+	{
+		GenericTypedMemoryPool* pool;
+		std::vector<ptrdiff_t> offsets;
+		std::vector<TypeName> pointees; //Parallel to offsets
+		std::vector<bool> needsFixup; //Parallel to offsets
+	};
+	void collectPointerFields(std::vector<PointerFields>& out) const;
+	static bool canPointInto(const TypeName& pointee, const GenericTypedMemoryPool* target); //False only if it definitely can't
+	size_t fixPointerFields(const MemoryMapper& remapper, const std::vector<PointerFields>& fields); //Returns number of fields visited
+	double fixupNsPerField; //Running estimate, so compact can hold back budget for fixing pointers
+
+	//Peak object counts by type name. Loaded ones pre-size pools as they're created, session ones are recorded as pools are destroyed.
+	std::unordered_map<std::string, size_t> loadedCapacityProfile;
+	std::unordered_map<std::string, size_t> sessionCapacityProfile;
+	void recordPeak(const GenericTypedMemoryPool* pool);
 
 public:
 	ENGINEMEM_API MemoryManager();
 	ENGINEMEM_API ~MemoryManager();
 
 	ENGINEMEM_API GenericTypedMemoryPool* getSpecificPool(const TypeName& type);
+	ENGINEMEM_API GenericTypedMemoryPool* findOwner(void* ptr); //Returns pool containing the given address, or null if none
 	template<typename TObj>
 	inline TypedMemoryPool<TObj>* getSpecificPool(bool fallbackCreate);
 
+	//Creates a pool with non-default storage. Use for hot types, before anything else creates their pool.
+	//If the pool already exists, it is returned unchanged. Pass threadSafe for types that get created from worker threads
+	//(or mark them is_spawned_concurrently).
+	template<typename TObj>
+	inline TypedMemoryPool<TObj>* createPool(RawMemoryPool::StorageMode storageMode, bool hugePages = false, bool threadSafe = false);
+
+	//Safe from any thread if TObj's pool is thread-safe (see is_spawned_concurrently). Otherwise asserts it isn't called from a JobSystem task.
 	template<typename TObj, typename... TCtorArgs>
 	inline TObj* create(TCtorArgs... ctorArgs);
 
+	//Like create, but in shared size-class storage rather than a pool of its own. Use for small types with few instances.
+	//Doesn't register a pool, so batchers aren't rebuilt, but objects also aren't seen by pool iteration, PoolCallBatcher or snapshots.
+	template<typename TObj, typename... TCtorArgs>
+	inline TObj* createShared(TCtorArgs... ctorArgs) { return sizeClasses.create<TObj>(ctorArgs...); }
+	inline SizeClassAllocator* getSizeClasses() { return &sizeClasses; }
+
+	//Entities whose components live in per-archetype tables rather than pools, for data that's processed in bulk.
+	//Separate from pooled objects: not seen by pool iteration, PoolCallBatcher, compaction or snapshots.
+	inline ArchetypeStorage* getArchetypes() { return &archetypes; }
+
+	//Same threading rules as create
 	template<typename TObj>
 	void destroy(TObj* obj);
 
+	//Returns a null handle if obj isn't in TObj's own pool (ie. it's a derived type). See Handle.
+	//Works for objects a thread-safe pool hasn't published yet, but the handle only resolves once they are (see flushDeferred).
+	template<typename TObj>
+	inline Handle<TObj> getHandle(TObj* obj);
+
+	//Holds off other threads creating pools until done. Visitor may create pools, but not destroy them.
 	ENGINEMEM_API void foreachPool(const std::function<void(GenericTypedMemoryPool*)>& visitor);
 	ENGINEMEM_API void foreachPool(const std::function<void(const GenericTypedMemoryPool*)>& visitor) const;
 
+	//Sync point only: destroyPool, ensureFresh, flushDeferred, updatePointers, compact, snapshot and restore.
+	//These move, publish or release objects, so no other thread may be using pools at the time. Asserts they aren't called from a JobSystem task.
+	//Everything else here is safe from any thread, as long as the pools involved are thread-safe.
+
 	ENGINEMEM_API void destroyPool(const TypeName& type);
 	template<typename TObj>
 	inline void destroyPool() { destroyPool(TypeName::create<TObj>()); }
 
 	ENGINEMEM_API void ensureFresh(); //USE WITH CAUTION.
 
+	//Publishes allocations and applies releases that thread-safe pools deferred. Call at a sync point, when no other threads are using pools.
+	ENGINEMEM_API void flushDeferred();
+
+	//Rewrites pointer fields in every living object of a loaded type, to follow moves recorded in remapper.
+	//Only sees raw pointer fields that RTTI knows about; pointers inside containers aren't touched.
+	ENGINEMEM_API void updatePointers(const MemoryMapper& remapper);
+
+	//Incrementally defragments pools at least threshold (0-1) empty, moving living objects into a dense prefix.
+	//Stops once budget runs out; call again (ie. next frame) to continue. Returns true once there's nothing left to do.
+	//Pointers in RTTI-visible fields are fixed automatically, but only in pools whose fields could point into the ones that moved. The
+	//estimated fix-up time is counted against budget. Anything else (containers, globals) must be fixed by the caller using remapper.
+	ENGINEMEM_API bool compact(float threshold, std::chrono::nanoseconds budget, MemoryMapper* remapper = nullptr);
+
+	//Bitwise copy of every pool's living objects, for rollback, replays and save states. Padding and vptrs aren't copied.
+	//Pass the previous snapshot as base to only copy chunks that changed since.
+	//Only covers pooled memory: anything objects own outside their pool (ie. containers) isn't captured.
+	ENGINEMEM_API MemorySnapshot snapshot(const MemorySnapshot* base = nullptr);
+
+	//Rewrites every pool in the snapshot back to how it was. Pools created since are left as-is.
+	//No hooks, ctors or dtors are called, so objects created since are dropped without cleanup. Not valid across reloads.
+	ENGINEMEM_API void restore(const MemorySnapshot& snapshot);
+
+	//Capacity profile: peak object count per type, so pools can start at the size they'll need instead of growing during load.
+	//Load before creating pools. Types in the profile with no pool yet are remembered until one is created.
+	//Saving keeps entries for types not seen this session, so plugins that weren't loaded don't lose their history.
+	ENGINEMEM_API bool loadCapacityProfile(const std::filesystem::path& path); //Returns false if missing or unreadable
+	ENGINEMEM_API bool saveCapacityProfile(const std::filesystem::path& path) const;
+
 private:
 	friend class Application;
 	friend class PluginManager;
 
-	ENGINEMEM_API void updatePointers(const MemoryMapper& remapper);
-
 	friend class _PoolCallBatcherBase;
+	friend class ComponentTypeRegistry;
 	ENGINEMEM_API uint64_t getPoolStateHash() const;
 };
 
+template<typename TObj>
+inline GenericTypedMemoryPool* MemoryManager::getCachedPool()
+{
+	CacheSlot<GenericTypedMemoryPool*>& slot = CachedPoolSlot<TObj>::slot;
+	uint64_t stateHash = poolStateHash.load(std::memory_order_acquire);
+	GenericTypedMemoryPool* out;
+	if (slot.get(serial, stateHash, out)) return out;
+
+	//Cache miss. Only remember hits, so a pool created later is still found.
+	out = getSpecificPool(TypeName::create<TObj>());
+	if (out) slot.set(serial, stateHash, out);
+	return out;
+}
+
 template<typename TObj>
 inline TypedMemoryPool<TObj>* MemoryManager::getSpecificPool(bool fallbackCreate)
 {
-	GenericTypedMemoryPool* out = getSpecificPool(TypeName::create<TObj>());
+	GenericTypedMemoryPool* out = getCachedPool<TObj>();
 
 	//If set to create on fallback, do so
 	if (!out && fallbackCreate)
 	{
-		out = GenericTypedMemoryPool::create<TObj>();
-		registerPool(out);
+		//Small and contiguous, since most types are rare. Use createPool for anything that needs to grow.
+		//Types spawned from workers are the exception: nothing can resize them between sync points, so they have to grow on their own.
+		if (is_spawned_concurrently<TObj>::value) out = GenericTypedMemoryPool::create<TObj>(0, RawMemoryPool::StorageMode::Paged);
+		else out = GenericTypedMemoryPool::create<TObj>();
+		out = registerPool(out);
 		return out->getView<TObj>();
 	}
 
 	return out ? out->getView<TObj>() : nullptr;
 }
 
+template<typename TObj>
+inline TypedMemoryPool<TObj>* MemoryManager::createPool(RawMemoryPool::StorageMode storageMode, bool hugePages, bool threadSafe)
+{
+	GenericTypedMemoryPool* out = getCachedPool<TObj>();
+	if (!out)
+	{
+		out = GenericTypedMemoryPool::create<TObj>(0, storageMode);
+		if (hugePages) out->requestHugePages();
+		if (threadSafe) out->setThreadSafe(true);
+		out = registerPool(out);
+	}
+	return out->getView<TObj>();
+}
+
 template<typename TObj, typename... TCtorArgs>
 inline TObj* MemoryManager::create(TCtorArgs... ctorArgs)
 {
-	return getSpecificPool<TObj>(true)->emplace(ctorArgs...);
+	TypedMemoryPool<TObj>* pool = getSpecificPool<TObj>(true);
+	assert(pool->impl->isThreadSafe() || !JobSystem::isInTask());
+	return pool->emplace(ctorArgs...);
 }
 
 template<typename TObj>
 void MemoryManager::destroy(TObj* obj)
 {
 	//Try direct lookup first
-	GenericTypedMemoryPool* pool = getSpecificPool(TypeName::create<TObj>());
+	GenericTypedMemoryPool* pool = getCachedPool<TObj>();
 
-	//If that fails, search every pool to find owner
-	if (!pool)
-	{
-		for (GenericTypedMemoryPool* i : pools) if (i->contains(obj)) { pool = i; break; }
-	}
+	//If that fails (ie. destroying via base pointer), find owner by address
+	if (!pool || !pool->contains(obj)) pool = findOwner(obj);
 
 	if (pool && pool->contains(obj))
 	{
+		assert(pool->isThreadSafe() || !JobSystem::isInTask());
 		pool->release(obj);
 	}
+	else if (sizeClasses.contains(obj)) sizeClasses.destroy(obj);
 	else wprintf(L"WARNING: Cannot destroy %s at %p: pool does not exist", TypeName::create<TObj>().c_str(), obj);
 }
+
+template<typename TObj>
+inline Handle<TObj> MemoryManager::getHandle(TObj* obj)
+{
+	GenericTypedMemoryPool* pool = getCachedPool<TObj>();
+	return pool ? Handle<TObj>(pool->tryGetHandle(obj)) : Handle<TObj>();
+}
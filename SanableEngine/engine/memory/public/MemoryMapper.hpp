@@ -7,6 +7,7 @@
 
 #include "dllapi.h"
 
+#include <cstddef>
 #include <vector>
 
 /// <summary>
@@ -22,6 +23,7 @@ class MemoryMapper
 		void* src;
 		void* dst;
 		size_t blockSize;
+		bool concurrent; //Happens at the same time as the previous op, rather than after it
 	
 	private:
 		friend class MemoryMapper;
@@ -30,6 +32,21 @@ class MemoryMapper
 
 	std::vector<RemapOp> opLog;
 
+	/// <summary>
+	/// INTERNAL. Sorted, coalesced view of opLog. Ops are grouped into layers that can be
+	/// applied independently: within a layer, no two source ranges overlap and no source
+	/// overlaps an earlier destination. Layers are applied in order.
+	/// </summary>
+	struct Interval
+	{
+		char* srcBegin;
+		char* srcEnd;
+		ptrdiff_t delta;
+	};
+	mutable std::vector<std::vector<Interval>> compiledLayers;
+	mutable size_t nCompiledOps = 0;
+	void compile() const;
+
 	static constexpr bool USE_INVALID_DATA_FILL = true;
 	static constexpr unsigned char INVALID_DATA_FILL_VALUE = 219;
 
@@ -56,16 +73,25 @@ public:
 	/// </summary>
 	ENGINEMEM_API void logMove(void* dst, void* src, size_t bytesToMove);
 
+	/// <summary>
+	/// Like logMove, but happens at the same time as the previously logged move instead of after it.
+	/// Use when shuffling blocks around in place, such as reordering fields, where one block's source is another's destination.
+	/// </summary>
+	ENGINEMEM_API void logConcurrentMove(void* dst, void* src, size_t bytesToMove);
+
 	/// <summary>
 	/// Returns the address where the pointed object ended up.
+	/// O(log ops) once the log is compiled, which happens automatically on first call after logging.
 	/// </summary>
 	ENGINEMEM_API void* transformAddress(void* ptr, size_t ptrSize) const;
 
 	template<typename T>
-	inline T* transformAddress(T* ptr)
+	inline T* transformAddress(T* ptr) const
 	{
 		return (T*) transformAddress(ptr, sizeof(T)); //Defer to main impl
 	}
 
 	ENGINEMEM_API void clear();
+
+	inline bool isEmpty() const { return opLog.empty(); }
 };
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "RawMemoryPool.hpp"
+#include "TypeName.hpp"
+
+//Every pool's contents at one point in time. Taken by MemoryManager::snapshot, and cheap to keep many of:
+//deltas share unchanged chunks with their base, and each only keeps alive the chunks it actually uses.
+struct MemorySnapshot
+{
+	struct PoolEntry
+	{
+		TypeName type;
+		RawMemoryPool::State state;
+	};
+	std::vector<PoolEntry> pools;
+
+	inline const RawMemoryPool::State* find(const TypeName& type) const
+	{
+		for (const PoolEntry& p : pools) if (p.type == type) return &p.state;
+		return nullptr;
+	}
+
+	//Bytes copied for this snapshot, excluding chunks shared with a base
+	inline size_t getOwnBytes() const
+	{
+		size_t out = 0;
+		for (const PoolEntry& p : pools) out += p.state.getOwnBytes();
+		return out;
+	}
+};
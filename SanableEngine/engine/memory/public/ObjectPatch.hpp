@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "TypeInfo.hpp"
 
 #include "dllapi.h"
@@ -11,6 +13,35 @@ struct ObjectPatch
 	TypeInfo oldData;
 	TypeInfo newData;
 
+	/// <summary>
+	/// One step of a compiled migration plan. Offsets are from the start of the object.
+	/// </summary>
+	struct Op
+	{
+		enum class Kind : uint8_t
+		{
+			Copy,   //Field survived. Copy from old layout.
+			Zero,   //Field is new, or its type changed.
+			Default //Implicit value (read: vptr). Copy from new type's captured values.
+		};
+
+		Kind kind;
+		size_t dst; //Offset in new layout
+		size_t src; //Copy: Offset in old layout. Default: Offset into defaultValues. Zero: Unused.
+		size_t size;
+	};
+
+	/// <summary>
+	/// Migration plan, built once by create() and run on every object by apply().
+	/// </summary>
+	std::vector<Op> ops;
+	std::vector<char> defaultValues;
+	bool needsScratch = false; //Some fields moved, so old values must be read from a copy
+	mutable std::vector<char> scratch;
+
+	/// <summary>
+	/// Rewrite an object from old layout to new layout, in place. Object must be large enough for both.
+	/// </summary>
 	ENGINEMEM_API void apply(void* target, MemoryMapper* remapLog = nullptr) const;
 	ENGINEMEM_API bool isValid() const;
 	ENGINEMEM_API TypeName getTypeName() const;
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <type_traits>
+
+//Opt-in marker for types whose batched calls (ie. Update) only touch their own object, so PoolCallBatcher's parallel calls
+//may run them on several threads at once. Checked per concrete type when its pool is created, so it isn't inherited. To mark:
+//    template<> struct is_parallel_safe<MyComponent> : std::true_type {};
+template<typename TObj>
+struct is_parallel_safe : std::false_type {};
+
+//Opt-in marker for types that get created or destroyed from worker threads (ie. by parallel-safe Update code). Their pools are
+//made thread-safe when created, so creation and destruction are deferred to the next sync point (see RawMemoryPool::setThreadSafe).
+//Everything else keeps immediate, single-threaded allocation. Also checked per concrete type, and not inherited. To mark:
+//    template<> struct is_spawned_concurrently<MyComponent> : std::true_type {};
+template<typename TObj>
+struct is_spawned_concurrently : std::false_type {};
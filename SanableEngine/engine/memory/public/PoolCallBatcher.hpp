@@ -6,6 +6,7 @@
 #include "dllapi.h"
 #include "TypeName.hpp"
 #include "TypedMemoryPool.hpp"
+#include "JobSystem.hpp"
 
 class _PoolCallBatcherBase
 {
@@ -21,15 +22,100 @@ protected:
 	};
 	std::vector<CachedPool> cachedPoolList;
 
+	template<typename TFunc>
+	inline static void visitRange(const CachedPool& i, size_t begin, size_t end, TFunc& visitor)
+	{
+		ptrdiff_t castOffset = i.caster.offset; //Upcasting is a fixed offset
+		size_t stride = i.pool->getMaxObjectSize();
+		i.pool->foreachLiveSpan(begin, end,
+			[&](const RawMemoryPool::LiveSpan& span)
+			{
+				char* casted = ((char*)span.first) + castOffset;
+				for (size_t j = 0; j < span.count; ++j, casted += stride) visitor((void*)casted);
+			}
+		);
+	}
+
+	//Slots per task when running in parallel. Large enough to amortize stealing, small enough to balance 200k objects over many cores.
+	static constexpr size_t PARALLEL_CHUNK_SIZE = 1024;
+	inline static size_t chunkCount(const CachedPool& i) { return i.pool->isParallelSafe() ? (i.pool->getMaxNumObjects() + PARALLEL_CHUNK_SIZE-1) / PARALLEL_CHUNK_SIZE : 0; }
+
 	ENGINEMEM_API _PoolCallBatcherBase(const TypeName& baseType, bool skipUnloaded = true);
 public:
 	ENGINEMEM_API virtual ~_PoolCallBatcherBase();
 
 	ENGINEMEM_API void clear();
-	ENGINEMEM_API size_t count() const;
-	ENGINEMEM_API void ensureFresh(MemoryManager* src, bool force = false);
+	ENGINEMEM_API size_t count() const; //Pools, not objects
+	ENGINEMEM_API bool ensureFresh(MemoryManager* src, bool force = false); //Returns true if the pool list was rebuilt, which invalidates pool indices
+	ENGINEMEM_API const GenericTypedMemoryPool* getPool(size_t index) const;
+	ENGINEMEM_API bool contains(const GenericTypedMemoryPool* pool) const;
 
-	ENGINEMEM_API void foreachObject(const std::function<void(void*)>& visitor) const; //Given pointer will already have been cast to correct type
+	//Given pointer will already have been cast to correct type.
+	//Inlined so the visitor isn't an indirect call: loaded check and cast are resolved once per pool, then live spans are walked directly.
+	template<typename TFunc>
+	inline void foreachObject(TFunc&& visitor) const
+	{
+		for (const CachedPool& i : cachedPoolList)
+		{
+			if (skipUnloaded && !i.pool->isLoaded()) continue;
+			visitRange(i, 0, i.pool->getMaxNumObjects(), visitor);
+		}
+	}
+
+	//Same as above, but pools of parallel-safe types (see is_parallel_safe) are split into chunks and run on jobs.
+	//Other pools run first, on the calling thread. Visitor must be safe to call from several threads at once,
+	//and mustn't create objects of parallel-safe types, since that could resize pools mid-iteration.
+	template<typename TFunc>
+	inline void parallelForeachObject(JobSystem* jobs, TFunc&& visitor) const
+	{
+		foreachSerialObject(visitor);
+		foreachParallelSafeObject(jobs, visitor);
+	}
+
+	//The two halves of parallelForeachObject, for running as separate tasks (ie. pinning the serial half to the main thread)
+	template<typename TFunc>
+	inline void foreachSerialObject(TFunc&& visitor) const
+	{
+		for (const CachedPool& i : cachedPoolList)
+		{
+			if (!i.pool->isParallelSafe() && (!skipUnloaded || i.pool->isLoaded())) visitRange(i, 0, i.pool->getMaxNumObjects(), visitor);
+		}
+	}
+
+	template<typename TFunc>
+	inline void foreachParallelSafeObject(JobSystem* jobs, TFunc&& visitor) const
+	{
+		size_t nChunks = 0;
+		for (const CachedPool& i : cachedPoolList) nChunks += chunkCount(i);
+
+		jobs->parallelFor(nChunks, [&](size_t chunk)
+		{
+			//Find which pool this chunk falls in. There are few pools, so a scan is cheaper than building a table.
+			for (const CachedPool& i : cachedPoolList)
+			{
+				size_t n = chunkCount(i);
+				if (chunk >= n)
+				{
+					chunk -= n;
+					continue;
+				}
+
+				if (!skipUnloaded || i.pool->isLoaded()) visitRange(i, chunk*PARALLEL_CHUNK_SIZE, (chunk+1)*PARALLEL_CHUNK_SIZE, visitor);
+				return;
+			}
+		});
+	}
+
+	//One pool's objects, ie. for giving each pool its own task. Split into chunks on jobs if the pool is parallel-safe, otherwise run on the calling thread.
+	template<typename TFunc>
+	inline void foreachObjectInPool(JobSystem* jobs, size_t index, TFunc&& visitor) const
+	{
+		const CachedPool& i = cachedPoolList[index];
+		if (skipUnloaded && !i.pool->isLoaded()) return;
+
+		if (!i.pool->isParallelSafe()) visitRange(i, 0, i.pool->getMaxNumObjects(), visitor);
+		else jobs->parallelFor(chunkCount(i), [&](size_t chunk) { visitRange(i, chunk*PARALLEL_CHUNK_SIZE, (chunk+1)*PARALLEL_CHUNK_SIZE, visitor); });
+	}
 };
 
 template<typename TObj>
@@ -50,4 +136,36 @@ public:
 	{
 		foreachObject([&](void* obj) { func(static_cast<TObj*>(obj), funcArgs...); });
 	}
+
+	template<typename TReturn, typename... TArgs>
+	void parallelMemberCall(JobSystem* jobs, TReturn(TObj::*func)(TArgs...), TArgs... funcArgs) const
+	{
+		parallelForeachObject(jobs, [&](void* obj) { (static_cast<TObj*>(obj)->*func)(funcArgs...); });
+	}
+
+	template<typename TFunc, typename... TArgs>
+	void parallelStaticCall(JobSystem* jobs, TFunc func, TArgs... funcArgs) const
+	{
+		parallelForeachObject(jobs, [&](void* obj) { func(static_cast<TObj*>(obj), funcArgs...); });
+	}
+
+	//Halves of parallelMemberCall. See foreachSerialObject.
+	template<typename TReturn, typename... TArgs>
+	void serialMemberCall(TReturn(TObj::*func)(TArgs...), TArgs... funcArgs) const
+	{
+		foreachSerialObject([&](void* obj) { (static_cast<TObj*>(obj)->*func)(funcArgs...); });
+	}
+
+	template<typename TReturn, typename... TArgs>
+	void parallelSafeMemberCall(JobSystem* jobs, TReturn(TObj::*func)(TArgs...), TArgs... funcArgs) const
+	{
+		foreachParallelSafeObject(jobs, [&](void* obj) { (static_cast<TObj*>(obj)->*func)(funcArgs...); });
+	}
+
+	//See foreachObjectInPool
+	template<typename TReturn, typename... TArgs>
+	void poolMemberCall(JobSystem* jobs, size_t poolIndex, TReturn(TObj::*func)(TArgs...), TArgs... funcArgs) const
+	{
+		foreachObjectInPool(jobs, poolIndex, [&](void* obj) { (static_cast<TObj*>(obj)->*func)(funcArgs...); });
+	}
 };
@@ -3,9 +3,11 @@
 #include "dllapi.h"
 
 #include <cassert>
+#include <cstdint>
 #include <vector>
 #include <algorithm>
 #include <string>
+#include <memory>
 
 #include "MemoryMapper.hpp"
 
@@ -13,7 +15,7 @@
 class RawMemoryPool
 {
 protected:
-	typedef uint16_t id_t;
+	typedef size_t id_t;
 
 	ENGINEMEM_API void* idToPtr(id_t id) const;
 	ENGINEMEM_API id_t ptrToId(void* ptr) const;
@@ -27,7 +29,15 @@ protected:
 private:
 	RawMemoryPool();
 public:
-	ENGINEMEM_API RawMemoryPool(size_t maxNumObjects, size_t objectSize, size_t objectAlign);
+	enum class StorageMode : uint8_t
+	{
+		Contiguous, //Single block. Changing capacity moves every object.
+		Paged,      //Fixed-size pages, appended automatically when full. Objects never move when capacity changes.
+		Reserved    //One large virtual address range, committed on demand as the pool fills. Objects never move when capacity changes.
+		            //Falls back to Paged on platforms without virtual memory.
+	};
+
+	ENGINEMEM_API RawMemoryPool(size_t maxNumObjects, size_t objectSize, size_t objectAlign, StorageMode storageMode = StorageMode::Contiguous);
 	ENGINEMEM_API virtual ~RawMemoryPool();
 
 	//Idiotproofing against myself
@@ -38,23 +48,106 @@ public:
 	//This will break any existing pointers, unless a mapper is used to fix them.
 	ENGINEMEM_API void resizeObjects(size_t newSize, size_t newAlign, MemoryMapper* mapper = nullptr);
 
-	//Changes the maximum object count.
-	//This will break any existing pointers, unless a mapper is used to fix them.
+	//Changes the maximum object count. Living objects that no longer fit are released.
+	//Contiguous: This will break any existing pointers, unless a mapper is used to fix them.
+	//Paged: Rounded up to a whole number of pages. Never moves objects, and won't drop pages that still hold living objects.
+	//Reserved: Rounded up to a whole number of OS pages, and capped by the reservation. Never moves objects.
 	ENGINEMEM_API void setMaxNumObjects(size_t newCount, MemoryMapper* mapper = nullptr);
 
+	//Moves up to maxMoves living objects from the back of the pool into holes at the front, so they form a dense prefix.
+	//Objects are moved bitwise, same as resizeObjects. This will break any existing pointers, unless a mapper is used to fix them.
+	//Returns true once the pool is fully compacted. Call repeatedly to spread the work out.
+	ENGINEMEM_API bool compact(size_t maxMoves, MemoryMapper* mapper = nullptr);
+
+	//Fraction of slots before the last living object that are empty. 0 = dense, nothing for compact() to do.
+	ENGINEMEM_API float getFragmentation() const;
+
+	//Generational reference to a living object. Survives compaction and capacity changes, which move objects between slots,
+	//and resolves to null once the object is released, even if its slot has been reused since.
+	//Plain data, so it can be stored anywhere. Use Handle<T> for the typed version.
+	struct RawHandle
+	{
+		uint32_t pool = 0; //Global pool ID, never reused. 0 = null handle.
+		uint32_t index = 0; //Into the pool's handle table, not a slot ID
+		uint32_t generation = 0;
+
+		inline bool operator==(const RawHandle& other) const { return pool == other.pool && index == other.index && generation == other.generation; }
+		inline bool operator!=(const RawHandle& other) const { return !(*this == other); }
+	};
+
+	//Both O(1). obj must be alive. resolve returns null if the object was released or the handle is for another pool.
+	//Thread-safe pools: don't overlap with anything that changes capacity, since that may grow the handle table.
+	ENGINEMEM_API RawHandle getHandle(void* obj) const;
+	ENGINEMEM_API void* resolve(const RawHandle& handle) const;
+
+	//Like getHandle, but returns a null handle if obj isn't allocated here instead of asserting.
+	//Thread-safe pools: may overlap with other threads' allocate and release, and also accepts objects not yet published
+	//by flushDeferred. Their handles start resolving once they are.
+	ENGINEMEM_API RawHandle tryGetHandle(void* obj) const;
+
+	struct State;
+
+	//Copies every living object's bytes into out, for rollback and save states. See MemoryManager::snapshot.
+	//runs: (offset, size) byte ranges to copy from each object. If base is given, chunks it already holds unchanged are shared, not copied.
+	//Reserved pools track which pages were written since their previous capture (see vmemCollectWrites). If base is that capture,
+	//chunks on untouched pages are shared without being read, so cost scales with what changed. Otherwise, or if the OS can't
+	//track writes, every living chunk is copied and compared against base, which saves memory but not time.
+	ENGINEMEM_API void captureState(State& out, const std::vector<std::pair<size_t, size_t>>& runs, const State* base = nullptr);
+
+	//Rewrites objects and liveness to match a captured state, using the same runs. Bitwise: no hooks, ctors or dtors are called,
+	//so objects alive now but not then are dropped as-is. Pointers are restored as they were, so they're only valid if the pool
+	//hasn't moved since (Paged and Reserved pools never do).
+	//Handles to objects that were released, dropped or created since the capture are invalidated for good: their generation moves
+	//past both the captured and current one, so no handle issued in between can match again. Handles to untouched objects stay valid.
+	ENGINEMEM_API void restoreState(const State& state, const std::vector<std::pair<size_t, size_t>>& runs);
+
+	//Resolves a handle from any pool. Null if the pool has since been destroyed.
+	ENGINEMEM_API static void* resolveAny(const RawHandle& handle);
+	ENGINEMEM_API static RawMemoryPool* getPoolById(uint32_t id);
+	inline uint32_t getPoolId() const { return mPoolId; }
+
 	typedef void (*hook_t)(void*);
 
-	//Allocates raw memory. Returns null if out of memory.
+	//Allocates raw memory. Returns null if out of memory. Paged and Reserved pools grow instead.
 	//Set hook if type requires special initialization
 	[[nodiscard]] ENGINEMEM_API void* allocate();
 	hook_t initHook;
 
+	//Allocates up to count objects at once, writing them to out.
+	//Returns how many were actually allocated, which is less than count if out of memory.
+	[[nodiscard]] ENGINEMEM_API size_t allocate(size_t count, void** out);
+
 	//Deallocates raw memory.
 	//Set hook if type requires special cleanup
 	ENGINEMEM_API void release(void* obj);
 	hook_t releaseHook;
 
+	//Thread-safe mode. allocate and release may then be called from many threads at once, with some differences:
+	// - Each thread claims slots in batches, so most calls touch no shared state.
+	// - New objects only become alive (visible to isAlive and iteration) once flushDeferred is called.
+	// - Released objects are only actually released (hook called, slot reusable) once flushDeferred is called.
+	// - Slots sitting in thread caches count as free for getNumFreeObjects.
+	//flushDeferred, iteration, and anything that changes capacity or moves objects must not overlap with other threads' calls.
+	ENGINEMEM_API void setThreadSafe(bool threadSafe);
+	inline bool isThreadSafe() const { return mConcurrent != nullptr; }
+
+	//Thread-safe only. Publishes objects allocated and releases objects released since last call.
+	//Returns true if there was anything to do.
+	ENGINEMEM_API bool flushDeferred();
+
 	ENGINEMEM_API bool contains(void* ptr) const;
+
+	//Address ranges this pool's storage might occupy. Superset of what contains() accepts.
+	struct AddressRange
+	{
+		void* begin;
+		void* end;
+	};
+	ENGINEMEM_API void getAddressRanges(std::vector<AddressRange>& out) const;
+
+	//Changes whenever any pool's address ranges change
+	ENGINEMEM_API static uint64_t getAddressSpaceEpoch();
+
 	inline bool isAlive(void* ptr) const
 	{
 		return isAliveById(ptrToId(ptr)); //Convert to id and defer to main impl
@@ -62,20 +155,114 @@ public:
 	ENGINEMEM_API void reset();//doesn't reallocate memory but does reset free list and num allocated objects
 
 	inline size_t getMaxObjectSize()  const { return mObjectSize; }
+	inline size_t getObjectAlign() const { return mObjectAlign; }
 	inline size_t getMaxNumObjects() const { return mMaxNumObjects; }
 	inline size_t getNumFreeObjects() const { return mMaxNumObjects - mNumAllocatedObjects; }
 	inline size_t getNumAllocatedObjects() const { return mNumAllocatedObjects; }
+	inline size_t getPeakNumAllocatedObjects() const { return mPeakNumAllocatedObjects; } //Most objects alive at once, since creation
+	inline StorageMode getStorageMode() const { return mStorageMode; }
+	inline size_t getObjectsPerPage() const { return size_t(1) << mPageShift; } //Paged only
+	ENGINEMEM_API size_t getStorageBytes() const; //Bytes of object storage actually backed by memory. Reserved pools only count what's committed.
+
+	//Reserved only. Ask the OS to back this pool with huge pages, cutting TLB misses for hot pools.
+	//Returns false if unsupported, in which case nothing changes.
+	ENGINEMEM_API bool requestHugePages();
 
 protected:
-	uint8_t* mLivingListBlock; //Free list is a dynamically-sized bitset. 1 = alive, 0 = free.
-	void* mDataBlock; //Storage for allocated objects
-	ENGINEMEM_API uint8_t* getLivingListBlock() const { return mLivingListBlock; }
+	uint64_t* mLivingListBlock; //Free list is a dynamically-sized bitset, scanned a word at a time. 1 = alive, 0 = free.
+	uint64_t* mFullWordsBlock; //Summary of living list, one bit per word. 1 = word is full, 0 = has free slots.
+	void* mDataBlock; //Contiguous and Reserved only. Storage for allocated objects.
+	ENGINEMEM_API uint64_t* getLivingListBlock() const { return mLivingListBlock; }
 	ENGINEMEM_API void* getObjectDataBlock() const { return mDataBlock; }
 
 	size_t mMaxNumObjects;
 	size_t mNumAllocatedObjects;
+	size_t mPeakNumAllocatedObjects;
 	size_t mObjectSize;
 	size_t mObjectAlign;
+	size_t mFreeHint; //Index into mFullWordsBlock. No free slots exist before this summary word.
+
+	StorageMode mStorageMode;
+	size_t mPageShift; //log2 of objects per page. Always at least one living list word, so words never straddle pages.
+	std::vector<void*> mPages; //Paged only. Storage for allocated objects, in ID order.
+	std::vector<std::pair<void*, id_t>> mPagesByAddress; //Paged only. Sorted by address, maps to first ID in page.
+	ENGINEMEM_API const std::pair<void*, id_t>* findPage(void* ptr) const;
+
+	struct ThreadCache;
+	struct ConcurrentState;
+	ConcurrentState* mConcurrent; //Thread-safe only, otherwise null
+
+	size_t mReservedBytes; //Reserved only. Size of address range starting at mDataBlock.
+	size_t mCommittedBytes; //Reserved only. Usable bytes starting at mDataBlock.
+	bool mHugePages;
+	uint64_t mLastCaptureId; //Reserved only. Capture that write tracking was last reset by, or 0 if writes since are unknown.
+
+	//Handle table. Every slot is paired with one handle index, so moving an object between slots only swaps the pairing.
+	//Both grow with capacity but never shrink, so the pairing stays a permutation and old handles stay in bounds.
+	//Empty until the first handle is issued, so pools that never use handles don't pay for them. Until then, the pairing is identity.
+	struct HandleEntry
+	{
+		uint32_t slot;
+		uint32_t generation; //Bumped each time the object in this entry is released
+	};
+	mutable std::vector<HandleEntry> mHandles; //By handle index
+	mutable std::vector<uint32_t> mSlotHandles; //By slot ID
+	uint32_t mPoolId;
+
+public:
+	//Captured by captureState. Objects are stored in chunks, one per living list word, packed with only the captured runs.
+	//Buffers are refcounted, so a state built against a base keeps only the base chunks it actually shares alive.
+	struct State
+	{
+		struct Chunk
+		{
+			uint32_t buffer; //Index into buffers
+			size_t offset;
+			size_t size;
+		};
+
+		uint64_t captureId = 0; //Unique per capture
+		size_t objectSize = 0;
+		std::vector<std::pair<size_t, size_t>> runs;
+		size_t maxNumObjects = 0;
+		size_t numAllocatedObjects = 0;
+		void* dataBlock = nullptr; //Contiguous only, to detect moves
+		std::vector<uint64_t> livingList;
+		std::vector<HandleEntry> handles; //Empty if no handle had been issued yet
+		std::vector<uint32_t> slotHandles;
+		struct Buffer
+		{
+			std::unique_ptr<char[]> bytes;
+			size_t size = 0;
+		};
+
+		std::vector<Chunk> chunks; //By living list word
+		std::vector<std::shared_ptr<const Buffer>> buffers; //First is our own, rest are shared from bases
+
+		inline size_t getOwnBytes() const { return buffers.empty() ? 0 : buffers[0]->size; }
+		inline const char* getChunkBytes(const Chunk& c) const { return buffers[c.buffer]->bytes.get() + c.offset; }
+	};
+
+private:
+	void setMaxNumObjects_internal(size_t newCount, MemoryMapper* mapper);
+	void releaseImmediate(void* obj);
+	ThreadCache* getThreadCache();
+	void refillThreadCache(ThreadCache* cache, size_t count);
+	void dropThreadCaches(); //Flush, then return unused slots. Needed before anything that moves objects or shrinks capacity.
+
+	void resizeLivingList(size_t newMaxNumObjects);
+	void releaseRange(id_t begin, id_t end);
+	inline void retireHandle(id_t id) { if (!mHandles.empty()) mHandles[mSlotHandles[id]].generation++; } //Call on release, so old handles stop resolving
+	void swapHandles(id_t a, id_t b);
+	void growHandleTable(size_t count) const;
+	void ensureHandleTable() const; //Builds the table on first use
+	void rebuildPageIndex();
+	bool reserveAddressSpace();
+
+	//Word-at-a-time scans of the living list. All return limit if nothing was found.
+	id_t findNextAlive(id_t from, id_t limit) const;
+	id_t findNextDead(id_t from, id_t limit) const;
+	id_t findLastAlive(id_t limit) const; //Scans backwards from just before limit
 
 public:
 	class const_iterator
@@ -97,4 +284,49 @@ public:
 	};
 	ENGINEMEM_API const_iterator cbegin() const;
 	ENGINEMEM_API const_iterator cend() const;
+
+	//Run of living objects that are adjacent in memory, each getMaxObjectSize() bytes apart
+	struct LiveSpan
+	{
+		void* first;
+		size_t count;
+	};
+
+	//Finds the first run of living objects at or after cursor, then moves cursor past it.
+	//Returns false once there are none left. Start with cursor = 0.
+	ENGINEMEM_API bool nextLiveSpan(size_t& cursor, LiveSpan& out) const;
+	ENGINEMEM_API bool nextLiveSpan(size_t& cursor, LiveSpan& out, size_t limit) const; //Only considers IDs before limit
+
+	//Calls visitor(const LiveSpan&) for each run of living objects, in ID order.
+	//Don't allocate or release objects in this pool from inside visitor.
+	template<typename TFunc>
+	inline void foreachLiveSpan(TFunc&& visitor) const
+	{
+		size_t cursor = 0;
+		LiveSpan span;
+		while (nextLiveSpan(cursor, span)) visitor(span);
+	}
+
+	//Same as above, but only for IDs in [begin, end). Used to split a pool into chunks.
+	template<typename TFunc>
+	inline void foreachLiveSpan(size_t begin, size_t end, TFunc&& visitor) const
+	{
+		size_t cursor = begin;
+		LiveSpan span;
+		while (nextLiveSpan(cursor, span, end)) visitor(span);
+	}
+
+	//Calls visitor(void*) for each living object, in ID order.
+	//Don't allocate or release objects in this pool from inside visitor.
+	template<typename TFunc>
+	inline void foreachLive(TFunc&& visitor) const
+	{
+		foreachLiveSpan(
+			[&](const LiveSpan& span)
+			{
+				char* obj = (char*)span.first;
+				for (size_t i = 0; i < span.count; ++i, obj += mObjectSize) visitor((void*)obj);
+			}
+		);
+	}
 };
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
+
+#include "RawMemoryPool.hpp"
+#include "TypeName.hpp"
+
+//Shared storage for many small types, so each doesn't need its own mostly-empty pool.
+//Types of similar size and alignment share one slab, with a type tag per slot. Slabs reserve address space and commit
+//pages on demand, so memory use tracks the number of living objects rather than the number of types.
+//Each type also keeps a dense list of its objects, so iterating one type never scans the others.
+//Objects never move. Not reload-safe: objects aren't patched if their type's layout changes.
+class SizeClassAllocator
+{
+public:
+	static constexpr size_t MAX_SHARED_SIZE = 256; //Larger types don't gain much from sharing
+	static constexpr size_t MAX_SHARED_ALIGN = 64;
+	static constexpr size_t SIZE_CLASS_GRANULARITY = 16;
+
+	template<typename TObj>
+	static constexpr bool isEligible() { return sizeof(TObj) <= MAX_SHARED_SIZE && alignof(TObj) <= MAX_SHARED_ALIGN; }
+
+	ENGINEMEM_API SizeClassAllocator();
+	ENGINEMEM_API ~SizeClassAllocator(); //Destroys remaining objects
+
+	SizeClassAllocator(const SizeClassAllocator&) = delete;
+	SizeClassAllocator& operator=(const SizeClassAllocator&) = delete;
+
+	typedef void (*dtor_t)(void*);
+
+	//Raw memory for one object of the given type. dtor is remembered, and called on anything still alive at shutdown.
+	[[nodiscard]] ENGINEMEM_API void* allocate(const TypeName& type, size_t size, size_t align, dtor_t dtor = nullptr);
+	ENGINEMEM_API void release(void* obj); //Doesn't call dtor
+	ENGINEMEM_API void destroy(void* obj); //Calls dtor given at allocation, then releases
+
+	template<typename TObj, typename... TCtorArgs>
+	inline TObj* create(TCtorArgs... ctorArgs)
+	{
+		static_assert(isEligible<TObj>(), "Type too large or overaligned for size classes");
+		void* mem = allocate(TypeName::create<TObj>(), sizeof(TObj), alignof(TObj), [](void* obj) { static_cast<TObj*>(obj)->~TObj(); });
+		return mem ? new (mem) TObj(ctorArgs...) : nullptr;
+	}
+
+	ENGINEMEM_API bool contains(void* obj) const;
+	ENGINEMEM_API const TypeName* getTypeOf(void* obj) const; //Null if not one of ours
+
+	//Calls visitor(TObj*) for each living object of exactly this type, in no particular order.
+	//Don't create or destroy objects of this type from inside visitor.
+	template<typename TObj, typename TFunc>
+	inline void foreach(TFunc&& visitor) const
+	{
+		if (const TypeEntry* t = findTypeCached<TObj>())
+		{
+			for (void* obj : t->objects) visitor(static_cast<TObj*>(obj));
+		}
+	}
+	template<typename TObj>
+	inline size_t count() const
+	{
+		const TypeEntry* t = findTypeCached<TObj>();
+		return t ? t->objects.size() : 0;
+	}
+
+	inline size_t getTypeCount() const { return types.size(); }
+	inline size_t getSizeClassCount() const { return classes.size(); }
+	ENGINEMEM_API size_t getStorageBytes() const; //Memory actually backing slabs, see RawMemoryPool::getStorageBytes
+
+private:
+	//Slab plus per-slot metadata, indexed by slot ID
+	struct SizeClass : public RawMemoryPool
+	{
+		SizeClass(size_t size, size_t align);
+
+		struct SlotInfo
+		{
+			uint16_t type; //Index into types
+			uint32_t listIndex; //Index into that type's objects
+		};
+		std::vector<SlotInfo> slots;
+		inline SlotInfo& getSlot(void* obj) { return slots[ptrToId(obj)]; }
+		inline const SlotInfo& getSlot(void* obj) const { return slots[ptrToId(obj)]; }
+	};
+	std::vector<SizeClass*> classes;
+
+	struct TypeEntry
+	{
+		TypeName name;
+		SizeClass* sizeClass;
+		dtor_t dtor;
+		std::vector<void*> objects; //Dense, in no particular order
+	};
+	std::vector<TypeEntry> types; //Index is the slot type tag
+	std::unordered_map<TypeName, uint16_t> typesByName;
+
+	ENGINEMEM_API const TypeEntry* findType(const TypeName& type) const;
+
+	//Per-type cache for templated lookups, so we can skip building a TypeName. Types are never removed, so an index stays valid
+	//for as long as its allocator lives. Keyed by serial rather than address, since a new allocator could reuse an old one's.
+	uint64_t serial;
+	template<typename TObj>
+	struct CachedTypeSlot
+	{
+		static inline uint64_t ownerSerial = 0;
+		static inline uint16_t index = 0;
+	};
+	template<typename TObj>
+	inline const TypeEntry* findTypeCached() const
+	{
+		typedef CachedTypeSlot<TObj> slot;
+		if (slot::ownerSerial == serial) return &types[slot::index];
+
+		const TypeEntry* t = findType(TypeName::create<TObj>());
+		if (t)
+		{
+			slot::ownerSerial = serial;
+			slot::index = uint16_t(t - types.data());
+		}
+		return t;
+	}
+	SizeClass* findClass(void* obj) const;
+	SizeClass* getOrCreateClass(size_t size, size_t align);
+};
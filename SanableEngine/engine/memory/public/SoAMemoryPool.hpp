@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <utility>
+
+#include "TypeInfo.hpp"
+#include "dllapi.h"
+
+//Structure-of-arrays storage for opted-in plain data types. Each hot field gets its own tightly packed column,
+//so a batch system touching one field only streams that field. Fields not listed as hot are packed together into one
+//cold column, so hot bytes aren't stored twice. Columns are split using the type's RTTI field layout.
+//Rows are always dense: releasing moves the last row into the hole, so columns never need skipping.
+//Objects are never whole, so this only suits types without vptrs or self-pointers. Must be rebuilt if the type is reloaded.
+class SoAMemoryPool
+{
+public:
+	struct Column
+	{
+		std::string name; //Field name. Empty for the cold column.
+		TypeName type;
+		ptrdiff_t offset; //Within an object image. Cold column: unused, see coldRuns.
+		size_t size; //Bytes per element. Cold column: every cold field, packed.
+		char* data;
+	};
+
+	//Typed window onto one column. Invalidated by anything that adds or removes rows.
+	template<typename T>
+	struct ColumnView
+	{
+		T* data = nullptr;
+		size_t count = 0;
+
+		inline T& operator[](size_t row) const { assert(row < count); return data[row]; }
+		inline T* begin() const { return data; }
+		inline T* end() const { return data + count; }
+		inline bool isValid() const { return data != nullptr; }
+	};
+
+	//Generational reference to a row. Survives other rows being released, and stops resolving once its own row is released.
+	struct RowHandle
+	{
+		uint32_t index = 0;
+		uint32_t generation = 0; //Never 0 once issued, so default handles don't resolve
+
+		inline bool operator==(const RowHandle& other) const { return index == other.index && generation == other.generation; }
+		inline bool operator!=(const RowHandle& other) const { return !(*this == other); }
+	};
+	static constexpr size_t npos = ~size_t(0);
+
+	//hotFields: names of fields to split into their own columns. Empty = every field.
+	ENGINEMEM_API SoAMemoryPool(const TypeInfo& type, const std::vector<std::string>& hotFields = {}, size_t initialCapacity = 64);
+	ENGINEMEM_API ~SoAMemoryPool();
+
+	SoAMemoryPool(const SoAMemoryPool&) = delete;
+	SoAMemoryPool& operator=(const SoAMemoryPool&) = delete;
+
+	//Splits an object image across columns
+	ENGINEMEM_API RowHandle insert(const void* image);
+
+	template<typename TObj, typename... TCtorArgs>
+	inline RowHandle emplace(TCtorArgs... ctorArgs)
+	{
+		static_assert(std::is_trivially_copyable_v<TObj>, "SoA types are split and moved bytewise");
+		assert(TypeName::create<TObj>() == typeName);
+		TObj obj(ctorArgs...);
+		return insert(&obj);
+	}
+
+	ENGINEMEM_API void release(RowHandle handle); //Moves last row into the hole
+	ENGINEMEM_API void clear();
+	ENGINEMEM_API void reserve(size_t newCapacity);
+
+	ENGINEMEM_API size_t resolve(RowHandle handle) const; //Current row, or npos if released. O(1).
+	ENGINEMEM_API RowHandle getHandle(size_t row) const;
+	inline bool isAlive(RowHandle handle) const { return resolve(handle) != npos; }
+
+	//Reassemble or overwrite a whole object. Bytes not covered by any column (ie. padding) read as zero.
+	ENGINEMEM_API void gather(size_t row, void* imageOut) const;
+	ENGINEMEM_API void scatter(size_t row, const void* image);
+
+	ENGINEMEM_API const Column* findColumn(const std::string& fieldName) const;
+	inline const std::vector<Column>& getColumns() const { return columns; }
+
+	//Invalid view if there's no column for the field. T must match the field's size.
+	template<typename T>
+	inline ColumnView<T> getColumn(const std::string& fieldName) const
+	{
+		ColumnView<T> out;
+		if (const Column* c = findColumn(fieldName))
+		{
+			assert(c->size == sizeof(T));
+			out.data = (T*)c->data;
+			out.count = count;
+		}
+		return out;
+	}
+
+	inline size_t size() const { return count; }
+	inline size_t getCapacity() const { return capacity; }
+	inline size_t getObjectSize() const { return objectSize; }
+	inline const TypeName& getContentsTypeName() const { return typeName; }
+
+private:
+	TypeName typeName;
+	size_t objectSize;
+	std::vector<Column> columns;
+	bool hasColdColumn;
+	std::vector<std::pair<ptrdiff_t, size_t>> coldRuns; //(offset, size) in an object image, in packing order. Adjacent fields are merged.
+	size_t count;
+	size_t capacity;
+
+	//Same scheme as RawMemoryPool's handle table: rows and handle indices are paired, and releasing swaps the pairing.
+	struct HandleEntry
+	{
+		uint32_t row;
+		uint32_t generation;
+	};
+	std::vector<HandleEntry> handles; //By handle index
+	std::vector<uint32_t> rowHandles; //By row
+};
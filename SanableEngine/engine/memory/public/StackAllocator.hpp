@@ -2,35 +2,82 @@
 
 #include <cassert>
 #include <cstddef>
+#include <vector>
+
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
 
 #include "dllapi.h"
 
 class StackAllocator
 {
 private:
-    size_t maxSize;
-    size_t used;
-    char* memory;
+    //Memory is a chain of blocks, so growing never moves existing allocations.
+    //Blocks past the current one are kept as spares, and merged into one once the allocator is empty again.
+    struct Block
+    {
+        char* memory;
+        size_t size;
+    };
+    std::vector<Block> blocks;
+    size_t current; //Index of block being allocated from
+    size_t used; //Bytes used in current block
+    size_t usedBelow; //Bytes spanned by blocks before current, including any unused tails
+    size_t highWaterMark; //Most bytes ever spanned at once
+
+    void releaseBlocks();
 
 public:
     ENGINEMEM_API StackAllocator();
-    ENGINEMEM_API StackAllocator(size_t maxSize);
+    ENGINEMEM_API StackAllocator(size_t initialSize);
     ENGINEMEM_API ~StackAllocator();
 
-    ENGINEMEM_API void resize(size_t newSize);
+    StackAllocator(const StackAllocator&) = delete;
+    StackAllocator& operator=(const StackAllocator&) = delete;
 
-    ENGINEMEM_API void* allocRaw(size_t size);
+    ENGINEMEM_API void resize(size_t newSize); //Only while empty. Sets size of first block.
+
+    //Never fails: if the current block is full, the next spare is used, or a new block is chained on.
+    ENGINEMEM_API void* allocRaw(size_t size, size_t align = alignof(std::max_align_t));
 
     template <typename T>
-    inline T* alloc(size_t arrayCount = 1) { return (T*)allocRaw(sizeof(T)*arrayCount); }
+    inline T* alloc(size_t arrayCount = 1) { return (T*)allocRaw(sizeof(T)*arrayCount, alignof(T)); }
 
     class Checkpoint
     {
     private:
+        size_t block = 0;
         size_t used = 0;
         friend class StackAllocator;
     };
 
     ENGINEMEM_API Checkpoint markCheckpoint();
-    ENGINEMEM_API void restoreCheckpoint(const Checkpoint& c);
+    ENGINEMEM_API void restoreCheckpoint(const Checkpoint& c); //Restoring a default Checkpoint empties the allocator
+    inline void reset() { restoreCheckpoint(Checkpoint()); }
+
+    inline size_t getUsed() const { return usedBelow + used; }
+    inline size_t getHighWaterMark() const { return highWaterMark; }
+    ENGINEMEM_API size_t getCapacity() const;
+    inline size_t getBlockCount() const { return blocks.size(); }
+};
+
+#if __has_include(<memory_resource>)
+//Lets std::pmr containers allocate from a StackAllocator. Deallocation is a no-op: memory is reclaimed when the allocator is reset.
+class StackMemoryResource : public std::pmr::memory_resource
+{
+    StackAllocator* backing;
+
+public:
+    inline StackMemoryResource(StackAllocator* backing) : backing(backing) {}
+
+protected:
+    inline void* do_allocate(size_t bytes, size_t align) override { return backing->allocRaw(bytes, align); }
+    inline void do_deallocate(void*, size_t, size_t) override {}
+    inline bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        const StackMemoryResource* o = dynamic_cast<const StackMemoryResource*>(&other);
+        return o && o->backing == backing;
+    }
 };
+#endif
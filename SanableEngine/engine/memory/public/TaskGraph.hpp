@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <initializer_list>
+
+#include "dllapi.h"
+
+class JobSystem;
+
+//Persistent set of tasks with explicit dependencies, run once per call to run() (ie. once per frame) on a JobSystem.
+//A task starts as soon as everything it depends on has finished, so independent tasks overlap and scale with core count.
+//Tasks may use the JobSystem themselves (ie. PoolCallBatcher::parallelMemberCall). Tasks run on any thread, unless pinned with setCallingThreadOnly.
+class TaskGraph
+{
+public:
+	typedef size_t id_t;
+	static constexpr id_t npos = ~id_t(0);
+
+private:
+	struct Task
+	{
+		std::string name;
+		std::function<void()> fn; //Empty if removed
+		std::vector<id_t> dependencies;
+		std::vector<id_t> dependents; //Built by compile()
+		std::vector<id_t> readyScratch; //Dependents this task launches when it finishes. Same size as dependents.
+		bool callingThreadOnly = false;
+	};
+
+	//What a batch of launched tasks needs to find its way back here. One per ready list, since those live as long as the run.
+	struct Launch
+	{
+		TaskGraph* graph;
+		const id_t* ready;
+	};
+	std::vector<Task> tasks;
+	std::vector<id_t> freeIds;
+
+	//Compiled view, rebuilt lazily after edits
+	bool dirty = true;
+	std::vector<id_t> roots;
+	std::unique_ptr<std::atomic<size_t>[]> remainingDeps; //Per task, counted down during run()
+	size_t remainingDepsSize = 0;
+	std::vector<id_t> serialOrder; //Scratch copy of roots for run()
+	std::vector<Launch> launches; //Per task, for its readyScratch. Plus one more at the end, for the roots.
+	void compile();
+
+	//Per-run state
+	JobSystem* jobs = nullptr;
+	std::thread::id callingThread;
+	std::atomic<size_t> nFinished;
+	size_t nLive = 0;
+	std::mutex callingThreadLock;
+	std::vector<id_t> callingThreadQueue; //Ready tasks that only the thread in run() may take
+
+	void launch(id_t* ready, size_t count, Launch& launchCtx); //Reorders ready
+	void runTask(id_t id);
+	bool dependsOn(id_t task, id_t other) const; //Transitively
+
+public:
+	ENGINEMEM_API TaskGraph();
+	ENGINEMEM_API ~TaskGraph();
+
+	TaskGraph(const TaskGraph&) = delete;
+	TaskGraph& operator=(const TaskGraph&) = delete;
+
+	//Dependencies must already exist, so the graph can't have cycles. Names are for lookup and debugging, and must be unique.
+	//Returns npos if the name is taken or a dependency doesn't exist.
+	ENGINEMEM_API id_t add(const std::string& name, const std::function<void()>& fn, std::initializer_list<id_t> dependencies = {});
+	ENGINEMEM_API id_t add(const std::string& name, const std::function<void()>& fn, const std::vector<id_t>& dependencies);
+
+	//Makes task wait for dependency, ie. to run a new task before an existing one. Returns false if it would create a cycle.
+	ENGINEMEM_API bool addDependency(id_t task, id_t dependency);
+
+	//Pinned tasks only run on the thread that called run(), ie. for code that touches SDL or GL or assumes it's on the main thread.
+	ENGINEMEM_API void setCallingThreadOnly(id_t task, bool pinned);
+
+	//Tasks that depended on this one no longer wait for it. Plugins must remove their tasks before their code is unloaded.
+	ENGINEMEM_API void remove(id_t task);
+	ENGINEMEM_API void clear();
+
+	ENGINEMEM_API id_t find(const std::string& name) const; //Returns npos if not found
+	ENGINEMEM_API size_t getTaskCount() const;
+
+	//Runs every task once, respecting dependencies, and returns once all are done. Ready tasks are handed to jobs without
+	//blocking whoever finished their dependencies. While waiting, the calling thread runs pinned tasks as they become ready,
+	//and helps with other queued jobs in between. If jobs is null, or has no workers, tasks run serially on the calling thread
+	//in dependency order.
+	//Not reentrant: tasks must not edit or run the graph that's running them.
+	ENGINEMEM_API void run(JobSystem* jobs);
+};
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "RawMemoryPool.hpp"
+#include "Handle.hpp"
 #include "TypeInfo.hpp"
+#include "ParallelSafe.hpp"
 
 class MemoryManager;
 class GenericTypedMemoryPool;
@@ -34,9 +36,13 @@ public:
 
 	//Pass through
 	inline void release(TObj* obj) { impl->release(obj); }
+	inline Handle<TObj> getHandle(TObj* obj) const { return Handle<TObj>(impl->getHandle(obj)); }
+	inline TObj* resolve(const Handle<TObj>& handle) const { return (TObj*) impl->resolve(handle.getRaw()); } //Skips registry lookup
 
 	inline RawMemoryPool::const_iterator cbegin() const { return impl->cbegin(); }
 	inline RawMemoryPool::const_iterator cend  () const { return impl->cend  (); }
+	template<typename TFunc> inline void foreachLiveSpan(TFunc&& visitor) const { impl->foreachLiveSpan(visitor); }
+	template<typename TFunc> inline void foreachLive    (TFunc&& visitor) const { impl->foreachLive    (visitor); }
 	
 protected:
 	TypedMemoryPool(TypedMemoryPool&&) = delete;
@@ -50,22 +56,30 @@ class GenericTypedMemoryPool : public RawMemoryPool
 protected:
 	TypeInfo contentsType;
 	TypedMemoryPool<void> view; //Needs to be cast to be used safely
+	bool parallelSafe = false;
+	bool contentsTypeResolved = false; //False while contentsType is still the dummy from create(). See MemoryManager::ensureFresh.
+	friend class MemoryManager;
 
-	ENGINEMEM_API GenericTypedMemoryPool(size_t maxNumObjects, const TypeInfo& contentsType);
+	ENGINEMEM_API GenericTypedMemoryPool(size_t maxNumObjects, const TypeInfo& contentsType, StorageMode storageMode);
 public:
 	ENGINEMEM_API ~GenericTypedMemoryPool();
 
 	ENGINEMEM_API bool isLoaded() const;
 	ENGINEMEM_API const TypeInfo* getContentsType() const;
 	ENGINEMEM_API TypeName getContentsTypeName() const;
+	inline bool isParallelSafe() const { return parallelSafe; } //See is_parallel_safe
 
 	template<typename TObj>
-	[[nodiscard]] static GenericTypedMemoryPool* create(size_t maxNumObjects = 64)
+	[[nodiscard]] static GenericTypedMemoryPool* create(size_t maxNumObjects = 64, StorageMode storageMode = StorageMode::Contiguous)
 	{
-		return new GenericTypedMemoryPool(
+		GenericTypedMemoryPool* pool = new GenericTypedMemoryPool(
 			maxNumObjects,
-			TypeInfo::createDummy<TObj>() //No need to resolve dummy TypeInfo here. Engine will call refreshObjects after all TypeInfos are registered.
+			TypeInfo::createDummy<TObj>(), //No need to resolve dummy TypeInfo here. Engine will call refreshObjects after all TypeInfos are registered.
+			storageMode
 		);
+		pool->parallelSafe = is_parallel_safe<TObj>::value;
+		if (is_spawned_concurrently<TObj>::value) pool->setThreadSafe(true);
+		return pool;
 	}
 
 	template<typename TObj>
@@ -0,0 +1,251 @@
+#include "ArchetypeStorage.hpp"
+
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+
+static std::atomic<uint64_t> nextSerial = 1; //0 never matches, so empty cache slots miss
+
+ArchetypeStorage::ArchetypeStorage() :
+	chunkPool(0, CHUNK_BYTES, COLUMN_ALIGN, RawMemoryPool::StorageMode::Reserved), //Commits as it fills
+	nEntities(0),
+	serial(nextSerial++)
+{
+	getOrCreateArchetype({}); //Where new entities start
+}
+
+ArchetypeStorage::~ArchetypeStorage()
+{
+	clear();
+}
+
+ArchetypeStorage::typeid_t ArchetypeStorage::registerType(const TypeInfo& type)
+{
+	auto it = typesByName.find(type.name);
+	if (it != typesByName.end()) return it->second;
+
+	assert(types.size() < UINT16_MAX);
+	typeid_t id = (typeid_t)types.size();
+	types.push_back(ComponentType{ type.name, type.layout.size, type.layout.align, type.capabilities.rawDtor });
+	typesByName.emplace(type.name, id);
+	return id;
+}
+
+int ArchetypeStorage::Archetype::findColumn(typeid_t type) const
+{
+	auto it = std::lower_bound(signature.begin(), signature.end(), type);
+	return (it != signature.end() && *it == type) ? int(it - signature.begin()) : -1;
+}
+
+ArchetypeStorage::Archetype* ArchetypeStorage::getOrCreateArchetype(std::vector<typeid_t>&& signature)
+{
+	auto it = archetypesBySignature.find(signature);
+	if (it != archetypesBySignature.end()) return it->second;
+
+	Archetype& a = archetypes.emplace_back();
+	a.signature = std::move(signature);
+	a.columnOffsets.resize(a.signature.size());
+	a.columnSizes.resize(a.signature.size());
+	for (size_t i = 0; i < a.signature.size(); ++i) a.columnSizes[i] = (uint32_t)types[a.signature[i]].size;
+
+	//Fit as many rows as possible, then back off until padding also fits
+	size_t rowBytes = sizeof(Entity);
+	for (uint32_t size : a.columnSizes) rowBytes += size;
+	for (a.chunkCapacity = uint32_t(CHUNK_BYTES / rowBytes); a.chunkCapacity > 0; --a.chunkCapacity)
+	{
+		size_t offset = sizeof(Entity) * a.chunkCapacity;
+		for (size_t i = 0; i < a.signature.size(); ++i)
+		{
+			size_t align = std::max(types[a.signature[i]].align, COLUMN_ALIGN);
+			offset = (offset + align-1) / align * align;
+			a.columnOffsets[i] = (uint32_t)offset;
+			offset += a.columnSizes[i] * a.chunkCapacity;
+		}
+		if (offset <= CHUNK_BYTES) break;
+	}
+	assert(a.chunkCapacity > 0 && "Components too large to fit a single row in a chunk");
+
+	archetypesBySignature.emplace(a.signature, &a);
+	return &a;
+}
+
+ArchetypeStorage::Archetype* ArchetypeStorage::getNeighbour(Archetype* from, typeid_t type, bool adding)
+{
+	std::vector<std::pair<typeid_t, Archetype*>>& edges = adding ? from->addEdges : from->removeEdges;
+	for (const auto& e : edges) if (e.first == type) return e.second;
+
+	std::vector<typeid_t> signature = from->signature;
+	auto it = std::lower_bound(signature.begin(), signature.end(), type);
+	if (adding) signature.insert(it, type);
+	else signature.erase(it);
+
+	Archetype* to = getOrCreateArchetype(std::move(signature));
+	edges.emplace_back(type, to);
+	(adding ? to->removeEdges : to->addEdges).emplace_back(type, from); //Going back is just as likely
+	return to;
+}
+
+size_t ArchetypeStorage::pushRow(Archetype* archetype, Entity entity)
+{
+	if (archetype->count == archetype->chunks.size() * archetype->chunkCapacity)
+	{
+		char* chunk = (char*)chunkPool.allocate();
+		assert(chunk);
+		archetype->chunks.push_back(chunk);
+	}
+
+	size_t row = archetype->count++;
+	archetype->getEntity(row) = entity;
+	return row;
+}
+
+void ArchetypeStorage::removeRow(Archetype* archetype, size_t row)
+{
+	//Fill the hole with the last row, so tables stay dense
+	size_t last = archetype->count-1;
+	if (row != last)
+	{
+		for (size_t i = 0; i < archetype->signature.size(); ++i) memcpy(archetype->getCell(i, row), archetype->getCell(i, last), archetype->columnSizes[i]);
+		Entity moved = archetype->getEntity(last);
+		archetype->getEntity(row) = moved;
+		records[moved.index].row = row;
+	}
+	archetype->count--;
+
+	//Give back chunks once they empty out
+	if (archetype->count == (archetype->chunks.size()-1) * archetype->chunkCapacity)
+	{
+		chunkPool.release(archetype->chunks.back());
+		archetype->chunks.pop_back();
+	}
+}
+
+ArchetypeStorage::Entity ArchetypeStorage::create()
+{
+	uint32_t index;
+	if (!freeRecords.empty())
+	{
+		index = freeRecords.back();
+		freeRecords.pop_back();
+	}
+	else
+	{
+		index = (uint32_t)records.size();
+		records.push_back(EntityRecord{ nullptr, 0, 1 });
+	}
+
+	Entity out { index, records[index].generation };
+	Archetype* empty = &archetypes[0];
+	records[index].archetype = empty;
+	records[index].row = pushRow(empty, out);
+	nEntities++;
+	return out;
+}
+
+bool ArchetypeStorage::isAlive(Entity entity) const
+{
+	return entity.index < records.size()
+		&& records[entity.index].archetype
+		&& records[entity.index].generation == entity.generation;
+}
+
+void ArchetypeStorage::destroy(Entity entity)
+{
+	if (!isAlive(entity)) return;
+
+	EntityRecord& record = records[entity.index];
+	Archetype* archetype = record.archetype;
+	for (size_t i = 0; i < archetype->signature.size(); ++i)
+	{
+		if (dtor_t dtor = types[archetype->signature[i]].dtor) dtor(archetype->getCell(i, record.row));
+	}
+	removeRow(archetype, record.row);
+
+	record.archetype = nullptr;
+	record.generation++; //Old handles stop resolving
+	freeRecords.push_back(entity.index);
+	nEntities--;
+}
+
+void ArchetypeStorage::clear()
+{
+	for (Archetype& a : archetypes)
+	{
+		for (size_t row = 0; row < a.count; ++row)
+		{
+			for (size_t i = 0; i < a.signature.size(); ++i)
+			{
+				if (dtor_t dtor = types[a.signature[i]].dtor) dtor(a.getCell(i, row));
+			}
+
+			Entity e = a.getEntity(row);
+			records[e.index].archetype = nullptr;
+			records[e.index].generation++;
+			freeRecords.push_back(e.index);
+		}
+		a.count = 0;
+
+		for (char* chunk : a.chunks) chunkPool.release(chunk);
+		a.chunks.clear();
+	}
+	nEntities = 0;
+}
+
+void* ArchetypeStorage::migrate(Entity entity, Archetype* to, typeid_t changedType)
+{
+	EntityRecord& record = records[entity.index];
+	Archetype* from = record.archetype;
+	size_t newRow = pushRow(to, entity);
+
+	//Carry over what both tables have, and destroy what the new one doesn't
+	for (size_t i = 0; i < from->signature.size(); ++i)
+	{
+		void* src = from->getCell(i, record.row);
+		int column = to->findColumn(from->signature[i]);
+		if (column != -1) memcpy(to->getCell(column, newRow), src, from->columnSizes[i]);
+		else if (dtor_t dtor = types[from->signature[i]].dtor) dtor(src);
+	}
+	removeRow(from, record.row);
+
+	record.archetype = to;
+	record.row = newRow;
+
+	int column = to->findColumn(changedType);
+	return column != -1 ? to->getCell(column, newRow) : nullptr;
+}
+
+void* ArchetypeStorage::addRaw(Entity entity, typeid_t type)
+{
+	if (!isAlive(entity)) return nullptr;
+	Archetype* from = records[entity.index].archetype;
+	if (from->findColumn(type) != -1) return nullptr;
+	return migrate(entity, getNeighbour(from, type, true), type);
+}
+
+bool ArchetypeStorage::removeRaw(Entity entity, typeid_t type)
+{
+	if (!isAlive(entity)) return false;
+	Archetype* from = records[entity.index].archetype;
+	if (from->findColumn(type) == -1) return false;
+	migrate(entity, getNeighbour(from, type, false), type);
+	return true;
+}
+
+void* ArchetypeStorage::getRaw(Entity entity, typeid_t type)
+{
+	if (!isAlive(entity)) return nullptr;
+	const EntityRecord& record = records[entity.index];
+	int column = record.archetype->findColumn(type);
+	return column != -1 ? record.archetype->getCell(column, record.row) : nullptr;
+}
+
+void* ArchetypeStorage::get(Entity entity, const TypeName& type)
+{
+	auto it = typesByName.find(type);
+	return it != typesByName.end() ? getRaw(entity, it->second) : nullptr;
+}
+
+size_t ArchetypeStorage::getStorageBytes() const
+{
+	return chunkPool.getStorageBytes();
+}
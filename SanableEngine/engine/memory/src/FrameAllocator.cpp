@@ -0,0 +1,80 @@
+#include "FrameAllocator.hpp"
+
+#include <atomic>
+#include <algorithm>
+
+FrameAllocator::FrameAllocator(size_t initialSize) :
+	initialSize(initialSize),
+	frameParity(0)
+{
+	static std::atomic<uint64_t> nextSerial = 1;
+	serial = nextSerial++;
+}
+
+FrameAllocator::~FrameAllocator()
+{
+}
+
+FrameAllocator::ThreadArenas* FrameAllocator::getThreadArenas()
+{
+	//Arenas this thread used recently, direct-mapped by serial. Hits never lock.
+	struct RecentArenas
+	{
+		uint64_t serial;
+		ThreadArenas* arenas;
+	};
+	constexpr size_t nRecent = 4;
+	static thread_local RecentArenas recent[nRecent] = {};
+
+	RecentArenas& slot = recent[serial % nRecent];
+	if (slot.serial == serial) return slot.arenas;
+
+	//Miss: find or create under lock
+	std::lock_guard<std::mutex> guard(lock);
+	std::thread::id self = std::this_thread::get_id();
+	auto it = std::find_if(threads.begin(), threads.end(), [&](const std::unique_ptr<ThreadArenas>& a) { return a->owner == self; });
+	if (it == threads.end())
+	{
+		threads.emplace_back(new ThreadArenas());
+		ThreadArenas* a = threads.back().get();
+		a->owner = self;
+		a->thisFrame.resize(initialSize);
+		a->twoFrame[0].resize(initialSize);
+		a->twoFrame[1].resize(initialSize);
+		it = threads.end()-1;
+	}
+	slot = RecentArenas{ serial, it->get() };
+	return slot.arenas;
+}
+
+StackAllocator* FrameAllocator::thisFrame()
+{
+	return &getThreadArenas()->thisFrame;
+}
+
+StackAllocator* FrameAllocator::untilNextFrame()
+{
+	return &getThreadArenas()->twoFrame[frameParity];
+}
+
+void FrameAllocator::beginFrame()
+{
+	frameParity = 1-frameParity;
+
+	std::lock_guard<std::mutex> guard(lock);
+	for (const std::unique_ptr<ThreadArenas>& a : threads)
+	{
+		a->thisFrame.reset();
+		a->twoFrame[frameParity].reset(); //Held allocations from two frames ago
+	}
+}
+
+size_t FrameAllocator::getHighWaterMark() const
+{
+	size_t out = 0;
+	for (const std::unique_ptr<ThreadArenas>& a : threads)
+	{
+		out = std::max(out, a->thisFrame.getHighWaterMark() + std::max(a->twoFrame[0].getHighWaterMark(), a->twoFrame[1].getHighWaterMark()));
+	}
+	return out;
+}
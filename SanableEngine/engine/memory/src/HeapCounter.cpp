@@ -0,0 +1,43 @@
+#include "HeapCounter.hpp"
+
+#include <atomic>
+
+static std::atomic<size_t> allocCount = 0;
+static std::atomic<bool> hooked = false;
+
+void HeapCounter::recordAlloc()
+{
+	allocCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void HeapCounter::setHooked()
+{
+	hooked.store(true, std::memory_order_relaxed);
+}
+
+#if _MSC_VER && _DEBUG
+
+#include <crtdbg.h>
+
+static int countingAllocHook(int allocType, void*, size_t, int, long, const unsigned char*, int)
+{
+	if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC) HeapCounter::recordAlloc();
+	return TRUE;
+}
+
+static struct InstallHook
+{
+	InstallHook() { _CrtSetAllocHook(countingAllocHook); HeapCounter::setHooked(); }
+} installHook;
+
+#endif
+
+bool HeapCounter::isAvailable()
+{
+	return hooked.load(std::memory_order_relaxed);
+}
+
+size_t HeapCounter::getAllocCount()
+{
+	return allocCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,206 @@
+#include "JobSystem.hpp"
+
+#include <deque>
+#include <algorithm>
+
+struct JobSystem::Batch
+{
+	void(*fn)(void*, size_t);
+	void* ctx;
+	std::atomic<size_t> remaining;
+	bool detached; //Heap-allocated by parallelForAsync, and deleted by whoever runs its last index
+};
+
+struct JobSystem::Range
+{
+	Batch* batch;
+	size_t begin;
+	size_t end;
+};
+
+struct JobSystem::Queue
+{
+	std::mutex lock;
+	std::deque<Range> ranges;
+};
+
+//Which queue the current thread owns, if it's a worker
+static thread_local const JobSystem* tlsOwner = nullptr;
+static thread_local size_t tlsQueue = 0;
+static thread_local size_t tlsTaskDepth = 0; //Tasks can nest, since waiting threads help out
+
+JobSystem::JobSystem() :
+	JobSystem(std::max(std::thread::hardware_concurrency(), 1u) - 1)
+{
+}
+
+JobSystem::JobSystem(size_t nWorkers) :
+	pending(0),
+	stopping(false)
+{
+	for (size_t i = 0; i < nWorkers+1; ++i) queues.emplace_back(new Queue());
+	for (size_t i = 0; i < nWorkers; ++i) workers.emplace_back(&JobSystem::workerMain, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& t : workers) t.join();
+}
+
+size_t JobSystem::getOwnQueue() const
+{
+	return (tlsOwner == this) ? tlsQueue : queues.size()-1;
+}
+
+void JobSystem::workerMain(size_t queueIndex)
+{
+	tlsOwner = this;
+	tlsQueue = queueIndex;
+
+	while (true)
+	{
+		if (runOne(queueIndex)) continue;
+
+		//Nothing to steal. If everything submitted has already been claimed, sleep until more arrives.
+		std::unique_lock<std::mutex> lock(sleepLock);
+		if (stopping) return;
+		if (pending.load() == 0) wake.wait(lock, [&]() { return stopping || pending.load() > 0; });
+		else
+		{
+			lock.unlock();
+			std::this_thread::yield(); //Others are finishing the last ranges
+		}
+	}
+}
+
+bool JobSystem::runOne(size_t queueIndex)
+{
+	Range r;
+	bool found = false;
+
+	//Own queue first, newest (smallest, most recently split) range
+	{
+		Queue& own = *queues[queueIndex];
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (!own.ranges.empty())
+		{
+			r = own.ranges.back();
+			own.ranges.pop_back();
+			found = true;
+		}
+	}
+
+	//Otherwise steal oldest (largest) range from someone else
+	for (size_t i = 1; i < queues.size() && !found; ++i)
+	{
+		Queue& victim = *queues[(queueIndex+i) % queues.size()];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.ranges.empty())
+		{
+			r = victim.ranges.front();
+			victim.ranges.pop_front();
+			found = true;
+		}
+	}
+
+	if (!found) return false;
+
+	//Split off everything but the first index, halving each time, so thieves can take big pieces
+	if (r.end - r.begin > 1)
+	{
+		Queue& own = *queues[queueIndex];
+		std::lock_guard<std::mutex> guard(own.lock);
+		while (r.end - r.begin > 1)
+		{
+			size_t mid = r.begin + (r.end - r.begin)/2;
+			own.ranges.push_back(Range{ r.batch, mid, r.end });
+			r.end = mid;
+		}
+	}
+
+	tlsTaskDepth++;
+	r.batch->fn(r.batch->ctx, r.begin);
+	tlsTaskDepth--;
+	pending.fetch_sub(1);
+	bool detached = r.batch->detached; //Read first: once remaining hits 0, a waiting parallelFor may return and free its batch
+	if (r.batch->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && detached) delete r.batch;
+	return true;
+}
+
+bool JobSystem::tryRunOne()
+{
+	return runOne(getOwnQueue());
+}
+
+bool JobSystem::isInTask()
+{
+	return tlsTaskDepth > 0;
+}
+
+void JobSystem::submit(Batch* batch, size_t count)
+{
+	//Seed one slice per worker, so they don't all start by stealing from us
+	size_t self = getOwnQueue();
+	size_t nSlices = std::min(count, workers.size()+1);
+	for (size_t i = 0; i < nSlices; ++i)
+	{
+		Queue& q = *queues[(self+i) % queues.size()];
+		std::lock_guard<std::mutex> guard(q.lock);
+		q.ranges.push_back(Range{ batch, count*i/nSlices, count*(i+1)/nSlices });
+	}
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		pending += count;
+	}
+	wake.notify_all();
+}
+
+void JobSystem::parallelForAsync(size_t count, void(*fn)(void*, size_t), void* ctx)
+{
+	if (count == 0) return;
+
+	//Nobody else could run it
+	if (workers.empty())
+	{
+		for (size_t i = 0; i < count; ++i) fn(ctx, i);
+		return;
+	}
+
+	Batch* batch = new Batch();
+	batch->fn = fn;
+	batch->ctx = ctx;
+	batch->remaining = count;
+	batch->detached = true;
+	submit(batch, count);
+}
+
+void JobSystem::parallelFor_internal(size_t count, void(*fn)(void*, size_t), void* ctx)
+{
+	if (count == 0) return;
+
+	//Not worth waking anyone
+	if (workers.empty() || count == 1)
+	{
+		for (size_t i = 0; i < count; ++i) fn(ctx, i);
+		return;
+	}
+
+	Batch batch;
+	batch.fn = fn;
+	batch.ctx = ctx;
+	batch.remaining = count;
+	batch.detached = false;
+	submit(&batch, count);
+
+	//Help out until our batch is done. Might run other batches' work too, which is fine.
+	size_t self = getOwnQueue();
+	while (batch.remaining.load(std::memory_order_acquire) > 0)
+	{
+		if (!runOne(self)) std::this_thread::yield();
+	}
+}
@@ -1,51 +1,123 @@
 #include "MemoryManager.hpp"
 
+#include <cassert>
+#include <fstream>
+#include <sstream>
+
 #include "GlobalTypeRegistry.hpp"
+#include "JobSystem.hpp"
 
-void MemoryManager::registerPool(GenericTypedMemoryPool* pool)
+GenericTypedMemoryPool* MemoryManager::registerPool(GenericTypedMemoryPool* pool)
 {
+	std::lock_guard<std::recursive_mutex> guard(poolsLock);
+
+	//Another thread might have made one in the meantime
+	auto existing = poolsByType.find(pool->getContentsTypeName());
+	if (existing != poolsByType.end())
+	{
+		delete pool;
+		return existing->second;
+	}
+
 	pools.push_back(pool);
+	poolsByType.emplace(pool->getContentsTypeName(), pool);
+	updatePoolStateHash(pool->getContentsTypeName());
+
+	//Start at the size it reached last session, so loading doesn't pay for growth
+	auto hint = loadedCapacityProfile.find(pool->getContentsTypeName().as_str());
+	if (hint != loadedCapacityProfile.end() && hint->second > pool->getMaxNumObjects()) pool->setMaxNumObjects(hint->second);
+	return pool;
+}
 
-	//Update state hash
-	poolStateHash ^= std::hash<TypeName>()(pool->getContentsTypeName());
-	poolStateHash = (poolStateHash*1103515245)+12345; //From glibc's rand()
+void MemoryManager::updatePoolStateHash(const TypeName& changedType)
+{
+	uint64_t hash = poolStateHash.load(std::memory_order_relaxed);
+	hash ^= std::hash<TypeName>()(changedType);
+	hash = (hash*1103515245)+12345; //From glibc's rand()
+	poolStateHash.store(hash, std::memory_order_release);
 }
 
 GenericTypedMemoryPool* MemoryManager::getSpecificPool(const TypeName& typeName)
 {
-	//Search for pool matching typename
-	auto it = std::find_if(pools.cbegin(), pools.cend(), [&](GenericTypedMemoryPool* p) { return p->getContentsTypeName() == typeName; });
-	if (it != pools.cend()) return *it;
+	std::lock_guard<std::recursive_mutex> guard(poolsLock);
+	auto it = poolsByType.find(typeName);
+	return it != poolsByType.end() ? it->second : nullptr;
+}
+
+GenericTypedMemoryPool* MemoryManager::findOwner(void* ptr)
+{
+	std::lock_guard<std::recursive_mutex> guard(poolsLock);
+	if (ownerIndexStateHash != poolStateHash || ownerIndexEpoch != RawMemoryPool::getAddressSpaceEpoch()) rebuildOwnerIndex();
+
+	//Find last range starting at or before ptr
+	auto it = std::upper_bound(ownerIndex.begin(), ownerIndex.end(), ptr, [](void* p, const OwnerRange& r) { return p < r.begin; });
+	if (it == ownerIndex.begin()) return nullptr;
+	--it;
+
+	//Ranges can be larger than what's actually usable, so defer to pool for final say
+	return (ptr < it->end && it->pool->contains(ptr)) ? it->pool : nullptr;
+}
+
+void MemoryManager::rebuildOwnerIndex()
+{
+	ownerIndex.clear();
+	std::vector<RawMemoryPool::AddressRange> ranges;
+	for (GenericTypedMemoryPool* p : pools)
+	{
+		ranges.clear();
+		p->getAddressRanges(ranges);
+		for (const RawMemoryPool::AddressRange& r : ranges) ownerIndex.push_back(OwnerRange{ r.begin, r.end, p });
+	}
+	std::sort(ownerIndex.begin(), ownerIndex.end(), [](const OwnerRange& a, const OwnerRange& b) { return a.begin < b.begin; });
 
-	//Nothing found!
-	return nullptr;
+	ownerIndexStateHash = poolStateHash;
+	ownerIndexEpoch = RawMemoryPool::getAddressSpaceEpoch();
 }
 
 void MemoryManager::foreachPool(const std::function<void(GenericTypedMemoryPool*)>& visitor)
 {
-	for (GenericTypedMemoryPool* i : pools) visitor(i);
+	std::lock_guard<std::recursive_mutex> guard(poolsLock);
+	for (size_t i = 0; i < pools.size(); ++i) visitor(pools[i]);
 }
 
 void MemoryManager::foreachPool(const std::function<void(const GenericTypedMemoryPool*)>& visitor) const
 {
-	for (const GenericTypedMemoryPool* i : pools) visitor(i);
+	std::lock_guard<std::recursive_mutex> guard(poolsLock);
+	for (size_t i = 0; i < pools.size(); ++i) visitor(pools[i]);
 }
 
 void MemoryManager::destroyPool(const TypeName& type)
 {
-	auto it = std::find_if(pools.cbegin(), pools.cend(), [&](GenericTypedMemoryPool* p) { return p->getContentsTypeName() == type; });
-	if (it != pools.cend())
+	assert(!JobSystem::isInTask());
+	std::lock_guard<std::recursive_mutex> guard(poolsLock);
+	auto it = poolsByType.find(type);
+	if (it != poolsByType.end())
 	{
-		delete *it;
-		pools.erase(it);
+		GenericTypedMemoryPool* pool = it->second;
+		recordPeak(pool);
+		poolsByType.erase(it);
+		pools.erase(std::find(pools.begin(), pools.end(), pool));
+		delete pool;
+
+		//Invalidates cached lookups and batchers
+		updatePoolStateHash(type);
 	}
 }
 
 MemoryManager::MemoryManager()
 {
-	poolStateHash = rand();
-	poolStateHash <<= 32;
-	poolStateHash |= rand();
+	static std::atomic<uint64_t> nextSerial = 1; //0 never matches, so empty cache slots miss
+	serial = nextSerial++;
+
+	uint64_t hash = rand();
+	hash <<= 32;
+	hash |= rand();
+	poolStateHash = hash;
+
+	ownerIndexStateHash = ~hash; //Force rebuild on first use
+	ownerIndexEpoch = 0;
+
+	fixupNsPerField = 2; //Rough guess, refined by each compact
 }
 
 MemoryManager::~MemoryManager()
@@ -55,39 +127,327 @@ MemoryManager::~MemoryManager()
 		delete i;
 	}
 	pools.clear();
+	poolsByType.clear();
+}
+
+void MemoryManager::flushDeferred()
+{
+	//Releasing one object can defer releases in another pool (ie. GameObject destroying its components), so repeat until settled
+	assert(!JobSystem::isInTask());
+	std::lock_guard<std::recursive_mutex> guard(poolsLock);
+	bool anyWork = true;
+	while (anyWork)
+	{
+		anyWork = false;
+		for (size_t i = 0; i < pools.size(); ++i) anyWork |= pools[i]->flushDeferred();
+	}
 }
 
 void MemoryManager::ensureFresh()
 {
+	//Objects still sitting in thread caches wouldn't be patched
+	flushDeferred();
+	std::lock_guard<std::recursive_mutex> guard(poolsLock);
+
 	std::unordered_set<TypeName> typesToPatch = GlobalTypeRegistry::getDirtyTypes();
 	
 	MemoryMapper remapper;
 
 	//Update the type data for contents of each pool
-	for (GenericTypedMemoryPool* p : pools)
+	for (size_t i = 0; i < pools.size(); ++i)
 	{
-		auto it = std::find_if(typesToPatch.cbegin(), typesToPatch.cend(), [&](const TypeName& i) { return i == p->getContentsTypeName(); });
+		GenericTypedMemoryPool* p = pools[i];
+		auto it = typesToPatch.find(p->getContentsTypeName());
 		if (it != typesToPatch.cend())
 		{
 			//Existing pools need to be patched
 			TypeInfo const* newTypeInfo = it->resolve();
 			if (newTypeInfo && newTypeInfo->isLoaded()) p->refreshObjects(*newTypeInfo, &remapper);
 		}
-		else if (!p->getContentsType())
+		else if (!p->contentsTypeResolved)
 		{
-			//New pools need to be given valid full TypeInfo, rather than dummy
+			//New pools need to be given valid full TypeInfo, rather than dummy. Type may have been loaded (and no longer dirty) long before the pool was made.
 			TypeInfo const* newTypeInfo = p->getContentsTypeName().resolve();
 			if (newTypeInfo && newTypeInfo->isLoaded()) p->refreshObjects(*newTypeInfo, &remapper);
 		}
 	}
 
+	//Layouts may have changed, so anything caching casts needs to refresh
+	if (!typesToPatch.empty()) updatePoolStateHash(TypeName());
+
 	//Finalize
 	updatePointers(remapper);
 }
 
+void MemoryManager::collectPointerFields(std::vector<PointerFields>& out) const
+{
+	out.clear();
+	for (GenericTypedMemoryPool* pool : pools)
+	{
+		const TypeInfo* type = pool->getContentsType();
+		if (!type) continue; //Can't see inside unloaded types
+
+		//Find every pointer-typed field, including inherited ones
+		PointerFields pf { pool, {}, {}, {} };
+		type->layout.walkFields(
+			[&](const FieldInfo& fi)
+			{
+				std::optional<TypeName> pointee = fi.type.dereference();
+				if (fi.size == sizeof(void*) && pointee.has_value())
+				{
+					pf.offsets.push_back(fi.offset + (ptrdiff_t)type->layout.upcast(nullptr, fi.owner));
+					pf.pointees.push_back(pointee.value());
+				}
+			},
+			MemberVisibility::All,
+			true
+		);
+		pf.needsFixup.resize(pf.offsets.size(), false);
+		if (!pf.offsets.empty()) out.push_back(std::move(pf));
+	}
+}
+
+bool MemoryManager::canPointInto(const TypeName& pointee, const GenericTypedMemoryPool* target)
+{
+	//Don't know what the target really is yet
+	if (!target->contentsTypeResolved) return true;
+	const TypeInfo* targetType = target->getContentsType();
+	if (!targetType) return true;
+
+	TypeName bare = pointee;
+	while (std::optional<TypeName> unwrapped = bare.cvUnwrap()) bare = unwrapped.value();
+	if (bare == targetType->name) return true;
+
+	//void*, or something RTTI doesn't know. Could be anything.
+	if (!bare.resolve()) return true;
+
+	//Pointer to a base. If part of the target's ancestry can't be seen, assume it might be in there.
+	return targetType->getParent(bare, MemberVisibility::All, true).has_value() || !targetType->isParentChainResolved();
+}
+
+size_t MemoryManager::fixPointerFields(const MemoryMapper& remapper, const std::vector<PointerFields>& fields)
+{
+	size_t nVisited = 0;
+	std::vector<ptrdiff_t> offsets;
+	for (const PointerFields& pf : fields)
+	{
+		offsets.clear();
+		for (size_t i = 0; i < pf.offsets.size(); ++i) if (pf.needsFixup[i]) offsets.push_back(pf.offsets[i]);
+		if (offsets.empty()) continue;
+
+		//Rewrite in one sweep over living objects
+		pf.pool->foreachLive(
+			[&](void* obj)
+			{
+				for (ptrdiff_t offset : offsets)
+				{
+					void** field = (void**)(((char*)obj) + offset);
+					if (*field) *field = remapper.transformAddress(*field, 1);
+				}
+			}
+		);
+		nVisited += offsets.size() * pf.pool->getNumAllocatedObjects();
+	}
+	return nVisited;
+}
+
 void MemoryManager::updatePointers(const MemoryMapper& remapper)
 {
-	//TODO implement
+	assert(!JobSystem::isInTask());
+	if (remapper.isEmpty()) return;
+	std::lock_guard<std::recursive_mutex> guard(poolsLock);
+
+	std::vector<PointerFields> fields;
+	collectPointerFields(fields);
+	for (PointerFields& pf : fields) pf.needsFixup.assign(pf.offsets.size(), true);
+	fixPointerFields(remapper, fields);
+}
+
+bool MemoryManager::compact(float threshold, std::chrono::nanoseconds budget, MemoryMapper* remapper)
+{
+	constexpr size_t movesPerSlice = 256; //Check the clock every so often, rather than every move
+
+	MemoryMapper localRemapper;
+	if (!remapper) remapper = &localRemapper;
+
+	flushDeferred(); //Make sure everything that will be alive is, so nothing is left behind
+	std::lock_guard<std::recursive_mutex> guard(poolsLock);
+
+	//Moving a pool's objects means sweeping every field that could point at them, so that sweep comes out of the budget too.
+	//Fields that can't point into any pool we touch are left alone.
+	std::vector<PointerFields> fields;
+	bool fieldsCollected = false;
+	double reservedNs = 0;
+
+	auto deadline = std::chrono::steady_clock::now() + budget;
+	bool finished = true;
+	bool anyMoved = false;
+	for (size_t i = 0; i < pools.size(); ++i)
+	{
+		GenericTypedMemoryPool* p = pools[i];
+		if (p->getFragmentation() < threshold) continue;
+
+		if (!fieldsCollected)
+		{
+			collectPointerFields(fields);
+			fieldsCollected = true;
+		}
+
+		//Extra fix-up work if this pool moves
+		std::vector<std::pair<size_t, size_t>> newFields;
+		double extraNs = 0;
+		for (size_t i = 0; i < fields.size(); ++i)
+		{
+			for (size_t j = 0; j < fields[i].offsets.size(); ++j)
+			{
+				if (!fields[i].needsFixup[j] && canPointInto(fields[i].pointees[j], p))
+				{
+					newFields.emplace_back(i, j);
+					extraNs += fields[i].pool->getNumAllocatedObjects() * fixupNsPerField;
+				}
+			}
+		}
+
+		auto moveDeadline = deadline - std::chrono::nanoseconds(int64_t(reservedNs + extraNs));
+		if (std::chrono::steady_clock::now() >= moveDeadline)
+		{
+			//Can't afford to fix up after this one. Others might be cheaper.
+			finished = false;
+			continue;
+		}
+		for (const auto& f : newFields) fields[f.first].needsFixup[f.second] = true;
+		reservedNs += extraNs;
+		anyMoved = true;
+
+		bool poolDone = false;
+		while (!poolDone && std::chrono::steady_clock::now() < moveDeadline) poolDone = p->compact(movesPerSlice, remapper);
+		if (!poolDone)
+		{
+			finished = false;
+			break;
+		}
+	}
+
+	//Pools themselves didn't move, so cached lookups and batchers stay valid. Only pointers to objects need fixing.
+	if (anyMoved && !remapper->isEmpty())
+	{
+		auto fixupStart = std::chrono::steady_clock::now();
+		size_t nVisited = fixPointerFields(*remapper, fields);
+		if (nVisited)
+		{
+			double measured = double(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - fixupStart).count()) / nVisited;
+			fixupNsPerField = (fixupNsPerField*3 + measured) / 4; //Smooth out noise from small sweeps
+		}
+	}
+	return finished;
+}
+
+//Bytes worth keeping from each object. Vptrs are skipped since restore writes them with vptrJam instead.
+static void getSnapshotRuns(const GenericTypedMemoryPool* pool, std::vector<std::pair<size_t, size_t>>& out)
+{
+	out.clear();
+	const TypeInfo* type = pool->getContentsType();
+	if (type) type->layout.walkDataRuns([&](size_t offset, size_t size) { out.emplace_back(offset, size); });
+	else out.emplace_back(0, pool->getMaxObjectSize()); //Can't see inside unloaded types
+}
+
+MemorySnapshot MemoryManager::snapshot(const MemorySnapshot* base)
+{
+	assert(!JobSystem::isInTask());
+	std::lock_guard<std::recursive_mutex> guard(poolsLock);
+	MemorySnapshot out;
+	out.pools.reserve(pools.size());
+
+	std::vector<std::pair<size_t, size_t>> runs;
+	for (size_t i = 0; i < pools.size(); ++i)
+	{
+		GenericTypedMemoryPool* pool = pools[i];
+		getSnapshotRuns(pool, runs);
+		out.pools.push_back(MemorySnapshot::PoolEntry{ pool->getContentsTypeName(), RawMemoryPool::State() });
+		pool->captureState(out.pools.back().state, runs, base ? base->find(pool->getContentsTypeName()) : nullptr);
+	}
+
+	return out;
+}
+
+void MemoryManager::restore(const MemorySnapshot& snapshot)
+{
+	assert(!JobSystem::isInTask());
+	std::lock_guard<std::recursive_mutex> guard(poolsLock);
+	std::vector<std::pair<size_t, size_t>> runs;
+	for (size_t i = 0; i < pools.size(); ++i)
+	{
+		GenericTypedMemoryPool* pool = pools[i];
+		const RawMemoryPool::State* state = snapshot.find(pool->getContentsTypeName());
+		if (!state) continue;
+
+		getSnapshotRuns(pool, runs);
+		pool->restoreState(*state, runs);
+
+		//Fill in vptrs
+		const TypeInfo* type = pool->getContentsType();
+		bool hasImplicitValues = false;
+		if (type) type->layout.walkImplicitValues([&](size_t, size_t, const char*) { hasImplicitValues = true; });
+		if (hasImplicitValues) pool->foreachLive([&](void* obj) { type->layout.vptrJam(obj); });
+	}
+}
+
+void MemoryManager::recordPeak(const GenericTypedMemoryPool* pool)
+{
+	size_t& peak = sessionCapacityProfile[pool->getContentsTypeName().as_str()];
+	peak = std::max(peak, pool->getPeakNumAllocatedObjects()); //Pool might have been destroyed and recreated (ie. plugin reload)
+}
+
+bool MemoryManager::loadCapacityProfile(const std::filesystem::path& path)
+{
+	std::ifstream file(path);
+	if (!file) return false;
+	std::lock_guard<std::recursive_mutex> guard(poolsLock); //Pools being created read the profile
+
+	//One type per line: peak count, then type name (which may contain spaces)
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#') continue;
+
+		std::istringstream parse(line);
+		size_t peak;
+		if (!(parse >> peak)) continue;
+		parse.get(); //Separator
+		std::string name;
+		std::getline(parse, name);
+		if (!name.empty()) loadedCapacityProfile[name] = peak;
+	}
+
+	//Pools that already exist can still benefit
+	for (size_t i = 0; i < pools.size(); ++i)
+	{
+		GenericTypedMemoryPool* pool = pools[i];
+		auto hint = loadedCapacityProfile.find(pool->getContentsTypeName().as_str());
+		if (hint != loadedCapacityProfile.end() && hint->second > pool->getMaxNumObjects()) pool->setMaxNumObjects(hint->second);
+	}
+	return true;
+}
+
+bool MemoryManager::saveCapacityProfile(const std::filesystem::path& path) const
+{
+	//This session's peaks win, but keep history for types we didn't see
+	std::lock_guard<std::recursive_mutex> guard(poolsLock);
+	std::unordered_map<std::string, size_t> merged = loadedCapacityProfile;
+	for (const auto& [name, peak] : sessionCapacityProfile) merged[name] = peak;
+	for (size_t i = 0; i < pools.size(); ++i)
+	{
+		const GenericTypedMemoryPool* pool = pools[i];
+		std::string name = pool->getContentsTypeName().as_str();
+		auto session = sessionCapacityProfile.find(name);
+		merged[name] = std::max(pool->getPeakNumAllocatedObjects(), session != sessionCapacityProfile.end() ? session->second : 0);
+	}
+
+	std::ofstream file(path, std::ios::trunc);
+	if (!file) return false;
+	file << "# Pool capacity profile: peak object count, type name\n";
+	for (const auto& [name, peak] : merged) if (peak) file << peak << ' ' << name << '\n';
+	return bool(file);
 }
 
 uint64_t MemoryManager::getPoolStateHash() const
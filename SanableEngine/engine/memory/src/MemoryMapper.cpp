@@ -2,6 +2,8 @@
 
 #include <cstring>
 #include <cassert>
+#include <algorithm>
+#include <map>
 
 void MemoryMapper::rawMove(void* dst, void* src, size_t bytesToMove)
 {
@@ -20,26 +22,116 @@ void MemoryMapper::logMove(void* dst, void* src, size_t bytesToMove)
 	op.src = src;
 	op.dst = dst;
 	op.blockSize = bytesToMove;
+	op.concurrent = false;
+	opLog.push_back(op);
+}
+
+void MemoryMapper::logConcurrentMove(void* dst, void* src, size_t bytesToMove)
+{
+	if (!this) return;
+
+	RemapOp op;
+	op.src = src;
+	op.dst = dst;
+	op.blockSize = bytesToMove;
+	op.concurrent = !opLog.empty();
 	opLog.push_back(op);
 }
 
 void* MemoryMapper::transformAddress(void* ptr, size_t ptrSize) const
 {
-	for (const RemapOp& op : opLog)
+	if (nCompiledOps != opLog.size()) compile();
+
+	for (const std::vector<Interval>& layer : compiledLayers)
 	{
-		void* srcEnd = ((char*)op.src) + op.blockSize; //First byte NOT in remapped block
-		if (op.src <= ptr && ptr < srcEnd)
+		//Find last interval starting at or before ptr
+		auto it = std::upper_bound(layer.begin(), layer.end(), (char*)ptr, [](char* p, const Interval& i) { return p < i.srcBegin; });
+		if (it == layer.begin()) continue;
+		--it;
+
+		if (ptr < it->srcEnd)
 		{
 			void* lastByte = ((char*)ptr) + ptrSize - 1;
-			assert(lastByte < srcEnd); //Ensure last byte is also in range. No object shearing!
-			ptr = ((char*)ptr) - ((char*)op.src) + ((char*)op.dst);
+			assert(lastByte < it->srcEnd); //Ensure last byte is also in range. No object shearing!
+			ptr = ((char*)ptr) + it->delta;
 		}
 	}
 
 	return ptr;
 }
 
+void MemoryMapper::compile() const
+{
+	compiledLayers.clear();
+
+	//Split into layers. Start a new layer whenever an op touches memory an op in the current layer already touched,
+	//since then order matters. Typical logs (pool resizes) are a single layer.
+	std::vector<Interval> layer;
+	std::map<char*, char*> touched; //Disjoint ranges, begin -> end
+	auto overlapsTouched = [&](char* begin, char* end)
+	{
+		auto it = touched.upper_bound(begin);
+		if (it != touched.begin() && begin < std::prev(it)->second) return true;
+		return it != touched.end() && it->first < end;
+	};
+	auto markTouched = [&](char* begin, char* end)
+	{
+		//Absorb any ranges we overlap, so touched stays disjoint
+		auto first = touched.upper_bound(begin);
+		if (first != touched.begin() && begin < std::prev(first)->second) --first;
+		auto last = first;
+		for (; last != touched.end() && last->first < end; ++last)
+		{
+			begin = std::min(begin, last->first);
+			end   = std::max(end  , last->second);
+		}
+		touched.erase(first, last);
+		touched.emplace(begin, end);
+	};
+	auto finishLayer = [&]()
+	{
+		if (layer.empty()) return;
+
+		//Sort, then merge neighbours that moved by the same amount
+		std::sort(layer.begin(), layer.end(), [](const Interval& a, const Interval& b) { return a.srcBegin < b.srcBegin; });
+		std::vector<Interval> merged;
+		merged.reserve(layer.size());
+		for (const Interval& i : layer)
+		{
+			if (!merged.empty() && merged.back().srcEnd == i.srcBegin && merged.back().delta == i.delta) merged.back().srcEnd = i.srcEnd;
+			else merged.push_back(i);
+		}
+		compiledLayers.push_back(std::move(merged));
+		layer.clear();
+		touched.clear();
+	};
+
+	//Concurrent ops read memory as it was before their group, so destinations only count once the group is done
+	std::vector<std::pair<char*, char*>> pendingDsts;
+	for (const RemapOp& op : opLog)
+	{
+		if (!op.concurrent)
+		{
+			for (const auto& i : pendingDsts) markTouched(i.first, i.second);
+			pendingDsts.clear();
+		}
+
+		char* src = (char*)op.src;
+		char* dst = (char*)op.dst;
+		if (overlapsTouched(src, src+op.blockSize)) finishLayer();
+
+		layer.push_back(Interval{ src, src+op.blockSize, dst-src });
+		markTouched(src, src+op.blockSize);
+		pendingDsts.emplace_back(dst, dst+op.blockSize);
+	}
+	finishLayer();
+
+	nCompiledOps = opLog.size();
+}
+
 void MemoryMapper::clear()
 {
 	opLog.clear();
+	compiledLayers.clear();
+	nCompiledOps = 0;
 }
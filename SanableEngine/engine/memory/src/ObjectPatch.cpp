@@ -1,12 +1,47 @@
 #include "ObjectPatch.hpp"
 
 #include <cassert>
+#include <cstring>
+#include <algorithm>
+
+#include "MemoryMapper.hpp"
 
 void ObjectPatch::apply(void* target, MemoryMapper* remapLog) const
 {
 	if (oldData.isValid() && newData.isValid())
 	{
-		//TODO implement
+		char* obj = (char*)target;
+
+		//Snapshot old values if anything moves, so fields can't clobber each other
+		const char* src = obj;
+		if (needsScratch)
+		{
+			memcpy(scratch.data(), obj, scratch.size());
+			src = scratch.data();
+		}
+
+		for (const Op& op : ops)
+		{
+			switch (op.kind)
+			{
+			case Op::Kind::Copy:    memcpy(obj+op.dst, src+op.src, op.size); break;
+			case Op::Kind::Zero:    memset(obj+op.dst, 0, op.size); break;
+			case Op::Kind::Default: memcpy(obj+op.dst, defaultValues.data()+op.src, op.size); break;
+			}
+		}
+
+		//Let pointers to fields follow them. Fields all move at once, so swaps resolve correctly.
+		if (remapLog)
+		{
+			bool first = true;
+			for (const Op& op : ops)
+			{
+				if (op.kind != Op::Kind::Copy) continue;
+				if (first) remapLog->logMove(obj+op.dst, obj+op.src, op.size);
+				else remapLog->logConcurrentMove(obj+op.dst, obj+op.src, op.size);
+				first = false;
+			}
+		}
 	}
 }
 
@@ -30,14 +65,106 @@ void ObjectPatch::debugLog() const
 	else if (!oldData.isValid() && newData.isValid()) printf("%s is new!", newData.name.c_str());
 	else
 	{
-		//TODO print member diff
+		printf("%s: %zu -> %zu bytes\n", newData.name.c_str(), oldData.layout.size, newData.layout.size);
+		for (const Op& op : ops)
+		{
+			switch (op.kind)
+			{
+			case Op::Kind::Copy:    printf(" - Copy    %zu bytes @ %zu <- %zu\n", op.size, op.dst, op.src); break;
+			case Op::Kind::Zero:    printf(" - Zero    %zu bytes @ %zu\n"       , op.size, op.dst); break;
+			case Op::Kind::Default: printf(" - Default %zu bytes @ %zu\n"       , op.size, op.dst); break;
+			}
+		}
 	}
 }
 
+//Field with its offset from the start of the object, rather than from its owner
+struct AbsoluteField
+{
+	const FieldInfo* info;
+	size_t offset;
+	bool isOwn; //Declared directly on the type, rather than inherited
+};
+
+static std::vector<AbsoluteField> collectFields(const TypeInfo& type)
+{
+	std::vector<AbsoluteField> out;
+	type.layout.walkFields(
+		[&](const FieldInfo& fi)
+		{
+			out.push_back(AbsoluteField{ &fi, size_t(fi.offset + (ptrdiff_t)type.layout.upcast(nullptr, fi.owner)), false });
+		},
+		MemberVisibility::All,
+		true
+	);
+
+	//Parents are walked first, so own fields are whatever's at the end
+	size_t nOwn = 0;
+	type.layout.walkFields([&](const FieldInfo&) { ++nOwn; }, MemberVisibility::All, false);
+	for (size_t i = out.size()-nOwn; i < out.size(); ++i) out[i].isOwn = true;
+	return out;
+}
+
 ObjectPatch ObjectPatch::create(TypeInfo oldData, TypeInfo newData)
 {
 	ObjectPatch out;
 	out.oldData = oldData;
 	out.newData = newData;
+	if (!oldData.isValid() || !newData.isValid()) return out;
+
+	//Match fields by owner and name. Anything that changed type or size can't be carried over.
+	//Own fields are matched by name only, in case the owner's name was what changed.
+	std::vector<AbsoluteField> oldFields = collectFields(out.oldData);
+	std::vector<AbsoluteField> newFields = collectFields(out.newData);
+	if (oldFields.empty()) newFields.clear(); //Old layout is unknown (ie. a dummy, made before RTTI loaded). Leave data where it is.
+	for (const AbsoluteField& nf : newFields)
+	{
+		auto match = std::find_if(oldFields.begin(), oldFields.end(),
+			[&](const AbsoluteField& of)
+			{
+				return of.isOwn == nf.isOwn
+					&& (of.isOwn || of.info->owner == nf.info->owner)
+					&& of.info->name == nf.info->name;
+			}
+		);
+
+		if (match != oldFields.end() && match->info->type == nf.info->type && match->info->size == nf.info->size)
+		{
+			//Already in place, nothing to do
+			if (match->offset != nf.offset) out.ops.push_back(Op{ Op::Kind::Copy, nf.offset, match->offset, nf.info->size });
+		}
+		else out.ops.push_back(Op{ Op::Kind::Zero, nf.offset, 0, nf.info->size });
+	}
+
+	//Sort and coalesce neighbouring ops of the same kind
+	std::sort(out.ops.begin(), out.ops.end(), [](const Op& a, const Op& b) { return a.dst < b.dst; });
+	std::vector<Op> merged;
+	for (const Op& op : out.ops)
+	{
+		if (!merged.empty())
+		{
+			Op& prev = merged.back();
+			bool adjacent = prev.kind == op.kind && prev.dst+prev.size == op.dst;
+			if (adjacent && (op.kind == Op::Kind::Zero || prev.src+prev.size == op.src))
+			{
+				prev.size += op.size;
+				continue;
+			}
+		}
+		merged.push_back(op);
+	}
+	out.ops = std::move(merged);
+	out.needsScratch = std::any_of(out.ops.begin(), out.ops.end(), [](const Op& op) { return op.kind == Op::Kind::Copy; });
+	if (out.needsScratch) out.scratch.resize(out.oldData.layout.size);
+
+	//Implicit values go last, so they win over anything else
+	out.newData.layout.walkImplicitValues(
+		[&](size_t offset, size_t size, const char* values)
+		{
+			out.ops.push_back(Op{ Op::Kind::Default, offset, out.defaultValues.size(), size });
+			out.defaultValues.insert(out.defaultValues.end(), values, values+size);
+		}
+	);
+
 	return out;
 }
@@ -23,47 +23,42 @@ size_t _PoolCallBatcherBase::count() const
 	return cachedPoolList.size();
 }
 
-void _PoolCallBatcherBase::ensureFresh(MemoryManager* src, bool force)
+bool _PoolCallBatcherBase::ensureFresh(MemoryManager* src, bool force)
 {
 	uint64_t newHash = src->getPoolStateHash();
-	if (force || cachedStateHash != newHash)
-	{
-		cachedStateHash = newHash;
+	if (!force && cachedStateHash == newHash) return false;
 
-		cachedPoolList.clear();
-		src->foreachPool(
-			[&](const GenericTypedMemoryPool* pool)
+	cachedStateHash = newHash;
+
+	cachedPoolList.clear();
+	src->foreachPool(
+		[&](const GenericTypedMemoryPool* pool)
+		{
+			const TypeInfo* t = pool->getContentsType();
+			if (t)
 			{
-				const TypeInfo* t = pool->getContentsType();
-				if (t)
+				if (t->name == baseTypeName)
 				{
-					if (t->name == baseTypeName)
-					{
-						cachedPoolList.push_back(CachedPool{ pool, ParentInfo::identity(t->name, t->layout.size) });
-					}
-					else
-					{
-						std::optional<ParentInfo> p = t->getParent(baseTypeName);
-						if (p.has_value()) cachedPoolList.push_back(CachedPool{ pool, p.value() });
-					}
+					cachedPoolList.push_back(CachedPool{ pool, ParentInfo::identity(t->name, t->layout.size) });
+				}
+				else
+				{
+					std::optional<ParentInfo> p = t->getParent(baseTypeName);
+					if (p.has_value()) cachedPoolList.push_back(CachedPool{ pool, p.value() });
 				}
 			}
-		);
-	}
+		}
+	);
+	return true;
 }
 
-void _PoolCallBatcherBase::foreachObject(const std::function<void(void*)>& visitor) const
+const GenericTypedMemoryPool* _PoolCallBatcherBase::getPool(size_t index) const
 {
-	for (const CachedPool& i : cachedPoolList)
-	{
-		if (!skipUnloaded || i.pool->isLoaded())
-		{
-			for (auto it = i.pool->cbegin(); it != i.pool->cend(); ++it)
-			{
-				void* rawObj = *it;
-				void* casted = i.pool->getContentsType()->layout.upcast(rawObj, i.caster);
-				visitor(casted);
-			}
-		}
-	}
+	return cachedPoolList[index].pool;
+}
+
+bool _PoolCallBatcherBase::contains(const GenericTypedMemoryPool* pool) const
+{
+	for (const CachedPool& i : cachedPoolList) if (i.pool == pool) return true;
+	return false;
 }
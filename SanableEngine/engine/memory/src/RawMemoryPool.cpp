@@ -1,39 +1,130 @@
 #include "RawMemoryPool.hpp"
 
 #include <cstdlib>
+#include <cstring>
 #include <cassert>
 #include <iostream>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
 
 #include "alloc_detail.h"
+#include "bit_detail.h"
+#include "vmem_detail.h"
 
 using namespace std;
 
+//Per-thread slots for thread-safe pools. Only the owning thread touches these, except during flushDeferred.
+struct RawMemoryPool::ThreadCache
+{
+	std::thread::id owner;
+	std::vector<void*> freeSlots; //Claimed from pool but not handed out yet. Highest address first, so pops come out in order.
+	std::vector<void*> allocated; //Handed out, waiting to be marked alive
+	std::vector<void*> released; //Waiting to actually be released
+};
+
+struct RawMemoryPool::ConcurrentState
+{
+	std::recursive_mutex lock; //Recursive, since release hooks run during flushDeferred can release more objects
+	uint64_t serial; //Unique per thread-safe pool, so stale thread-local lookups can't hit a new pool at the same address
+	std::vector<std::unique_ptr<ThreadCache>> caches;
+	std::vector<bitword_t> reservedBlock; //Slots sitting in thread caches, in same layout as living list
+	size_t numReserved = 0;
+};
+
+//Slots a thread claims from the pool at once. Larger means less locking, but more slack held by idle threads.
+constexpr size_t THREAD_CACHE_BATCH = 64;
+
 void* RawMemoryPool::idToPtr(id_t id) const
 {
-	return ((char*)getObjectDataBlock()) + mObjectSize * id;
+	if (mStorageMode == StorageMode::Paged) return ((char*)mPages[id >> mPageShift]) + mObjectSize * (id & (getObjectsPerPage()-1));
+	else return ((char*)getObjectDataBlock()) + mObjectSize * id;
 }
 
 RawMemoryPool::id_t RawMemoryPool::ptrToId(void* ptr) const
 {
 	assert(contains(ptr));
-	ptrdiff_t offset = ((char*)ptr) - ((char*)getObjectDataBlock());
-	assert((offset % mObjectSize) == 0);
-	return offset / mObjectSize;
+	if (mStorageMode == StorageMode::Paged)
+	{
+		const std::pair<void*, id_t>* page = findPage(ptr);
+		ptrdiff_t offset = ((char*)ptr) - ((char*)page->first);
+		assert((offset % mObjectSize) == 0);
+		return page->second + offset / mObjectSize;
+	}
+	else
+	{
+		ptrdiff_t offset = ((char*)ptr) - ((char*)getObjectDataBlock());
+		assert((offset % mObjectSize) == 0);
+		return offset / mObjectSize;
+	}
+}
+
+const std::pair<void*, RawMemoryPool::id_t>* RawMemoryPool::findPage(void* ptr) const
+{
+	//Find last page starting at or before ptr
+	auto it = std::upper_bound(mPagesByAddress.begin(), mPagesByAddress.end(), ptr,
+		[](void* p, const std::pair<void*, id_t>& page) { return p < page.first; }
+	);
+	if (it == mPagesByAddress.begin()) return nullptr;
+	--it;
+
+	//Make sure it's actually inside
+	return ptr < ((char*)it->first) + (mObjectSize << mPageShift) ? &*it : nullptr;
 }
 
 bool RawMemoryPool::isAliveById(id_t id) const
 {
-	uint8_t* block = getLivingListBlock() + (id / 8);
-	uint8_t bitmask = 1 << (id % 8);
+	bitword_t* block = getLivingListBlock() + (id / BITS_PER_WORD);
+	bitword_t bitmask = bitword_t(1) << (id % BITS_PER_WORD);
 	return *block & bitmask;
 }
 
 void RawMemoryPool::setAlive(id_t id, bool isAlive)
 {
-	uint8_t* chunk = getLivingListBlock() + (id / 8);
-	uint8_t bitmask = 1 << (id % 8);
-	if (isAlive) *chunk |= bitmask;
-	else		 *chunk &= ~bitmask;
+	size_t wordIndex = id / BITS_PER_WORD;
+	bitword_t* chunk = getLivingListBlock() + wordIndex;
+	bitword_t bitmask = bitword_t(1) << (id % BITS_PER_WORD);
+
+	bitword_t* summary = mFullWordsBlock + (wordIndex / BITS_PER_WORD);
+	bitword_t summaryBitmask = bitword_t(1) << (wordIndex % BITS_PER_WORD);
+
+	if (isAlive)
+	{
+		*chunk |= bitmask;
+		if (*chunk == BITWORD_FULL) *summary |= summaryBitmask;
+	}
+	else
+	{
+		*chunk &= ~bitmask;
+		*summary &= ~summaryBitmask;
+		mFreeHint = std::min(mFreeHint, wordIndex / BITS_PER_WORD);
+	}
+}
+
+//Bumped whenever any pool's backing memory moves, so address range indices know to rebuild
+static std::atomic<uint64_t> addressSpaceEpoch = 0;
+
+uint64_t RawMemoryPool::getAddressSpaceEpoch()
+{
+	return addressSpaceEpoch.load(std::memory_order_relaxed);
+}
+
+void RawMemoryPool::getAddressRanges(std::vector<AddressRange>& out) const
+{
+	if (mStorageMode == StorageMode::Paged)
+	{
+		for (void* page : mPages) out.push_back(AddressRange{ page, ((char*)page) + (mObjectSize << mPageShift) });
+	}
+	else if (mStorageMode == StorageMode::Reserved) out.push_back(AddressRange{ mDataBlock, ((char*)mDataBlock) + mReservedBytes });
+	else if (mMaxNumObjects > 0) out.push_back(AddressRange{ mDataBlock, ((char*)mDataBlock) + mObjectSize*mMaxNumObjects });
+}
+
+size_t RawMemoryPool::getStorageBytes() const
+{
+	if (mStorageMode == StorageMode::Paged) return mPages.size() * (mObjectSize << mPageShift);
+	else if (mStorageMode == StorageMode::Reserved) return mCommittedBytes;
+	else return mObjectSize * mMaxNumObjects;
 }
 
 void RawMemoryPool::debugWarnUnreleased() const
@@ -50,53 +141,256 @@ RawMemoryPool::RawMemoryPool() :
 	initHook(nullptr),
 	releaseHook(nullptr),
 	mLivingListBlock(nullptr),
+	mFullWordsBlock(nullptr),
 	mDataBlock(nullptr),
 	mMaxNumObjects(0),
 	mNumAllocatedObjects(0),
-	mObjectSize(0)
+	mPeakNumAllocatedObjects(0),
+	mObjectSize(0),
+	mFreeHint(0),
+	mStorageMode(StorageMode::Contiguous),
+	mPageShift(0),
+	mConcurrent(nullptr),
+	mReservedBytes(0),
+	mCommittedBytes(0),
+	mHugePages(false),
+	mLastCaptureId(0),
+	mPoolId(0)
+{
+}
+
+//Pools by ID, so handles can be resolved without knowing their pool. Chunks are never freed or moved, so lookups don't need to lock.
+constexpr size_t POOL_ID_CHUNK_SIZE = 1024;
+constexpr size_t POOL_ID_MAX_CHUNKS = 1024;
+static std::atomic<std::atomic<RawMemoryPool*>*> poolIdChunks[POOL_ID_MAX_CHUNKS];
+static std::mutex poolIdLock;
+static uint32_t nextPoolId = 1; //0 is the null handle
+
+static std::atomic<RawMemoryPool*>* getPoolIdEntry(uint32_t id)
+{
+	if (id == 0 || id >= POOL_ID_CHUNK_SIZE*POOL_ID_MAX_CHUNKS) return nullptr;
+	std::atomic<RawMemoryPool*>* chunk = poolIdChunks[id / POOL_ID_CHUNK_SIZE].load(std::memory_order_acquire);
+	return chunk ? &chunk[id % POOL_ID_CHUNK_SIZE] : nullptr;
+}
+
+static uint32_t registerPoolId(RawMemoryPool* pool)
+{
+	std::lock_guard<std::mutex> lock(poolIdLock);
+	if (nextPoolId >= POOL_ID_CHUNK_SIZE*POOL_ID_MAX_CHUNKS) return 0; //Out of IDs. Handles to this pool will be null.
+
+	uint32_t id = nextPoolId++;
+	std::atomic<std::atomic<RawMemoryPool*>*>& chunk = poolIdChunks[id / POOL_ID_CHUNK_SIZE];
+	if (!chunk.load(std::memory_order_relaxed)) chunk.store(new std::atomic<RawMemoryPool*>[POOL_ID_CHUNK_SIZE](), std::memory_order_release);
+	chunk.load(std::memory_order_relaxed)[id % POOL_ID_CHUNK_SIZE].store(pool, std::memory_order_release);
+	return id;
+}
+
+RawMemoryPool* RawMemoryPool::getPoolById(uint32_t id)
+{
+	std::atomic<RawMemoryPool*>* entry = getPoolIdEntry(id);
+	return entry ? entry->load(std::memory_order_acquire) : nullptr;
+}
+
+void* RawMemoryPool::resolveAny(const RawHandle& handle)
 {
+	RawMemoryPool* pool = getPoolById(handle.pool);
+	return pool ? pool->resolve(handle) : nullptr;
+}
+
+RawMemoryPool::RawHandle RawMemoryPool::getHandle(void* obj) const
+{
+	assert(contains(obj) && isAlive(obj));
+	ensureHandleTable();
+	RawHandle out;
+	out.pool = mPoolId;
+	out.index = mSlotHandles[ptrToId(obj)];
+	out.generation = mHandles[out.index].generation;
+	return out;
+}
+
+RawMemoryPool::RawHandle RawMemoryPool::tryGetHandle(void* obj) const
+{
+	//Other threads' allocations can grow the handle table and page list, so hold them off
+	std::unique_lock<std::recursive_mutex> guard;
+	if (mConcurrent) guard = std::unique_lock<std::recursive_mutex>(mConcurrent->lock);
+
+	if (!contains(obj)) return RawHandle();
+	id_t id = ptrToId(obj);
+	bool pending = mConcurrent && (mConcurrent->reservedBlock[id / BITS_PER_WORD] & (bitword_t(1) << (id % BITS_PER_WORD)));
+	if (!pending && !isAliveById(id)) return RawHandle();
+	ensureHandleTable();
+
+	//Generation only changes on release, so a pending object's handle starts resolving once it's published
+	RawHandle out;
+	out.pool = mPoolId;
+	out.index = mSlotHandles[id];
+	out.generation = mHandles[out.index].generation;
+	return out;
+}
+
+void* RawMemoryPool::resolve(const RawHandle& handle) const
+{
+	if (handle.pool != mPoolId || handle.index >= mHandles.size()) return nullptr;
+	const HandleEntry& entry = mHandles[handle.index];
+	if (entry.generation != handle.generation || entry.slot >= mMaxNumObjects || !isAliveById(entry.slot)) return nullptr;
+	return idToPtr(entry.slot);
+}
+
+void RawMemoryPool::ensureHandleTable() const
+{
+	if (!mHandles.empty()) return;
+
+	//Another thread may be issuing this pool's first handle too
+	std::unique_lock<std::recursive_mutex> guard;
+	if (mConcurrent) guard = std::unique_lock<std::recursive_mutex>(mConcurrent->lock);
+	if (mHandles.empty()) growHandleTable(mMaxNumObjects);
 }
 
-RawMemoryPool::RawMemoryPool(size_t maxNumObjects, size_t objectSize, size_t objectAlign) : RawMemoryPool()
+void RawMemoryPool::growHandleTable(size_t count) const
 {
+	//Pair new slots with new handles. Never shrinks, see mHandles.
+	for (size_t i = mHandles.size(); i < count; i++)
+	{
+		mHandles.push_back(HandleEntry{ (uint32_t)i, 0 });
+		mSlotHandles.push_back((uint32_t)i);
+	}
+}
+
+void RawMemoryPool::swapHandles(id_t a, id_t b)
+{
+	if (mHandles.empty()) return; //Still identity, and no handles to keep pointing at the object
+	std::swap(mSlotHandles[a], mSlotHandles[b]);
+	mHandles[mSlotHandles[a]].slot = (uint32_t)a;
+	mHandles[mSlotHandles[b]].slot = (uint32_t)b;
+}
+
+//Target page size for paged pools. Pages are never smaller than one living list word's worth of objects.
+constexpr size_t PAGE_TARGET_BYTES = 64 * 1024;
+constexpr size_t PAGE_MIN_SHIFT = 6;
+constexpr size_t PAGE_MAX_SHIFT = 16;
+static_assert((size_t(1) << PAGE_MIN_SHIFT) == BITS_PER_WORD, "Pages must hold a whole number of living list words");
+
+//Address space per reserved pool. Costs nothing until committed.
+constexpr size_t RESERVE_BYTES = sizeof(void*) >= 8 ? (size_t(1) << 32) : (size_t(1) << 26);
+constexpr size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024; //Reservations are aligned to this, so THP can back them
+
+bool RawMemoryPool::reserveAddressSpace()
+{
+	mReservedBytes = RESERVE_BYTES;
+	mCommittedBytes = 0;
+	mDataBlock = vmemReserve(mReservedBytes, HUGE_PAGE_BYTES, true); //Tracked, so snapshots only need to look at what changed
+	mLastCaptureId = 0; //New range, so nothing is known about writes yet
+	if (!mDataBlock) mReservedBytes = 0;
+	return mDataBlock != nullptr;
+}
+
+RawMemoryPool::RawMemoryPool(size_t maxNumObjects, size_t objectSize, size_t objectAlign, StorageMode storageMode) : RawMemoryPool()
+{
+	mPoolId = registerPoolId(this);
+
 	//Set trivial fields
-	mMaxNumObjects = maxNumObjects;
 	mNumAllocatedObjects = 0;
 	mObjectSize = objectSize;
 	mObjectAlign = objectAlign;
+	mStorageMode = storageMode;
+
+	//Fall back if we can't get address space
+	if (mStorageMode == StorageMode::Reserved && !reserveAddressSpace()) mStorageMode = StorageMode::Paged;
 
-	//Allocate memory blocks
-	mDataBlock = ALIGNED_ALLOC(mObjectSize * mMaxNumObjects, mObjectAlign);
+	if (mStorageMode == StorageMode::Reserved)
+	{
+		//Nothing is committed yet
+		mLivingListBlock = (bitword_t*) calloc(1, sizeof(bitword_t));
+		mFullWordsBlock = (bitword_t*) calloc(1, sizeof(bitword_t));
+		setMaxNumObjects(maxNumObjects);
+	}
+	else if (mStorageMode == StorageMode::Paged)
+	{
+		//Pick largest page that fits the target size
+		mPageShift = PAGE_MIN_SHIFT;
+		while (mPageShift < PAGE_MAX_SHIFT && (mObjectSize << (mPageShift+1)) <= PAGE_TARGET_BYTES) mPageShift++;
 
-	size_t livingListSpaceRequired = ceil(mMaxNumObjects / 8.0f);
-	mLivingListBlock = (uint8_t*) malloc(livingListSpaceRequired);
-	memset(getLivingListBlock(), 0x00, livingListSpaceRequired); //Mark all as unused
+		//Pages are allocated lazily by setMaxNumObjects
+		mLivingListBlock = (bitword_t*) calloc(1, sizeof(bitword_t));
+		mFullWordsBlock = (bitword_t*) calloc(1, sizeof(bitword_t));
+		setMaxNumObjects(maxNumObjects);
+	}
+	else
+	{
+		mMaxNumObjects = maxNumObjects;
+
+		//Allocate memory blocks
+		mDataBlock = ALIGNED_ALLOC(mObjectSize * mMaxNumObjects, mObjectAlign);
+
+		size_t nLivingWords = bitwordCount(mMaxNumObjects);
+		mLivingListBlock = (bitword_t*) calloc(nLivingWords, sizeof(bitword_t)); //Mark all as unused
+		mFullWordsBlock = (bitword_t*) calloc(bitwordCount(nLivingWords), sizeof(bitword_t));
+	}
+
+	addressSpaceEpoch++;
 }
 
 RawMemoryPool::~RawMemoryPool()
 {
+	setThreadSafe(false);
+
 	//Call release hook on living objects
 	reset();
 
 	free(mLivingListBlock);
 	mLivingListBlock = nullptr;
+	free(mFullWordsBlock);
+	mFullWordsBlock = nullptr;
 
-	ALIGNED_FREE(mDataBlock);
+	if (mStorageMode == StorageMode::Reserved) vmemRelease(mDataBlock, mReservedBytes);
+	else ALIGNED_FREE(mDataBlock);
 	mDataBlock = nullptr;
+
+	for (void* page : mPages) ALIGNED_FREE(page);
+	mPages.clear();
+	mPagesByAddress.clear();
+
+	//Outstanding handles now resolve to null. ID isn't reused.
+	if (std::atomic<RawMemoryPool*>* entry = getPoolIdEntry(mPoolId)) entry->store(nullptr, std::memory_order_release);
+
+	addressSpaceEpoch++;
 }
 
-RawMemoryPool::RawMemoryPool(RawMemoryPool&& mov) :
-	RawMemoryPool(mov.mMaxNumObjects, mov.mObjectSize, mov.mObjectAlign)
+RawMemoryPool::RawMemoryPool(RawMemoryPool&& mov) : RawMemoryPool()
 {
-	this->mLivingListBlock = mov.mLivingListBlock;
-	this->mDataBlock       = mov.mDataBlock      ;
+	std::swap(debugName          , mov.debugName          );
+	std::swap(initHook           , mov.initHook           );
+	std::swap(releaseHook        , mov.releaseHook        );
+	std::swap(mLivingListBlock   , mov.mLivingListBlock   );
+	std::swap(mFullWordsBlock    , mov.mFullWordsBlock    );
+	std::swap(mDataBlock         , mov.mDataBlock         );
+	std::swap(mMaxNumObjects     , mov.mMaxNumObjects     );
+	std::swap(mNumAllocatedObjects, mov.mNumAllocatedObjects);
+	std::swap(mPeakNumAllocatedObjects, mov.mPeakNumAllocatedObjects);
+	std::swap(mObjectSize        , mov.mObjectSize        );
+	std::swap(mObjectAlign       , mov.mObjectAlign       );
+	std::swap(mFreeHint          , mov.mFreeHint          );
+	std::swap(mStorageMode       , mov.mStorageMode       );
+	std::swap(mPageShift         , mov.mPageShift         );
+	std::swap(mPages             , mov.mPages             );
+	std::swap(mPagesByAddress    , mov.mPagesByAddress    );
+	std::swap(mReservedBytes     , mov.mReservedBytes     );
+	std::swap(mCommittedBytes    , mov.mCommittedBytes    );
+	std::swap(mHugePages         , mov.mHugePages         );
+	std::swap(mLastCaptureId     , mov.mLastCaptureId     );
+	std::swap(mConcurrent        , mov.mConcurrent        );
+	std::swap(mHandles           , mov.mHandles           );
+	std::swap(mSlotHandles       , mov.mSlotHandles       );
+	std::swap(mPoolId            , mov.mPoolId            );
 
-	mov.mLivingListBlock = nullptr;
-	mov.mDataBlock       = nullptr;
+	//Handles follow the storage
+	if (std::atomic<RawMemoryPool*>* entry = getPoolIdEntry(mPoolId)) entry->store(this, std::memory_order_release);
 }
 
 void RawMemoryPool::reset()
 {
+	if (mConcurrent) dropThreadCaches();
+
 	//Call release hook on living objects
 	if (releaseHook && mNumAllocatedObjects > 0)
 	{
@@ -104,17 +398,23 @@ void RawMemoryPool::reset()
 
 		for (size_t i = 0; i < mMaxNumObjects; i++)
 		{
-			void* obj = idToPtr(i);
-			if (isAlive(obj))
+			if (isAliveById(i))
 			{
+				void* obj = idToPtr(i);
 				debugWarnUnreleased(obj);
 				releaseHook(obj);
 			}
 		}
 	}
 	
+	//Invalidate handles
+	if (!mHandles.empty()) for (id_t i = findNextAlive(0, mMaxNumObjects); i < mMaxNumObjects; i = findNextAlive(i+1, mMaxNumObjects)) retireHandle(i);
+
 	//Mark all as unused
-	memset(getLivingListBlock(), 0x00, ceil(mMaxNumObjects / 8.0f));
+	size_t nLivingWords = bitwordCount(mMaxNumObjects);
+	memset(mLivingListBlock, 0x00, nLivingWords * sizeof(bitword_t));
+	memset(mFullWordsBlock, 0x00, bitwordCount(nLivingWords) * sizeof(bitword_t));
+	mFreeHint = 0;
 
 	//reset count of allocated objects
 	mNumAllocatedObjects = 0;
@@ -122,8 +422,66 @@ void RawMemoryPool::reset()
 
 void RawMemoryPool::resizeObjects(size_t newSize, size_t newAlign, MemoryMapper* mapper)
 {
+	if (mConcurrent) dropThreadCaches();
+
 	if (newSize != mObjectSize || newAlign != mObjectAlign)
 	{
+		addressSpaceEpoch++; //All storage is reallocated
+
+		if (mStorageMode == StorageMode::Paged)
+		{
+			//Reallocate page by page. Objects per page stays the same, so IDs don't change.
+			for (void*& page : mPages)
+			{
+				void* newPage = ALIGNED_ALLOC(newSize << mPageShift, newAlign);
+				for (size_t i = 0; i < getObjectsPerPage(); i++)
+				{
+					void* src = ((uint8_t*)  page  ) + (i * mObjectSize);
+					void* dst = ((uint8_t*) newPage) + (i * newSize);
+					mapper->rawMove(dst, src, std::min(mObjectSize, newSize));
+				}
+				ALIGNED_FREE(page);
+				page = newPage;
+			}
+			mObjectSize = newSize;
+			mObjectAlign = newAlign;
+			rebuildPageIndex();
+			return;
+		}
+		else if (mStorageMode == StorageMode::Reserved)
+		{
+			//Stride changes, so objects have to move. Map a fresh range rather than shuffling in place.
+			void* oldBlock = mDataBlock;
+			size_t oldReservedBytes = mReservedBytes;
+			size_t capacity = std::min(mMaxNumObjects, RESERVE_BYTES / newSize);
+			releaseRange(capacity, mMaxNumObjects);
+			if (!reserveAddressSpace()) //Shouldn't happen unless address space is exhausted
+			{
+				cerr << "ERROR: Failed to reserve address space for resized pool (" << debugName << ")\n";
+				mDataBlock = oldBlock;
+				mReservedBytes = oldReservedBytes;
+				return;
+			}
+			if (mHugePages) vmemAdviseHugePages(mDataBlock, mReservedBytes);
+
+			size_t pageSize = vmemPageSize();
+			mCommittedBytes = (capacity*newSize + pageSize-1) / pageSize * pageSize;
+			vmemCommit(mDataBlock, mCommittedBytes);
+
+			for (size_t i = 0; i < capacity; i++)
+			{
+				void* src = ((uint8_t*)  oldBlock  ) + (i * mObjectSize);
+				void* dst = ((uint8_t*) mDataBlock ) + (i * newSize);
+				mapper->rawMove(dst, src, std::min(mObjectSize, newSize));
+			}
+			vmemRelease(oldBlock, oldReservedBytes);
+
+			mObjectSize = newSize;
+			mObjectAlign = newAlign;
+			resizeLivingList(mCommittedBytes / mObjectSize);
+			return;
+		}
+
 		//Allocate new backing block
 		void* newDataBlock = ALIGNED_ALLOC(newSize*mMaxNumObjects, newAlign);
 		
@@ -159,8 +517,66 @@ void RawMemoryPool::resizeObjects(size_t newSize, size_t newAlign, MemoryMapper*
 
 void RawMemoryPool::setMaxNumObjects(size_t newCount, MemoryMapper* mapper)
 {
-	if (newCount != mMaxNumObjects)
+	if (mConcurrent) dropThreadCaches();
+	setMaxNumObjects_internal(newCount, mapper);
+}
+
+void RawMemoryPool::setMaxNumObjects_internal(size_t newCount, MemoryMapper* mapper)
+{
+	if (mStorageMode == StorageMode::Paged)
 	{
+		size_t newNumPages = (newCount + getObjectsPerPage() - 1) >> mPageShift;
+		size_t oldNumPages = mPages.size();
+
+		//Drop empty pages off the end. Never drop a page that holds living objects.
+		size_t wordsPerPage = getObjectsPerPage() / BITS_PER_WORD;
+		while (mPages.size() > newNumPages)
+		{
+			bitword_t* pageWords = mLivingListBlock + (mPages.size()-1) * wordsPerPage;
+			if (std::any_of(pageWords, pageWords+wordsPerPage, [](bitword_t w) { return w != 0; })) break;
+
+			mPagesByAddress.erase(findPage(mPages.back()) - mPagesByAddress.data() + mPagesByAddress.begin());
+			ALIGNED_FREE(mPages.back());
+			mPages.pop_back();
+		}
+
+		//Append new pages
+		while (mPages.size() < newNumPages)
+		{
+			std::pair<void*, id_t> page(ALIGNED_ALLOC(mObjectSize << mPageShift, mObjectAlign), mPages.size() << mPageShift);
+			mPagesByAddress.insert(std::upper_bound(mPagesByAddress.begin(), mPagesByAddress.end(), page), page);
+			mPages.push_back(page.first);
+		}
+
+		if (mPages.size() != oldNumPages) addressSpaceEpoch++;
+
+		resizeLivingList(mPages.size() << mPageShift);
+	}
+	else if (mStorageMode == StorageMode::Reserved)
+	{
+		//Commit whole OS pages. Any leftover room at the end becomes usable capacity.
+		size_t pageSize = vmemPageSize();
+		size_t newCommittedBytes = std::min(newCount*mObjectSize, mReservedBytes);
+		newCommittedBytes = (newCommittedBytes + pageSize-1) / pageSize * pageSize;
+		size_t newCapacity = newCommittedBytes / mObjectSize;
+
+		if (newCapacity < mMaxNumObjects) releaseRange(newCapacity, mMaxNumObjects);
+
+		if (newCommittedBytes > mCommittedBytes)
+		{
+			//Zero-copy: just make more of the range accessible
+			if (!vmemCommit(((char*)mDataBlock) + mCommittedBytes, newCommittedBytes - mCommittedBytes)) return; //Out of memory, keep current capacity
+		}
+		else if (newCommittedBytes < mCommittedBytes) vmemDecommit(((char*)mDataBlock) + newCommittedBytes, mCommittedBytes - newCommittedBytes);
+		mCommittedBytes = newCommittedBytes;
+
+		if (newCapacity != mMaxNumObjects) resizeLivingList(newCapacity);
+	}
+	else if (newCount != mMaxNumObjects)
+	{
+		//Release anything that won't fit
+		if (newCount < mMaxNumObjects) releaseRange(newCount, mMaxNumObjects);
+
 		//Allocate new backing block
 		void* newDataBlock = ALIGNED_ALLOC(mObjectSize*newCount, mObjectAlign);
 		
@@ -168,34 +584,355 @@ void RawMemoryPool::setMaxNumObjects(size_t newCount, MemoryMapper* mapper)
 		
 		ALIGNED_FREE(mDataBlock);
 		mDataBlock = newDataBlock;
+		addressSpaceEpoch++;
+
+		resizeLivingList(newCount);
 	}
 }
 
-void* RawMemoryPool::allocate()
+bool RawMemoryPool::compact(size_t maxMoves, MemoryMapper* mapper)
+{
+	if (mConcurrent) dropThreadCaches();
+
+	//Two fingers: last living object moves into first hole, until they meet
+	id_t src = findLastAlive(mMaxNumObjects);
+	if (src >= mMaxNumObjects) return true; //Empty
+	id_t dst = findNextDead(mFreeHint * BITS_PER_WORD * BITS_PER_WORD, src);
+
+	for (size_t nMoves = 0; dst < src; ++nMoves)
+	{
+		if (nMoves >= maxMoves) return false;
+
+		mapper->rawMove(idToPtr(dst), idToPtr(src), mObjectSize);
+		setAlive(dst, true);
+		setAlive(src, false);
+		swapHandles(dst, src); //Handle moves with the object
+
+		src = findLastAlive(src);
+		dst = findNextDead(dst+1, src);
+	}
+	return true;
+}
+
+float RawMemoryPool::getFragmentation() const
+{
+	id_t last = findLastAlive(mMaxNumObjects);
+	if (last >= mMaxNumObjects) return 0;
+	return 1 - float(mNumAllocatedObjects) / float(last+1);
+}
+
+void RawMemoryPool::captureState(State& out, const std::vector<std::pair<size_t, size_t>>& runs, const State* base)
+{
+	if (mConcurrent) dropThreadCaches();
+
+	size_t nLivingWords = bitwordCount(mMaxNumObjects);
+	static std::atomic<uint64_t> nextCaptureId = 1; //0 means unknown, see mLastCaptureId
+	out.captureId = nextCaptureId++;
+	out.objectSize = mObjectSize;
+	out.runs = runs;
+	out.maxNumObjects = mMaxNumObjects;
+	out.numAllocatedObjects = mNumAllocatedObjects;
+	out.dataBlock = mStorageMode == StorageMode::Contiguous ? mDataBlock : nullptr;
+	out.livingList.assign(mLivingListBlock, mLivingListBlock + nLivingWords);
+	out.handles = mHandles;
+	out.slotHandles = mSlotHandles;
+	out.chunks.clear();
+	out.chunks.reserve(nLivingWords);
+	out.buffers.clear();
+
+	size_t packedSize = 0;
+	for (const std::pair<size_t, size_t>& run : runs) packedSize += run.second;
+	bool wholeObjects = runs.size() == 1 && runs[0].first == 0 && runs[0].second == mObjectSize; //Full words can then be copied in one go
+
+	//Chunks can only be shared if they were packed the same way
+	if (base && base->objectSize != mObjectSize) base = nullptr;
+
+	//Pages written since our last capture. Always collected, so tracking restarts from this capture.
+	//If base is that capture, anything on untouched pages is exactly what base holds.
+	std::vector<uint64_t> writtenPages;
+	bool tracked = mStorageMode == StorageMode::Reserved && mCommittedBytes && vmemCollectWrites(mDataBlock, mCommittedBytes, writtenPages);
+	bool trustWrites = tracked && base && mLastCaptureId != 0 && base->captureId == mLastCaptureId && base->runs == runs;
+	mLastCaptureId = tracked ? out.captureId : 0;
+	size_t pageSize = vmemPageSize();
+	auto wordWritten = [&](size_t word)
+	{
+		size_t firstPage = (word*BITS_PER_WORD*mObjectSize) / pageSize;
+		size_t lastPage = std::min(((word+1)*BITS_PER_WORD*mObjectSize - 1) / pageSize, writtenPages.size()*64 - 1);
+		for (size_t page = firstPage; page <= lastPage; ++page) if (writtenPages[page / 64] & (uint64_t(1) << (page % 64))) return true;
+		return false;
+	};
+
+	//Allocate for worst case, so we never regrow. Left uninitialized, so pages that deltas don't use are never touched.
+	size_t ownCapacity = mNumAllocatedObjects * packedSize;
+	std::shared_ptr<State::Buffer> own = std::make_shared<State::Buffer>();
+	own->bytes.reset(new char[ownCapacity]);
+	out.buffers.push_back(own);
+
+	//Where each of base's buffers ended up in ours, added on first use
+	std::vector<uint32_t> sharedBufferIndices(base ? base->buffers.size() : 0, UINT32_MAX);
+	auto shareBuffer = [&](uint32_t baseBuffer)
+	{
+		uint32_t& index = sharedBufferIndices[baseBuffer];
+		if (index == UINT32_MAX)
+		{
+			index = uint32_t(out.buffers.size());
+			out.buffers.push_back(base->buffers[baseBuffer]);
+		}
+		return index;
+	};
+
+	for (size_t word = 0; word < nLivingWords; ++word)
+	{
+		bitword_t living = mLivingListBlock[word];
+		State::Chunk chunk = { 0, own->size, 0 };
+		if (!living)
+		{
+			out.chunks.push_back(chunk);
+			continue;
+		}
+
+		//Untouched since base: share its chunk without reading ours
+		if (trustWrites && word < base->livingList.size() && base->livingList[word] == living && !wordWritten(word))
+		{
+			const State::Chunk& baseChunk = base->chunks[word];
+			out.chunks.push_back(State::Chunk{ shareBuffer(baseChunk.buffer), baseChunk.offset, baseChunk.size });
+			continue;
+		}
+
+		//Pack living objects. Words never straddle pages, so objects in a word are contiguous.
+		chunk.size = bitCountSet(living) * packedSize;
+		own->size += chunk.size;
+		assert(own->size <= ownCapacity);
+		char* dst = own->bytes.get() + chunk.offset;
+		const char* wordBase = (const char*) idToPtr(word*BITS_PER_WORD);
+		if (wholeObjects && living == BITWORD_FULL) memcpy(dst, wordBase, chunk.size);
+		else
+		{
+			for (bitword_t bits = living; bits; bits &= bits-1)
+			{
+				const char* obj = wordBase + bitCountTrailingZeros(bits)*mObjectSize;
+				for (const std::pair<size_t, size_t>& run : runs)
+				{
+					memcpy(dst, obj + run.first, run.second);
+					dst += run.second;
+				}
+			}
+		}
+
+		//If base already has these exact bytes, share them instead. Our copy was only scratch, so it stays in cache.
+		if (base && word < base->livingList.size() && base->livingList[word] == living)
+		{
+			const State::Chunk& baseChunk = base->chunks[word];
+			if (baseChunk.size == chunk.size && memcmp(base->getChunkBytes(baseChunk), own->bytes.get() + chunk.offset, chunk.size) == 0)
+			{
+				own->size = chunk.offset;
+				chunk.buffer = shareBuffer(baseChunk.buffer);
+				chunk.offset = baseChunk.offset;
+			}
+		}
+
+		out.chunks.push_back(chunk);
+	}
+
+	//Deltas usually use only a sliver of the worst case
+	if (own->size < ownCapacity/2)
+	{
+		char* shrunk = new char[own->size];
+		memcpy(shrunk, own->bytes.get(), own->size);
+		own->bytes.reset(shrunk);
+	}
+}
+
+void RawMemoryPool::restoreState(const State& state, const std::vector<std::pair<size_t, size_t>>& runs)
+{
+	if (mConcurrent) dropThreadCaches();
+	assert(state.objectSize == mObjectSize);
+
+	if (state.maxNumObjects > mMaxNumObjects) setMaxNumObjects_internal(state.maxNumObjects, nullptr);
+	if (state.dataBlock && state.dataBlock != mDataBlock) cerr << "WARNING: pool (" << debugName << ") moved since state was captured. Pointers into it will be stale.\n";
+
+	//Handles, while current liveness is still known. Generations only ever go up, so an entry still on its captured generation
+	//has never been released since. Unless its object was created since and is being dropped, its handles stay valid.
+	//Any other entry moves past both the captured and current generation, so handles issued in between can never match again,
+	//even once the slot is reused. Entries added since capture go back to being paired with their own slot.
+	//If no handle had been issued at capture, the table was implicitly identity with every generation 0.
+	if (!mHandles.empty() || !state.handles.empty()) growHandleTable(std::max(state.handles.size(), mMaxNumObjects));
+	size_t nCapturedHandles = state.handles.empty() ? std::min(mHandles.size(), state.maxNumObjects) : state.handles.size();
+	auto aliveInState = [&](uint32_t slot) { return slot < state.livingList.size()*BITS_PER_WORD && (state.livingList[slot / BITS_PER_WORD] & (bitword_t(1) << (slot % BITS_PER_WORD))); };
+	for (size_t i = 0; i < nCapturedHandles; ++i)
+	{
+		HandleEntry captured = state.handles.empty() ? HandleEntry{ (uint32_t)i, 0 } : state.handles[i];
+		mSlotHandles[i] = state.handles.empty() ? (uint32_t)i : state.slotHandles[i];
+		uint32_t current = mHandles[i].generation;
+		bool aliveNow = mHandles[i].slot < mMaxNumObjects && isAliveById(mHandles[i].slot);
+		bool untouched = current == captured.generation && (!aliveNow || aliveInState(captured.slot));
+		mHandles[i].slot = captured.slot;
+		mHandles[i].generation = untouched ? current : std::max(current, captured.generation) + 1;
+	}
+	for (size_t i = nCapturedHandles; i < mHandles.size(); ++i)
+	{
+		mHandles[i].slot = (uint32_t)i;
+		mHandles[i].generation++;
+		mSlotHandles[i] = (uint32_t)i;
+	}
+
+	//Liveness. Anything past the captured range was created since, so it's dropped.
+	size_t nLivingWords = bitwordCount(mMaxNumObjects);
+	size_t nStateWords = state.livingList.size();
+	memcpy(mLivingListBlock, state.livingList.data(), nStateWords * sizeof(bitword_t));
+	memset(mLivingListBlock + nStateWords, 0x00, (nLivingWords-nStateWords) * sizeof(bitword_t));
+	memset(mFullWordsBlock, 0x00, bitwordCount(nLivingWords) * sizeof(bitword_t));
+	for (size_t word = 0; word < nLivingWords; ++word)
+	{
+		if (mLivingListBlock[word] == BITWORD_FULL) mFullWordsBlock[word / BITS_PER_WORD] |= bitword_t(1) << (word % BITS_PER_WORD);
+	}
+	mFreeHint = 0;
+	mNumAllocatedObjects = state.numAllocatedObjects;
+
+
+	//Objects
+	bool wholeObjects = runs.size() == 1 && runs[0].first == 0 && runs[0].second == mObjectSize;
+	for (size_t word = 0; word < nStateWords; ++word)
+	{
+		bitword_t living = state.livingList[word];
+		if (!living) continue;
+
+		const State::Chunk& chunk = state.chunks[word];
+		const char* src = state.getChunkBytes(chunk);
+		char* wordBase = (char*) idToPtr(word*BITS_PER_WORD);
+		if (wholeObjects && living == BITWORD_FULL) memcpy(wordBase, src, chunk.size);
+		else
+		{
+			for (bitword_t bits = living; bits; bits &= bits-1)
+			{
+				char* obj = wordBase + bitCountTrailingZeros(bits)*mObjectSize;
+				for (const std::pair<size_t, size_t>& run : runs)
+				{
+					memcpy(obj + run.first, src, run.second);
+					src += run.second;
+				}
+			}
+		}
+	}
+}
+
+void RawMemoryPool::resizeLivingList(size_t newMaxNumObjects)
+{
+	size_t oldNumWords = bitwordCount(mMaxNumObjects);
+	size_t newNumWords = bitwordCount(newMaxNumObjects);
+
+	//Resize living list. Anything past the end is already released, so new bits start free.
+	mLivingListBlock = (bitword_t*) realloc(mLivingListBlock, std::max(newNumWords, size_t(1)) * sizeof(bitword_t));
+	if (newNumWords > oldNumWords) memset(mLivingListBlock + oldNumWords, 0x00, (newNumWords-oldNumWords) * sizeof(bitword_t));
+
+	//Resize summary. Existing bits stay valid: words past the end were released, so they're already marked not-full,
+	//and a trailing partial word never reads as full since its tail bits are always free. Free hint stays valid too.
+	size_t oldNumSummaryWords = bitwordCount(oldNumWords);
+	size_t newNumSummaryWords = bitwordCount(newNumWords);
+	mFullWordsBlock = (bitword_t*) realloc(mFullWordsBlock, std::max(newNumSummaryWords, size_t(1)) * sizeof(bitword_t));
+	if (newNumSummaryWords > oldNumSummaryWords) memset(mFullWordsBlock + oldNumSummaryWords, 0x00, (newNumSummaryWords-oldNumSummaryWords) * sizeof(bitword_t));
+
+	//Slots past the end can't be sitting in a thread cache, since caches are dropped before shrinking
+	if (mConcurrent) mConcurrent->reservedBlock.resize(newNumWords, 0);
+
+	if (!mHandles.empty()) growHandleTable(newMaxNumObjects);
+
+	mMaxNumObjects = newMaxNumObjects;
+}
+
+void RawMemoryPool::releaseRange(id_t begin, id_t end)
 {
-	if (mNumAllocatedObjects < mMaxNumObjects)
+	for (id_t i = begin; i < end; i++)
 	{
-		mNumAllocatedObjects++;
+		if (isAliveById(i))
+		{
+			if (releaseHook) releaseHook(idToPtr(i));
+			setAlive(i, false);
+			retireHandle(i);
+			mNumAllocatedObjects--;
+		}
+	}
+}
 
-		//Scan for first free address
-		int id = 0;
-		void* ptr;
-		for (ptr = idToPtr(id); contains(ptr); ptr = idToPtr(++id))
+void RawMemoryPool::rebuildPageIndex()
+{
+	mPagesByAddress.clear();
+	mPagesByAddress.reserve(mPages.size());
+	for (size_t i = 0; i < mPages.size(); i++) mPagesByAddress.emplace_back(mPages[i], i << mPageShift);
+	std::sort(mPagesByAddress.begin(), mPagesByAddress.end());
+}
+
+void* RawMemoryPool::allocate()
+{
+	void* ptr;
+	return allocate(1, &ptr) ? ptr : nullptr;
+}
+
+size_t RawMemoryPool::allocate(size_t count, void** out)
+{
+	if (mConcurrent)
+	{
+		//Hand out from this thread's cache, only going to the pool when it runs dry
+		ThreadCache* cache = getThreadCache();
+		size_t nAllocated = 0;
+		while (nAllocated < count)
 		{
-			if (!isAlive(ptr)) break;
+			if (cache->freeSlots.empty())
+			{
+				refillThreadCache(cache, count-nAllocated);
+				if (cache->freeSlots.empty()) break; //Out of memory
+			}
+			out[nAllocated++] = cache->freeSlots.back();
+			cache->freeSlots.pop_back();
 		}
+		cache->allocated.insert(cache->allocated.end(), out, out+nAllocated);
 
-		setAlive(id, true);
-		if (initHook) initHook(ptr);
-		return ptr;
+		if (initHook) for (size_t i = 0; i < nAllocated; ++i) initHook(out[i]);
+		return nAllocated;
 	}
-	else
+
+	//Paged and Reserved pools grow instead of running out. Existing objects don't move.
+	if (getNumFreeObjects() < count)
+	{
+		if      (mStorageMode == StorageMode::Paged   ) setMaxNumObjects_internal(mNumAllocatedObjects + count, nullptr);
+		else if (mStorageMode == StorageMode::Reserved) setMaxNumObjects_internal(std::max(mNumAllocatedObjects + count, mMaxNumObjects*2), nullptr); //Geometric, so syscalls stay rare
+	}
+
+	size_t nAllocated = 0;
+	while (nAllocated < count && mNumAllocatedObjects < mMaxNumObjects)
 	{
-		return nullptr;
+		//Find first word with a free slot, skipping full words 64 at a time.
+		//Since we aren't at capacity, there must be one somewhere past the hint.
+		while (mFullWordsBlock[mFreeHint] == BITWORD_FULL) mFreeHint++;
+		size_t wordIndex = mFreeHint*BITS_PER_WORD + bitCountTrailingZeros(~mFullWordsBlock[mFreeHint]);
+		bitword_t& word = mLivingListBlock[wordIndex];
+
+		//Claim as many slots from this word as we need. Lowest free bit is always in range, even in the last word.
+		bitword_t freeBits = ~word;
+		while (freeBits && nAllocated < count && mNumAllocatedObjects < mMaxNumObjects)
+		{
+			size_t bit = bitCountTrailingZeros(freeBits);
+			freeBits &= freeBits-1; //Clear lowest bit
+			word |= bitword_t(1) << bit;
+			mNumAllocatedObjects++;
+			out[nAllocated++] = idToPtr(wordIndex*BITS_PER_WORD + bit);
+		}
+
+		if (word == BITWORD_FULL) mFullWordsBlock[wordIndex / BITS_PER_WORD] |= bitword_t(1) << (wordIndex % BITS_PER_WORD);
 	}
+	mPeakNumAllocatedObjects = std::max(mPeakNumAllocatedObjects, mNumAllocatedObjects);
+
+	if (initHook) for (size_t i = 0; i < nAllocated; ++i) initHook(out[i]);
+	return nAllocated;
 }
 
 void RawMemoryPool::release(void* ptr)
+{
+	if (mConcurrent) getThreadCache()->released.push_back(ptr); //Checked and released at next flushDeferred
+	else releaseImmediate(ptr);
+}
+
+void RawMemoryPool::releaseImmediate(void* ptr)
 {
 	//make sure that the address passed in is actually one managed by this pool
 	if (!contains(ptr))
@@ -213,13 +950,184 @@ void RawMemoryPool::release(void* ptr)
 
 	//Main business logic
 	if (releaseHook) releaseHook(ptr);
-	setAlive(ptrToId(ptr), false);
+	id_t id = ptrToId(ptr);
+	setAlive(id, false);
+	retireHandle(id);
 	mNumAllocatedObjects--;
 }
 
+void RawMemoryPool::setThreadSafe(bool threadSafe)
+{
+	if (threadSafe == isThreadSafe()) return;
+
+	if (threadSafe)
+	{
+		static std::atomic<uint64_t> nextSerial = 1;
+		mConcurrent = new ConcurrentState();
+		mConcurrent->serial = nextSerial++;
+		mConcurrent->reservedBlock.resize(bitwordCount(mMaxNumObjects), 0);
+	}
+	else
+	{
+		dropThreadCaches();
+		delete mConcurrent;
+		mConcurrent = nullptr;
+	}
+}
+
+RawMemoryPool::ThreadCache* RawMemoryPool::getThreadCache()
+{
+	//Caches this thread used recently, direct-mapped by pool serial. Hits never lock.
+	struct RecentCache
+	{
+		uint64_t serial;
+		ThreadCache* cache;
+	};
+	constexpr size_t nRecent = 16;
+	static thread_local RecentCache recent[nRecent] = {};
+
+	uint64_t serial = mConcurrent->serial;
+	RecentCache& slot = recent[serial % nRecent];
+	if (slot.serial == serial) return slot.cache;
+
+	//Miss: find or create under lock
+	std::lock_guard<std::recursive_mutex> guard(mConcurrent->lock);
+	std::thread::id self = std::this_thread::get_id();
+	auto it = std::find_if(mConcurrent->caches.begin(), mConcurrent->caches.end(), [&](const std::unique_ptr<ThreadCache>& c) { return c->owner == self; });
+	if (it == mConcurrent->caches.end())
+	{
+		mConcurrent->caches.emplace_back(new ThreadCache());
+		mConcurrent->caches.back()->owner = self;
+		it = mConcurrent->caches.end()-1;
+	}
+	slot = RecentCache{ serial, it->get() };
+	return slot.cache;
+}
+
+void RawMemoryPool::refillThreadCache(ThreadCache* cache, size_t count)
+{
+	std::lock_guard<std::recursive_mutex> guard(mConcurrent->lock);
+	std::vector<bitword_t>& reserved = mConcurrent->reservedBlock;
+	size_t batch = std::max(count, THREAD_CACHE_BATCH);
+
+	//Grow if needed. Paged and Reserved never move objects, so other threads' pointers stay valid.
+	size_t nFree = mMaxNumObjects - mNumAllocatedObjects - mConcurrent->numReserved;
+	if (nFree < batch)
+	{
+		size_t wanted = mMaxNumObjects + (batch - nFree);
+		if      (mStorageMode == StorageMode::Paged   ) setMaxNumObjects_internal(wanted, nullptr);
+		else if (mStorageMode == StorageMode::Reserved) setMaxNumObjects_internal(std::max(wanted, mMaxNumObjects*2), nullptr);
+	}
+
+	//Claim free slots, skipping words that are full or already claimed
+	size_t nWords = bitwordCount(mMaxNumObjects);
+	size_t nClaimed = 0;
+	size_t firstNew = cache->freeSlots.size();
+	for (size_t summaryIndex = mFreeHint; nClaimed < batch && summaryIndex < bitwordCount(nWords); ++summaryIndex)
+	{
+		bitword_t notFull = ~mFullWordsBlock[summaryIndex];
+		while (notFull && nClaimed < batch)
+		{
+			size_t wordIndex = summaryIndex*BITS_PER_WORD + bitCountTrailingZeros(notFull);
+			notFull &= notFull-1;
+			if (wordIndex >= nWords) break;
+
+			bitword_t freeBits = ~(mLivingListBlock[wordIndex] | reserved[wordIndex]);
+			size_t wordEnd = (wordIndex+1)*BITS_PER_WORD;
+			if (wordEnd > mMaxNumObjects) freeBits &= BITWORD_FULL >> (wordEnd - mMaxNumObjects); //Last word can run past capacity
+			while (freeBits && nClaimed < batch)
+			{
+				size_t bit = bitCountTrailingZeros(freeBits);
+				freeBits &= freeBits-1;
+				reserved[wordIndex] |= bitword_t(1) << bit;
+				cache->freeSlots.push_back(idToPtr(wordIndex*BITS_PER_WORD + bit));
+				nClaimed++;
+			}
+
+			//Claimed counts as full, so we don't look here again
+			if ((mLivingListBlock[wordIndex] | reserved[wordIndex]) == BITWORD_FULL) mFullWordsBlock[summaryIndex] |= bitword_t(1) << (wordIndex % BITS_PER_WORD);
+		}
+	}
+	mConcurrent->numReserved += nClaimed;
+
+	//Pops come from the back, so reverse to hand out lowest first
+	std::reverse(cache->freeSlots.begin()+firstNew, cache->freeSlots.end());
+}
+
+bool RawMemoryPool::flushDeferred()
+{
+	if (!mConcurrent) return false;
+	std::lock_guard<std::recursive_mutex> guard(mConcurrent->lock);
+	bool didWork = false;
+
+	//Publish new objects
+	for (std::unique_ptr<ThreadCache>& cache : mConcurrent->caches)
+	{
+		for (void* obj : cache->allocated)
+		{
+			id_t id = ptrToId(obj);
+			mConcurrent->reservedBlock[id / BITS_PER_WORD] &= ~(bitword_t(1) << (id % BITS_PER_WORD));
+			setAlive(id, true);
+		}
+		mConcurrent->numReserved -= cache->allocated.size();
+		mNumAllocatedObjects     += cache->allocated.size();
+		didWork |= !cache->allocated.empty();
+		cache->allocated.clear();
+	}
+	mPeakNumAllocatedObjects = std::max(mPeakNumAllocatedObjects, mNumAllocatedObjects);
+
+	//Release old ones. Hooks might release more, so keep going until nothing is left.
+	std::vector<void*> toRelease;
+	bool anyReleased = true;
+	while (anyReleased)
+	{
+		anyReleased = false;
+		for (std::unique_ptr<ThreadCache>& cache : mConcurrent->caches)
+		{
+			toRelease.clear();
+			std::swap(toRelease, cache->released);
+			for (void* obj : toRelease) releaseImmediate(obj);
+			anyReleased |= !toRelease.empty();
+		}
+		didWork |= anyReleased;
+	}
+
+	return didWork;
+}
+
+void RawMemoryPool::dropThreadCaches()
+{
+	std::lock_guard<std::recursive_mutex> guard(mConcurrent->lock);
+	flushDeferred();
+
+	//Return unclaimed slots
+	for (std::unique_ptr<ThreadCache>& cache : mConcurrent->caches)
+	{
+		for (void* obj : cache->freeSlots)
+		{
+			id_t id = ptrToId(obj);
+			size_t wordIndex = id / BITS_PER_WORD;
+			mConcurrent->reservedBlock[wordIndex] &= ~(bitword_t(1) << (id % BITS_PER_WORD));
+			mFullWordsBlock[wordIndex / BITS_PER_WORD] &= ~(bitword_t(1) << (wordIndex % BITS_PER_WORD));
+			mFreeHint = std::min(mFreeHint, wordIndex / BITS_PER_WORD);
+		}
+		mConcurrent->numReserved -= cache->freeSlots.size();
+		cache->freeSlots.clear();
+	}
+	assert(mConcurrent->numReserved == 0);
+}
+
+bool RawMemoryPool::requestHugePages()
+{
+	if (mStorageMode != StorageMode::Reserved) return false;
+	mHugePages = vmemAdviseHugePages(mDataBlock, mReservedBytes);
+	return mHugePages;
+}
+
 bool RawMemoryPool::contains(void* ptr) const
 {
-	return idToPtr(0) <= ptr && ptr < idToPtr(mMaxNumObjects);
+	if (mStorageMode == StorageMode::Paged) return findPage(ptr) != nullptr;
+	else return idToPtr(0) <= ptr && ptr < idToPtr(mMaxNumObjects);
 }
 
 RawMemoryPool::const_iterator::const_iterator(RawMemoryPool const* pool, id_t index) :
@@ -235,21 +1143,88 @@ void* RawMemoryPool::const_iterator::operator*() const
 
 RawMemoryPool::const_iterator RawMemoryPool::const_iterator::operator++()
 {
-	//Advance one
-	index++;
-
-	//Skip any IDs that aren't alive
-	while (index < pool->mMaxNumObjects && !pool->isAliveById(index)) index++;
-
+	//Advance to next living ID, skipping dead words whole
+	index = pool->findNextAlive(index+1, pool->mMaxNumObjects);
 	return *this;
 }
 
 RawMemoryPool::const_iterator RawMemoryPool::cbegin() const
 {
-	return const_iterator(this, 0);
+	return const_iterator(this, findNextAlive(0, mMaxNumObjects));
 }
 
 RawMemoryPool::const_iterator RawMemoryPool::cend() const
 {
 	return const_iterator(this, mMaxNumObjects);
-}
\ No newline at end of file
+}
+RawMemoryPool::id_t RawMemoryPool::findNextAlive(id_t from, id_t limit) const
+{
+	if (from >= limit) return limit;
+
+	//Mask off bits before start, then skip empty words. Bits past the end are always 0, so we can't overshoot.
+	size_t wordIndex = from / BITS_PER_WORD;
+	bitword_t word = mLivingListBlock[wordIndex] & (BITWORD_FULL << (from % BITS_PER_WORD));
+	while (!word)
+	{
+		if (++wordIndex*BITS_PER_WORD >= limit) return limit;
+		word = mLivingListBlock[wordIndex];
+	}
+	return std::min(wordIndex*BITS_PER_WORD + bitCountTrailingZeros(word), limit);
+}
+
+RawMemoryPool::id_t RawMemoryPool::findNextDead(id_t from, id_t limit) const
+{
+	if (from >= limit) return limit;
+
+	//Same as above, but skipping full words
+	size_t wordIndex = from / BITS_PER_WORD;
+	bitword_t word = ~mLivingListBlock[wordIndex] & (BITWORD_FULL << (from % BITS_PER_WORD));
+	while (!word)
+	{
+		if (++wordIndex*BITS_PER_WORD >= limit) return limit;
+		word = ~mLivingListBlock[wordIndex];
+	}
+	return std::min(wordIndex*BITS_PER_WORD + bitCountTrailingZeros(word), limit);
+}
+
+RawMemoryPool::id_t RawMemoryPool::findLastAlive(id_t limit) const
+{
+	limit = std::min(limit, mMaxNumObjects);
+	if (limit == 0) return limit;
+
+	//Mask off bits at or after limit, then skip empty words going backwards
+	size_t wordIndex = (limit-1) / BITS_PER_WORD;
+	size_t nValidBits = limit - wordIndex*BITS_PER_WORD;
+	bitword_t word = mLivingListBlock[wordIndex] & (BITWORD_FULL >> (BITS_PER_WORD - nValidBits));
+	while (!word)
+	{
+		if (wordIndex == 0) return limit;
+		word = mLivingListBlock[--wordIndex];
+	}
+	return wordIndex*BITS_PER_WORD + bitIndexOfHighest(word);
+}
+
+bool RawMemoryPool::nextLiveSpan(size_t& cursor, LiveSpan& out) const
+{
+	return nextLiveSpan(cursor, out, mMaxNumObjects);
+}
+
+bool RawMemoryPool::nextLiveSpan(size_t& cursor, LiveSpan& out, size_t limit) const
+{
+	limit = std::min(limit, mMaxNumObjects);
+	id_t first = findNextAlive(cursor, limit);
+	if (first >= limit)
+	{
+		cursor = limit;
+		return false;
+	}
+
+	//Paged spans can't cross into the next page, since it isn't adjacent in memory
+	if (mStorageMode == StorageMode::Paged) limit = std::min(limit, (first | (getObjectsPerPage()-1)) + 1);
+
+	id_t end = findNextDead(first+1, limit);
+	out.first = idToPtr(first);
+	out.count = end - first;
+	cursor = end;
+	return true;
+}
@@ -0,0 +1,134 @@
+#include "SizeClassAllocator.hpp"
+
+#include <cstdio>
+#include <atomic>
+
+static std::atomic<uint64_t> nextSerial = 1; //0 never matches, so empty cache slots miss
+
+SizeClassAllocator::SizeClass::SizeClass(size_t size, size_t align) :
+	RawMemoryPool(0, size, align, StorageMode::Reserved) //Commits as it fills, so sparse classes stay cheap
+{
+}
+
+SizeClassAllocator::SizeClassAllocator() :
+	serial(nextSerial++)
+{
+}
+
+SizeClassAllocator::~SizeClassAllocator()
+{
+	for (TypeEntry& t : types)
+	{
+		if (t.dtor) for (void* obj : t.objects) t.dtor(obj);
+		t.objects.clear();
+	}
+	for (SizeClass* c : classes) delete c;
+	classes.clear();
+}
+
+SizeClassAllocator::SizeClass* SizeClassAllocator::getOrCreateClass(size_t size, size_t align)
+{
+	//Round up so similar types land together
+	size_t classAlign = std::max(align, SIZE_CLASS_GRANULARITY);
+	size_t classSize = (std::max(size, size_t(1)) + classAlign-1) / classAlign * classAlign;
+
+	for (SizeClass* c : classes) if (c->getMaxObjectSize() == classSize && c->getObjectAlign() == classAlign) return c;
+
+	SizeClass* c = new SizeClass(classSize, classAlign);
+	classes.push_back(c);
+	return c;
+}
+
+void* SizeClassAllocator::allocate(const TypeName& type, size_t size, size_t align, dtor_t dtor)
+{
+	if (size > MAX_SHARED_SIZE || align > MAX_SHARED_ALIGN)
+	{
+		printf("ERROR: %s is too large or overaligned for size classes\n", type.c_str());
+		return nullptr;
+	}
+
+	//Find or register type
+	uint16_t typeIndex;
+	auto it = typesByName.find(type);
+	if (it != typesByName.end()) typeIndex = it->second;
+	else
+	{
+		assert(types.size() < UINT16_MAX);
+		typeIndex = (uint16_t)types.size();
+		types.push_back(TypeEntry{ type, getOrCreateClass(size, align), dtor, {} });
+		typesByName.emplace(type, typeIndex);
+	}
+	TypeEntry& t = types[typeIndex];
+	assert(t.sizeClass->getMaxObjectSize() >= size);
+
+	//Claim slot, and tag it
+	void* obj = t.sizeClass->allocate();
+	if (!obj) return nullptr;
+	if (t.sizeClass->slots.size() < t.sizeClass->getMaxNumObjects()) t.sizeClass->slots.resize(t.sizeClass->getMaxNumObjects());
+	SizeClass::SlotInfo& slot = t.sizeClass->getSlot(obj);
+	slot.type = typeIndex;
+	slot.listIndex = (uint32_t)t.objects.size();
+	t.objects.push_back(obj);
+	return obj;
+}
+
+void SizeClassAllocator::release(void* obj)
+{
+	SizeClass* c = findClass(obj);
+	if (!c || !c->isAlive(obj))
+	{
+		printf("ERROR: object %p freed from size classes, but isn't alive in any\n", obj);
+		return;
+	}
+
+	//Swap-remove from type's list
+	SizeClass::SlotInfo& slot = c->getSlot(obj);
+	std::vector<void*>& objects = types[slot.type].objects;
+	void* last = objects.back();
+	objects[slot.listIndex] = last;
+	c->getSlot(last).listIndex = slot.listIndex;
+	objects.pop_back();
+
+	c->release(obj);
+}
+
+void SizeClassAllocator::destroy(void* obj)
+{
+	SizeClass* c = findClass(obj);
+	if (c && c->isAlive(obj))
+	{
+		if (dtor_t dtor = types[c->getSlot(obj).type].dtor) dtor(obj);
+	}
+	release(obj);
+}
+
+SizeClassAllocator::SizeClass* SizeClassAllocator::findClass(void* obj) const
+{
+	for (SizeClass* c : classes) if (c->contains(obj)) return c;
+	return nullptr;
+}
+
+bool SizeClassAllocator::contains(void* obj) const
+{
+	SizeClass* c = findClass(obj);
+	return c && c->isAlive(obj);
+}
+
+const TypeName* SizeClassAllocator::getTypeOf(void* obj) const
+{
+	SizeClass* c = findClass(obj);
+	return (c && c->isAlive(obj)) ? &types[c->getSlot(obj).type].name : nullptr;
+}
+
+const SizeClassAllocator::TypeEntry* SizeClassAllocator::findType(const TypeName& type) const
+{
+	auto it = typesByName.find(type);
+	return it != typesByName.end() ? &types[it->second] : nullptr;
+}
+
+size_t SizeClassAllocator::getStorageBytes() const
+{
+	size_t out = 0;
+	for (const SizeClass* c : classes) out += c->getStorageBytes();
+	return out;
+}
@@ -0,0 +1,178 @@
+#include "SoAMemoryPool.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+#include "alloc_detail.h"
+
+//Columns start on a cache line, so batch loops can use aligned vector loads
+constexpr size_t COLUMN_ALIGN = 64;
+
+SoAMemoryPool::SoAMemoryPool(const TypeInfo& type, const std::vector<std::string>& hotFields, size_t initialCapacity) :
+	typeName(type.name),
+	objectSize(type.layout.size),
+	hasColdColumn(false),
+	count(0),
+	capacity(0)
+{
+	//Can't split objects that carry vptrs
+	bool hasImplicitValues = false;
+	type.layout.walkImplicitValues([&](size_t, size_t, const char*) { hasImplicitValues = true; });
+	assert(!hasImplicitValues && "SoA types can't be virtual");
+
+	//One column per hot field, with offsets relative to the whole object
+	type.layout.walkFields(
+		[&](const FieldInfo& fi)
+		{
+			ptrdiff_t offset = fi.offset + (ptrdiff_t)type.layout.upcast(nullptr, fi.owner);
+			bool isHot = hotFields.empty() || std::find(hotFields.begin(), hotFields.end(), fi.name) != hotFields.end();
+			if (isHot) columns.push_back(Column{ fi.name, fi.type, offset, fi.size, nullptr });
+			else coldRuns.emplace_back(offset, fi.size);
+		},
+		MemberVisibility::All,
+		true
+	);
+
+	//Everything else is packed into one column. Padding and hot bytes are left out.
+	std::sort(coldRuns.begin(), coldRuns.end());
+	size_t coldSize = 0;
+	for (size_t i = 0; i < coldRuns.size(); i++)
+	{
+		coldSize += coldRuns[i].second;
+		if (i > 0 && coldRuns[i-1].first + (ptrdiff_t)coldRuns[i-1].second == coldRuns[i].first)
+		{
+			coldRuns[i-1].second += coldRuns[i].second;
+			coldRuns.erase(coldRuns.begin() + i--);
+		}
+	}
+	hasColdColumn = !coldRuns.empty();
+	if (hasColdColumn) columns.push_back(Column{ "", typeName, 0, coldSize, nullptr });
+
+	reserve(initialCapacity);
+}
+
+SoAMemoryPool::~SoAMemoryPool()
+{
+	for (Column& c : columns) ALIGNED_FREE(c.data);
+}
+
+void SoAMemoryPool::reserve(size_t newCapacity)
+{
+	if (newCapacity <= capacity) return;
+
+	for (Column& c : columns)
+	{
+		char* newData = (char*) ALIGNED_ALLOC(std::max(c.size * newCapacity, COLUMN_ALIGN), COLUMN_ALIGN);
+		if (c.data) memcpy(newData, c.data, c.size * count);
+		ALIGNED_FREE(c.data);
+		c.data = newData;
+	}
+
+	//Pair new rows with new handles
+	for (size_t i = capacity; i < newCapacity; i++)
+	{
+		handles.push_back(HandleEntry{ (uint32_t)i, 1 });
+		rowHandles.push_back((uint32_t)i);
+	}
+
+	capacity = newCapacity;
+}
+
+SoAMemoryPool::RowHandle SoAMemoryPool::insert(const void* image)
+{
+	if (count == capacity) reserve(std::max(capacity*2, size_t(64)));
+
+	size_t row = count++;
+	scatter(row, image);
+	return getHandle(row);
+}
+
+void SoAMemoryPool::release(RowHandle handle)
+{
+	size_t row = resolve(handle);
+	if (row == npos) return;
+
+	//Fill hole with last row
+	size_t last = --count;
+	if (row != last)
+	{
+		for (Column& c : columns) memcpy(c.data + row*c.size, c.data + last*c.size, c.size);
+		std::swap(rowHandles[row], rowHandles[last]);
+		handles[rowHandles[row]].row = (uint32_t)row;
+		handles[rowHandles[last]].row = (uint32_t)last;
+	}
+
+	handles[handle.index].generation++;
+}
+
+void SoAMemoryPool::clear()
+{
+	for (size_t row = 0; row < count; row++) handles[rowHandles[row]].generation++;
+	count = 0;
+}
+
+size_t SoAMemoryPool::resolve(RowHandle handle) const
+{
+	if (handle.index >= handles.size()) return npos;
+	const HandleEntry& entry = handles[handle.index];
+	if (entry.generation != handle.generation || entry.row >= count) return npos;
+	return entry.row;
+}
+
+SoAMemoryPool::RowHandle SoAMemoryPool::getHandle(size_t row) const
+{
+	assert(row < count);
+	RowHandle out;
+	out.index = rowHandles[row];
+	out.generation = handles[out.index].generation;
+	return out;
+}
+
+void SoAMemoryPool::gather(size_t row, void* imageOut) const
+{
+	assert(row < count);
+	memset(imageOut, 0, objectSize);
+
+	//Cold column is always last
+	size_t nHotColumns = columns.size() - (hasColdColumn?1:0);
+	for (size_t i = 0; i < nHotColumns; i++)
+	{
+		const Column& c = columns[i];
+		memcpy(((char*)imageOut) + c.offset, c.data + row*c.size, c.size);
+	}
+	if (hasColdColumn)
+	{
+		const char* src = columns.back().data + row*columns.back().size;
+		for (const std::pair<ptrdiff_t, size_t>& run : coldRuns)
+		{
+			memcpy(((char*)imageOut) + run.first, src, run.second);
+			src += run.second;
+		}
+	}
+}
+
+void SoAMemoryPool::scatter(size_t row, const void* image)
+{
+	assert(row < count);
+	size_t nHotColumns = columns.size() - (hasColdColumn?1:0);
+	for (size_t i = 0; i < nHotColumns; i++)
+	{
+		Column& c = columns[i];
+		memcpy(c.data + row*c.size, ((const char*)image) + c.offset, c.size);
+	}
+	if (hasColdColumn)
+	{
+		char* dst = columns.back().data + row*columns.back().size;
+		for (const std::pair<ptrdiff_t, size_t>& run : coldRuns)
+		{
+			memcpy(dst, ((const char*)image) + run.first, run.second);
+			dst += run.second;
+		}
+	}
+}
+
+const SoAMemoryPool::Column* SoAMemoryPool::findColumn(const std::string& fieldName) const
+{
+	for (const Column& c : columns) if (!c.name.empty() && c.name == fieldName) return &c;
+	return nullptr;
+}
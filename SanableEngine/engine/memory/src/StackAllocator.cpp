@@ -1,52 +1,110 @@
 #include "StackAllocator.hpp"
 
-#include <cstdlib>
+#include <new>
+#include <cstdint>
+#include <algorithm>
+
+//Size of first block if none was given, and granularity when merging blocks
+constexpr size_t MIN_BLOCK_SIZE = 4096;
 
 StackAllocator::StackAllocator() :
-    maxSize(0),
+    current(0),
     used(0),
-    memory(nullptr)
+    usedBelow(0),
+    highWaterMark(0)
 {
 }
 
-StackAllocator::StackAllocator(size_t bytesToAllocate) : StackAllocator()
+StackAllocator::StackAllocator(size_t initialSize) : StackAllocator()
 {
-    resize(bytesToAllocate);
+    resize(initialSize);
 }
 
 StackAllocator::~StackAllocator()
 {
-    if (memory)
-    {
-        free(memory);
-        memory = nullptr;
-    }
+    releaseBlocks();
+}
+
+void StackAllocator::releaseBlocks()
+{
+    for (Block& b : blocks) ::operator delete(b.memory);
+    blocks.clear();
+    current = 0;
 }
 
 void StackAllocator::resize(size_t newSize)
 {
-    assert(!used); // Only allow resizing if we're empty, otherwise previous allocations will be dangling pointers
-    maxSize = newSize;
-    memory = (char*)realloc(memory, newSize);
+    assert(!getUsed()); // Only allow resizing if we're empty, otherwise previous allocations will be dangling pointers
+    releaseBlocks();
+    if (newSize) blocks.push_back(Block{ (char*)::operator new(newSize), newSize });
 }
 
-void* StackAllocator::allocRaw(size_t size)
+void* StackAllocator::allocRaw(size_t size, size_t align)
 {
-    assert(used + size <= maxSize);
-    void* ptr = memory + used;
-    used += size;
-    return ptr;
+    assert(align && (align & (align-1)) == 0); //Must be power of two
+
+    while (true)
+    {
+        if (current < blocks.size())
+        {
+            //Try to fit in current block, padding from actual address so any alignment works
+            Block& b = blocks[current];
+            uintptr_t base = (uintptr_t)b.memory;
+            size_t offset = ((base + used + align-1) & ~uintptr_t(align-1)) - base;
+            if (offset + size <= b.size)
+            {
+                used = offset + size;
+                highWaterMark = std::max(highWaterMark, getUsed());
+                return b.memory + offset;
+            }
+
+            //Doesn't fit. Move on to next block, if there's a spare.
+            if (current+1 < blocks.size())
+            {
+                usedBelow += b.size;
+                current++;
+                used = 0;
+                continue;
+            }
+        }
+
+        //Chain a new block. Grow geometrically, and always leave room for worst-case padding.
+        size_t newSize = std::max(blocks.empty() ? MIN_BLOCK_SIZE : blocks.back().size*2, size + align);
+        if (!blocks.empty()) usedBelow += blocks[current].size;
+        blocks.push_back(Block{ (char*)::operator new(newSize), newSize });
+        current = blocks.size()-1;
+        used = 0;
+    }
+}
+
+size_t StackAllocator::getCapacity() const
+{
+    size_t out = 0;
+    for (const Block& b : blocks) out += b.size;
+    return out;
 }
 
 StackAllocator::Checkpoint StackAllocator::markCheckpoint()
 {
     Checkpoint c;
+    c.block = this->current;
     c.used = this->used;
     return c;
 }
 
 void StackAllocator::restoreCheckpoint(const Checkpoint& c)
 {
-    assert(used >= c.used);
+    assert(c.block < current || (c.block == current && c.used <= used));
+    for (size_t i = c.block; i < current; ++i) usedBelow -= blocks[i].size;
+    current = c.block;
     used = c.used;
+
+    //Once empty, merge chained blocks into one big enough for the worst we've seen, so steady state never chains
+    if (current == 0 && used == 0 && blocks.size() > 1)
+    {
+        size_t mergedSize = (highWaterMark + MIN_BLOCK_SIZE-1) / MIN_BLOCK_SIZE * MIN_BLOCK_SIZE;
+        releaseBlocks();
+        blocks.push_back(Block{ (char*)::operator new(mergedSize), mergedSize });
+        usedBelow = 0;
+    }
 }
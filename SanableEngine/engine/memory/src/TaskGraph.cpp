@@ -0,0 +1,218 @@
+#include "TaskGraph.hpp"
+
+#include <cassert>
+#include <algorithm>
+#include <thread>
+
+#include "JobSystem.hpp"
+
+TaskGraph::TaskGraph() :
+	nFinished(0)
+{
+}
+
+TaskGraph::~TaskGraph()
+{
+}
+
+TaskGraph::id_t TaskGraph::add(const std::string& name, const std::function<void()>& fn, std::initializer_list<id_t> dependencies)
+{
+	return add(name, fn, std::vector<id_t>(dependencies));
+}
+
+TaskGraph::id_t TaskGraph::add(const std::string& name, const std::function<void()>& fn, const std::vector<id_t>& dependencies)
+{
+	assert(fn);
+	if (find(name) != npos) return npos;
+	for (id_t dep : dependencies) if (dep >= tasks.size() || !tasks[dep].fn) return npos;
+
+	id_t id;
+	if (!freeIds.empty())
+	{
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else
+	{
+		id = tasks.size();
+		tasks.emplace_back();
+	}
+
+	Task& t = tasks[id];
+	t.name = name;
+	t.fn = fn;
+	t.dependencies = dependencies;
+	std::sort(t.dependencies.begin(), t.dependencies.end());
+	t.dependencies.erase(std::unique(t.dependencies.begin(), t.dependencies.end()), t.dependencies.end());
+
+	dirty = true;
+	return id;
+}
+
+bool TaskGraph::dependsOn(id_t task, id_t other) const
+{
+	if (task == other) return true;
+	for (id_t dep : tasks[task].dependencies) if (dependsOn(dep, other)) return true;
+	return false;
+}
+
+bool TaskGraph::addDependency(id_t task, id_t dependency)
+{
+	assert(task < tasks.size() && tasks[task].fn);
+	assert(dependency < tasks.size() && tasks[dependency].fn);
+
+	if (dependsOn(dependency, task)) return false; //Would be a cycle
+
+	std::vector<id_t>& deps = tasks[task].dependencies;
+	if (std::find(deps.begin(), deps.end(), dependency) == deps.end()) deps.push_back(dependency);
+	dirty = true;
+	return true;
+}
+
+void TaskGraph::setCallingThreadOnly(id_t task, bool pinned)
+{
+	assert(task < tasks.size() && tasks[task].fn);
+	tasks[task].callingThreadOnly = pinned;
+}
+
+void TaskGraph::remove(id_t task)
+{
+	assert(task < tasks.size() && tasks[task].fn);
+
+	for (Task& t : tasks)
+	{
+		auto it = std::find(t.dependencies.begin(), t.dependencies.end(), task);
+		if (it != t.dependencies.end()) t.dependencies.erase(it);
+	}
+
+	tasks[task] = Task();
+	freeIds.push_back(task);
+	dirty = true;
+}
+
+void TaskGraph::clear()
+{
+	tasks.clear();
+	freeIds.clear();
+	dirty = true;
+}
+
+TaskGraph::id_t TaskGraph::find(const std::string& name) const
+{
+	for (id_t i = 0; i < tasks.size(); ++i) if (tasks[i].fn && tasks[i].name == name) return i;
+	return npos;
+}
+
+size_t TaskGraph::getTaskCount() const
+{
+	return tasks.size() - freeIds.size();
+}
+
+void TaskGraph::compile()
+{
+	roots.clear();
+	nLive = 0;
+	for (Task& t : tasks) t.dependents.clear();
+
+	for (id_t i = 0; i < tasks.size(); ++i)
+	{
+		if (!tasks[i].fn) continue;
+		nLive++;
+		if (tasks[i].dependencies.empty()) roots.push_back(i);
+		for (id_t dep : tasks[i].dependencies) tasks[dep].dependents.push_back(i);
+	}
+	for (Task& t : tasks) t.readyScratch.resize(t.dependents.size());
+	launches.resize(tasks.size()+1);
+
+	if (remainingDepsSize < tasks.size())
+	{
+		remainingDeps.reset(new std::atomic<size_t>[tasks.size()]);
+		remainingDepsSize = tasks.size();
+	}
+
+	dirty = false;
+}
+
+void TaskGraph::launch(id_t* ready, size_t count, Launch& launchCtx)
+{
+	//Pinned tasks wait for the thread in run() to pick them up. Move the rest to the front.
+	size_t nFree = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (tasks[ready[i]].callingThreadOnly)
+		{
+			std::lock_guard<std::mutex> guard(callingThreadLock);
+			callingThreadQueue.push_back(ready[i]);
+		}
+		else ready[nFree++] = ready[i];
+	}
+
+	//A lone task can carry on right here, unless this is the thread in run(): it has to stay free for pinned tasks.
+	//Otherwise hand them off without waiting, so this thread can go back to whatever is next.
+	if (nFree == 0) return;
+	if (nFree == 1 && std::this_thread::get_id() != callingThread) runTask(ready[0]);
+	else
+	{
+		launchCtx.graph = this;
+		launchCtx.ready = ready;
+		jobs->parallelForAsync(nFree, [](void* ctx, size_t i) { Launch* l = (Launch*)ctx; l->graph->runTask(l->ready[i]); }, &launchCtx);
+	}
+}
+
+void TaskGraph::runTask(id_t id)
+{
+	Task& t = tasks[id];
+	t.fn();
+
+	//Whoever finishes a task's last dependency launches it
+	size_t nReady = 0;
+	for (id_t dep : t.dependents)
+	{
+		if (remainingDeps[dep].fetch_sub(1, std::memory_order_acq_rel) == 1) t.readyScratch[nReady++] = dep;
+	}
+	launch(t.readyScratch.data(), nReady, launches[id]);
+
+	//Counted last, so once run() sees everything finished, nothing is still reading the graph
+	nFinished.fetch_add(1, std::memory_order_release);
+}
+
+void TaskGraph::run(JobSystem* jobs)
+{
+	if (dirty) compile();
+	for (id_t i = 0; i < tasks.size(); ++i) remainingDeps[i].store(tasks[i].dependencies.size(), std::memory_order_relaxed);
+
+	//Serial fallback: Kahn's algorithm, in id order. Everything is on the calling thread anyway.
+	if (!jobs || jobs->getWorkerCount() == 0)
+	{
+		serialOrder.assign(roots.begin(), roots.end());
+		for (size_t i = 0; i < serialOrder.size(); ++i)
+		{
+			const Task& t = tasks[serialOrder[i]];
+			t.fn();
+			for (id_t dep : t.dependents) if (remainingDeps[dep].fetch_sub(1, std::memory_order_relaxed) == 1) serialOrder.push_back(dep);
+		}
+		return;
+	}
+
+	this->jobs = jobs;
+	callingThread = std::this_thread::get_id();
+	nFinished.store(0);
+	serialOrder.assign(roots.begin(), roots.end()); //launch reorders its input
+	launch(serialOrder.data(), serialOrder.size(), launches.back());
+
+	//Run pinned tasks as they become ready, and help with everything else in between, until everything is done
+	while (nFinished.load(std::memory_order_acquire) < nLive)
+	{
+		id_t next = npos;
+		{
+			std::lock_guard<std::mutex> guard(callingThreadLock);
+			if (!callingThreadQueue.empty())
+			{
+				next = callingThreadQueue.back();
+				callingThreadQueue.pop_back();
+			}
+		}
+		if (next != npos) runTask(next);
+		else if (!jobs->tryRunOne()) std::this_thread::yield();
+	}
+}
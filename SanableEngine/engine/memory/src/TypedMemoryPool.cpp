@@ -2,8 +2,8 @@
 
 #include "ObjectPatch.hpp"
 
-GenericTypedMemoryPool::GenericTypedMemoryPool(size_t maxNumObjects, const TypeInfo& contentsType) :
-	RawMemoryPool(maxNumObjects, contentsType.layout.size, contentsType.layout.align),
+GenericTypedMemoryPool::GenericTypedMemoryPool(size_t maxNumObjects, const TypeInfo& contentsType, StorageMode storageMode) :
+	RawMemoryPool(maxNumObjects, contentsType.layout.size, contentsType.layout.align, storageMode),
 	contentsType(contentsType),
 	view(this)
 {
@@ -41,17 +41,9 @@ void GenericTypedMemoryPool::refreshObjects(const TypeInfo& newTypeData, MemoryM
 		//Must be done before writing to members so writes don't happen in other objects' memory
 		if (newTypeData.layout.size > contentsType.layout.size) resizeObjects(newTypeData.layout.size, newTypeData.layout.align, remapper);
 
-		//Remap members and write vtable ptrs
+		//Remap members and write vtable ptrs. Plan is built once, then run on every object.
 		ObjectPatch patch = ObjectPatch::create(contentsType, newTypeData);
-		for (size_t i = 0; i < mMaxNumObjects; i++)
-		{
-			void* obj = idToPtr(i);
-			if (isAlive(obj))
-			{
-				patch.apply(obj, remapper);
-				contentsType.layout.vptrJam(obj);
-			}
-		}
+		foreachLive([&](void* obj) { patch.apply(obj, remapper); });
 		
 		//Resize if we shrunk
 		//Must be done after writing to members so we aren't reading other objects' memory
@@ -59,6 +51,7 @@ void GenericTypedMemoryPool::refreshObjects(const TypeInfo& newTypeData, MemoryM
 	}
 	
 	contentsType = newTypeData;
+	contentsTypeResolved = true;
 
 	//Fix bad dtors
 	releaseHook = newTypeData.capabilities.rawDtor;
@@ -0,0 +1,267 @@
+#include "vmem_detail.h"
+
+#include <cstdint>
+
+#if !VMEM_SUPPORTED
+
+size_t vmemPageSize() { return 4096; }
+void* vmemReserve(size_t bytes, size_t align, bool trackWrites) { return nullptr; }
+void vmemRelease(void* base, size_t bytes) { }
+bool vmemCommit(void* ptr, size_t bytes) { return false; }
+void vmemDecommit(void* ptr, size_t bytes) { }
+bool vmemAdviseHugePages(void* base, size_t bytes) { return false; }
+bool vmemCollectWrites(void* ptr, size_t bytes, std::vector<uint64_t>& out) { return false; }
+
+#elif _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+size_t vmemPageSize()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+}
+
+void* vmemReserve(size_t bytes, size_t align, bool trackWrites)
+{
+	DWORD type = MEM_RESERVE | (trackWrites ? MEM_WRITE_WATCH : 0);
+
+	//Reservations are already aligned to allocation granularity (64KiB). Anything more needs a manual search.
+	void* base = VirtualAlloc(nullptr, bytes, type, PAGE_NOACCESS);
+	if (!base || (uintptr_t(base) & (align-1)) == 0) return base;
+	VirtualFree(base, 0, MEM_RELEASE);
+
+	//Over-reserve to find an aligned address, then try to claim exactly that. Another thread may beat us to it, so retry.
+	for (int attempt = 0; attempt < 8; ++attempt)
+	{
+		void* probe = VirtualAlloc(nullptr, bytes + align, MEM_RESERVE, PAGE_NOACCESS);
+		if (!probe) return nullptr;
+		VirtualFree(probe, 0, MEM_RELEASE);
+		void* aligned = (void*) ((uintptr_t(probe) + align - 1) & ~uintptr_t(align-1));
+		base = VirtualAlloc(aligned, bytes, type, PAGE_NOACCESS);
+		if (base) return base;
+	}
+	return nullptr;
+}
+
+void vmemRelease(void* base, size_t bytes)
+{
+	VirtualFree(base, 0, MEM_RELEASE);
+}
+
+bool vmemCommit(void* ptr, size_t bytes)
+{
+	return VirtualAlloc(ptr, bytes, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+void vmemDecommit(void* ptr, size_t bytes)
+{
+	VirtualFree(ptr, bytes, MEM_DECOMMIT);
+}
+
+bool vmemAdviseHugePages(void* base, size_t bytes)
+{
+	return false; //Large pages need SeLockMemoryPrivilege and must be committed all at once
+}
+
+bool vmemCollectWrites(void* ptr, size_t bytes, std::vector<uint64_t>& out)
+{
+	size_t pageSize = vmemPageSize();
+	size_t nPages = bytes / pageSize;
+	out.assign((nPages+63) / 64, 0);
+
+	//Room for every page, since a partial result would still reset the rest
+	std::vector<PVOID> written(nPages);
+	ULONG_PTR nWritten = nPages;
+	ULONG granularity;
+	if (GetWriteWatch(WRITE_WATCH_FLAG_RESET, ptr, bytes, written.data(), &nWritten, &granularity) != 0) return false;
+
+	for (ULONG_PTR i = 0; i < nWritten; ++i)
+	{
+		size_t page = (uintptr_t(written[i]) - uintptr_t(ptr)) / pageSize;
+		out[page / 64] |= uint64_t(1) << (page % 64);
+	}
+	return true;
+}
+
+#else
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if __linux__
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/userfaultfd.h>
+
+//Async write-protect tracking. Pages in a userfaultfd-registered range are write-protected by each scan, and the kernel just
+//drops the protection on the next write instead of raising a fault for us to handle. Needs Linux 6.7+.
+//Declared here since older headers don't have them. Names differ from the kernel's, so newer headers don't clash.
+namespace
+{
+	constexpr uint64_t TRACK_UFFD_FEATURE_WP_UNPOPULATED = 1 << 13;
+	constexpr uint64_t TRACK_UFFD_FEATURE_WP_ASYNC = 1 << 15;
+	constexpr int TRACK_UFFD_USER_MODE_ONLY = 1;
+
+	constexpr uint64_t SCAN_PAGE_IS_WRITTEN = 1 << 1;
+	constexpr uint64_t SCAN_WP_MATCHING = 1 << 0; //Write-protect what matched, so the next scan starts over
+	constexpr uint64_t SCAN_CHECK_WPASYNC = 1 << 1; //Fail instead of scanning ranges that aren't registered
+
+	struct ScanRegion
+	{
+		uint64_t start;
+		uint64_t end;
+		uint64_t categories;
+	};
+
+	struct ScanArgs
+	{
+		uint64_t size;
+		uint64_t flags;
+		uint64_t start;
+		uint64_t end;
+		uint64_t walk_end;
+		uint64_t vec;
+		uint64_t vec_len;
+		uint64_t max_pages;
+		uint64_t category_inverted;
+		uint64_t category_mask;
+		uint64_t category_anyof_mask;
+		uint64_t return_mask;
+	};
+	constexpr unsigned long SCAN_IOCTL = _IOWR('f', 16, ScanArgs);
+
+	//One of each for the whole process. -1 if unavailable.
+	int getTrackingFd()
+	{
+		static int fd = []()
+		{
+			int fd = (int) syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK | TRACK_UFFD_USER_MODE_ONLY);
+			if (fd < 0) return -1;
+			uffdio_api api = {};
+			api.api = UFFD_API;
+			api.features = TRACK_UFFD_FEATURE_WP_ASYNC | TRACK_UFFD_FEATURE_WP_UNPOPULATED;
+			if (ioctl(fd, UFFDIO_API, &api) != 0)
+			{
+				close(fd);
+				return -1;
+			}
+			return fd;
+		}();
+		return fd;
+	}
+
+	int getPagemapFd()
+	{
+		static int fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+		return fd;
+	}
+}
+#endif
+
+size_t vmemPageSize()
+{
+	static size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+	return pageSize;
+}
+
+void* vmemReserve(size_t bytes, size_t align, bool trackWrites)
+{
+	//Over-reserve so we can trim to alignment
+	size_t padded = bytes + align;
+	void* raw = mmap(nullptr, padded, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (raw == MAP_FAILED) return nullptr;
+
+	uintptr_t start = uintptr_t(raw);
+	uintptr_t aligned = (start + align - 1) & ~uintptr_t(align-1);
+	if (aligned > start) munmap(raw, aligned - start);
+	uintptr_t end = aligned + bytes;
+	if (start + padded > end) munmap((void*) end, start + padded - end);
+
+#if __linux__
+	int trackingFd = trackWrites ? getTrackingFd() : -1;
+	if (trackingFd != -1)
+	{
+		//Only tracking is lost if this fails, and vmemCollectWrites will say so
+		uffdio_register reg = {};
+		reg.range.start = aligned;
+		reg.range.len = bytes;
+		reg.mode = UFFDIO_REGISTER_MODE_WP;
+		ioctl(trackingFd, UFFDIO_REGISTER, &reg);
+	}
+#endif
+
+	return (void*) aligned;
+}
+
+void vmemRelease(void* base, size_t bytes)
+{
+	munmap(base, bytes);
+}
+
+bool vmemCommit(void* ptr, size_t bytes)
+{
+	return mprotect(ptr, bytes, PROT_READ | PROT_WRITE) == 0;
+}
+
+void vmemDecommit(void* ptr, size_t bytes)
+{
+	madvise(ptr, bytes, MADV_DONTNEED); //Return physical pages to the OS
+	mprotect(ptr, bytes, PROT_NONE);
+}
+
+bool vmemAdviseHugePages(void* base, size_t bytes)
+{
+#ifdef MADV_HUGEPAGE
+	return madvise(base, bytes, MADV_HUGEPAGE) == 0;
+#else
+	return false;
+#endif
+}
+
+bool vmemCollectWrites(void* ptr, size_t bytes, std::vector<uint64_t>& out)
+{
+#if __linux__
+	int pagemapFd = getPagemapFd();
+	if (getTrackingFd() == -1 || pagemapFd == -1) return false;
+
+	size_t pageSize = vmemPageSize();
+	out.assign((bytes/pageSize + 63) / 64, 0);
+
+	constexpr size_t nRegions = 64;
+	ScanRegion regions[nRegions];
+	ScanArgs args = {};
+	args.size = sizeof(args);
+	args.flags = SCAN_WP_MATCHING | SCAN_CHECK_WPASYNC;
+	args.start = uintptr_t(ptr);
+	args.end = uintptr_t(ptr) + bytes;
+	args.vec = uintptr_t(regions);
+	args.vec_len = nRegions;
+	args.category_mask = SCAN_PAGE_IS_WRITTEN;
+	args.return_mask = SCAN_PAGE_IS_WRITTEN;
+
+	//Stops early once regions fill up, so pick up where it left off
+	while (args.start < args.end)
+	{
+		long n = ioctl(pagemapFd, SCAN_IOCTL, &args);
+		if (n < 0) return false; //Old kernel, or range wasn't registered
+		for (long i = 0; i < n; ++i)
+		{
+			for (uint64_t page = (regions[i].start - uintptr_t(ptr)) / pageSize; page < (regions[i].end - uintptr_t(ptr)) / pageSize; ++page)
+			{
+				out[page / 64] |= uint64_t(1) << (page % 64);
+			}
+		}
+		if (args.walk_end <= args.start) return false; //No progress, shouldn't happen
+		args.start = args.walk_end;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+#endif
@@ -0,0 +1,254 @@
+#include <doctest/doctest.h>
+
+#include <set>
+#include <vector>
+
+#include "ArchetypeStorage.hpp"
+
+typedef ArchetypeStorage::Entity Entity;
+
+struct Position { float x = 0, y = 0; };
+struct Velocity { float dx = 0, dy = 0; };
+struct Tag {};
+struct alignas(32) Wide { double vals[4] = { 0 }; };
+
+struct Counted
+{
+	static inline int nAlive = 0;
+	int val;
+	Counted(int val) : val(val) { ++nAlive; }
+	~Counted() { --nAlive; }
+};
+
+//Same shape as engine Component: vptr, back-reference, virtual dtor
+class ComponentLike
+{
+public:
+	static inline int nDestroyed = 0;
+	void* owner = nullptr;
+	int val;
+	ComponentLike(int val) : val(val) {}
+	virtual ~ComponentLike() { ++nDestroyed; }
+	virtual int getVal() const { return val; }
+};
+
+TEST_SUITE("ArchetypeStorage")
+{
+	TEST_CASE("Entity lifecycle")
+	{
+		ArchetypeStorage storage;
+
+		Entity a = storage.create();
+		Entity b = storage.create();
+		CHECK(!a.isNull());
+		CHECK(a != b);
+		CHECK(storage.isAlive(a));
+		CHECK(storage.isAlive(b));
+		CHECK(storage.getEntityCount() == 2);
+
+		storage.destroy(a);
+		CHECK(!storage.isAlive(a));
+		CHECK(storage.isAlive(b));
+		CHECK(storage.getEntityCount() == 1);
+		CHECK(storage.get<Position>(a) == nullptr);
+		CHECK(storage.add<Position>(a) == nullptr);
+
+		//Check: index is reused, but old handle stays dead
+		Entity c = storage.create();
+		CHECK(c.index == a.index);
+		CHECK(!storage.isAlive(a));
+		CHECK(storage.isAlive(c));
+
+		storage.destroy(a); //Already dead, mustn't touch c
+		CHECK(storage.isAlive(c));
+		CHECK(!storage.isAlive(Entity()));
+	}
+
+	TEST_CASE("Adding and removing components")
+	{
+		ArchetypeStorage storage;
+		Entity e = storage.create();
+
+		Position* p = storage.add<Position>(e, Position{ 1, 2 });
+		REQUIRE(p);
+		CHECK(storage.has<Position>(e));
+		CHECK(!storage.has<Velocity>(e));
+		CHECK(storage.add<Position>(e) == nullptr); //Already has one
+
+		//Check: values survive moving between tables
+		REQUIRE(storage.add<Velocity>(e, Velocity{ 3, 4 }));
+		REQUIRE(storage.add<Tag>(e));
+		CHECK(storage.get<Position>(e)->x == 1);
+		CHECK(storage.get<Position>(e)->y == 2);
+		CHECK(storage.get<Velocity>(e)->dx == 3);
+		CHECK(storage.get<Velocity>(e)->dy == 4);
+
+		CHECK(storage.remove<Position>(e));
+		CHECK(!storage.remove<Position>(e));
+		CHECK(!storage.has<Position>(e));
+		CHECK(storage.get<Velocity>(e)->dx == 3);
+		CHECK(storage.has<Tag>(e));
+
+		//Check: untyped access agrees
+		CHECK(storage.get(e, TypeName::create<Velocity>()) == storage.get<Velocity>(e));
+		CHECK(storage.get(e, TypeName::create<Position>()) == nullptr);
+		CHECK(storage.get(e, TypeName::create<Counted>()) == nullptr); //Never registered
+
+		//Check: same component sets share a table, whatever order they were added in
+		Entity f = storage.create();
+		storage.add<Tag>(f);
+		storage.add<Velocity>(f);
+		Entity g = storage.create();
+		storage.add<Velocity>(g);
+		size_t nArchetypes = storage.getArchetypeCount();
+		storage.add<Tag>(g);
+		CHECK(storage.getArchetypeCount() == nArchetypes);
+	}
+
+	TEST_CASE("Rows stay dense")
+	{
+		ArchetypeStorage storage;
+
+		//Enough to span several chunks
+		std::vector<Entity> entities;
+		for (int i = 0; i < 5000; ++i)
+		{
+			Entity e = storage.create();
+			storage.add<Position>(e, Position{ float(i), 0 });
+			entities.push_back(e);
+		}
+		size_t fullBytes = storage.getStorageBytes();
+
+		//Remove every other one, from the middle out, so lots of rows are refilled from the back
+		for (int i = 0; i < 5000; i += 2) storage.destroy(entities[i]);
+		for (int i = 1; i < 5000; i += 2)
+		{
+			REQUIRE(storage.isAlive(entities[i]));
+			CHECK(storage.get<Position>(entities[i])->x == float(i));
+		}
+
+		size_t n = 0;
+		storage.query<Position>().foreach([&](Entity e, Position& p)
+		{
+			CHECK(storage.get<Position>(e) == &p);
+			++n;
+		});
+		CHECK(n == 2500);
+		CHECK(storage.getStorageBytes() <= fullBytes);
+	}
+
+	TEST_CASE("Dtors")
+	{
+		Counted::nAlive = 0;
+		{
+			ArchetypeStorage storage;
+			Entity a = storage.create();
+			Entity b = storage.create();
+			Entity c = storage.create();
+			storage.add<Counted>(a, 1);
+			storage.add<Counted>(b, 2);
+			storage.add<Counted>(c, 3);
+			CHECK(Counted::nAlive == 3);
+
+			//Moving tables mustn't destroy or copy
+			storage.add<Position>(a);
+			storage.add<Velocity>(a);
+			storage.remove<Position>(a);
+			CHECK(Counted::nAlive == 3);
+			CHECK(storage.get<Counted>(a)->val == 1);
+
+			storage.remove<Counted>(a);
+			CHECK(Counted::nAlive == 2);
+
+			storage.destroy(b);
+			CHECK(Counted::nAlive == 1);
+			CHECK(storage.get<Counted>(c)->val == 3);
+
+			storage.clear();
+			CHECK(Counted::nAlive == 0);
+			CHECK(!storage.isAlive(c));
+			CHECK(storage.getEntityCount() == 0);
+
+			//Storage dtor
+			storage.add<Counted>(storage.create(), 4);
+			CHECK(Counted::nAlive == 1);
+		}
+		CHECK(Counted::nAlive == 0);
+	}
+
+	TEST_CASE("Component classes as storage")
+	{
+		ComponentLike::nDestroyed = 0;
+		ArchetypeStorage storage;
+
+		std::vector<Entity> entities;
+		for (int i = 0; i < 100; ++i)
+		{
+			Entity e = storage.create();
+			storage.add<ComponentLike>(e, i)->owner = &storage;
+			entities.push_back(e);
+		}
+
+		//Check: vptrs still good after being moved
+		for (int i = 0; i < 100; i += 3) storage.add<Position>(entities[i]);
+		for (int i = 0; i < 100; ++i) CHECK(storage.get<ComponentLike>(entities[i])->getVal() == i);
+		CHECK(ComponentLike::nDestroyed == 0);
+
+		for (int i = 0; i < 100; i += 2) storage.remove<ComponentLike>(entities[i]);
+		CHECK(ComponentLike::nDestroyed == 50);
+	}
+
+	TEST_CASE("Query")
+	{
+		ArchetypeStorage storage;
+
+		std::set<uint32_t> expected;
+		for (int i = 0; i < 300; ++i)
+		{
+			Entity e = storage.create();
+			storage.add<Position>(e, Position{ float(i), 0 });
+			if (i % 2 == 0) storage.add<Velocity>(e, Velocity{ 1, 0 });
+			if (i % 3 == 0) storage.add<Tag>(e);
+			if (i % 2 == 0) expected.insert(e.index);
+		}
+
+		auto moving = storage.query<Position, const Velocity>();
+		CHECK(moving.count() == expected.size());
+
+		SUBCASE("Visits exactly the matching entities")
+		{
+			std::set<uint32_t> visited;
+			moving.foreach([&](Entity e, Position& p, const Velocity& v)
+			{
+				CHECK(visited.insert(e.index).second);
+				p.x += v.dx;
+			});
+			CHECK(visited == expected);
+			for (uint32_t i : expected) CHECK(storage.get<Position>(Entity{ i, 1 })->x == float(i) + 1);
+		}
+
+		SUBCASE("Chunks are contiguous")
+		{
+			size_t total = 0;
+			moving.foreachChunk([&](size_t count, const Entity* entities, Position* positions, const Velocity* velocities)
+			{
+				REQUIRE(count > 0);
+				CHECK(uintptr_t(positions) % ArchetypeStorage::COLUMN_ALIGN == 0);
+				CHECK(uintptr_t(velocities) % ArchetypeStorage::COLUMN_ALIGN == 0);
+				for (size_t i = 0; i < count; ++i) CHECK(storage.get<Position>(entities[i]) == positions+i);
+				total += count;
+			});
+			CHECK(total == expected.size());
+		}
+
+		SUBCASE("Sees tables created after it")
+		{
+			Entity e = storage.create();
+			storage.add<Velocity>(e);
+			storage.add<Wide>(e);
+			storage.add<Position>(e);
+			CHECK(moving.count() == expected.size() + 1);
+			CHECK(uintptr_t(storage.get<Wide>(e)) % alignof(Wide) == 0);
+		}
+	}
+}
@@ -0,0 +1,47 @@
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <vector>
+
+#include "JobSystem.hpp"
+
+TEST_SUITE("JobSystem")
+{
+	TEST_CASE("Every index runs exactly once")
+	{
+		for (size_t nWorkers : { 0, 1, 4 })
+		{
+			JobSystem jobs(nWorkers);
+			CHECK(jobs.getWorkerCount() == nWorkers);
+
+			for (size_t count : { 0, 1, 7, 1000 })
+			{
+				std::vector<std::atomic<int>> hits(count);
+				jobs.parallelFor(count, [&](size_t i) { hits[i]++; });
+
+				bool allOnce = true;
+				for (std::atomic<int>& h : hits) if (h != 1) allOnce = false;
+				CHECK(allOnce);
+			}
+		}
+	}
+
+	TEST_CASE("Nested")
+	{
+		JobSystem jobs(3);
+		std::atomic<size_t> total = 0;
+		jobs.parallelFor(16, [&](size_t) {
+			jobs.parallelFor(64, [&](size_t) { total++; });
+		});
+		CHECK(total == 16*64);
+	}
+
+	TEST_CASE("Back to back")
+	{
+		//Workers go to sleep and wake repeatedly
+		JobSystem jobs(2);
+		std::atomic<size_t> total = 0;
+		for (int i = 0; i < 200; ++i) jobs.parallelFor(10, [&](size_t) { total++; });
+		CHECK(total == 2000);
+	}
+}
@@ -0,0 +1,598 @@
+#include <doctest/doctest.h>
+
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <utility>
+
+#include "ModuleTypeRegistry.hpp"
+#include "GlobalTypeRegistry.hpp"
+#include "TypeBuilder.hpp"
+#include "ThunkUtils.hpp"
+
+#include "MemoryManager.hpp"
+#include "JobSystem.hpp"
+
+struct PooledA { int val = 1; };
+struct PooledB { int val = 2; };
+
+struct SpawnedConcurrently { int val = 3; };
+template<> struct is_spawned_concurrently<SpawnedConcurrently> : std::true_type {};
+
+template<size_t N>
+struct Racer { size_t val = N; };
+
+template<size_t... Ns>
+static void createRacerPools(MemoryManager& memory, std::index_sequence<Ns...>)
+{
+	(memory.getSpecificPool<Racer<Ns>>(true), ...);
+}
+
+struct Linked
+{
+	int val = 0;
+	Linked* next = nullptr;
+};
+
+TEST_SUITE("MemoryManager")
+{
+	TEST_CASE("Pool lookup")
+	{
+		MemoryManager memory;
+
+		SUBCASE("Templated and named lookup agree")
+		{
+			CHECK(memory.getSpecificPool<PooledA>(false) == nullptr);
+			CHECK(memory.getSpecificPool(TypeName::create<PooledA>()) == nullptr);
+
+			TypedMemoryPool<PooledA>* a = memory.getSpecificPool<PooledA>(true);
+			TypedMemoryPool<PooledB>* b = memory.getSpecificPool<PooledB>(true);
+			REQUIRE(a);
+			REQUIRE(b);
+			CHECK((void*)a != (void*)b);
+			CHECK(memory.getSpecificPool<PooledA>(false) == a);
+			CHECK(memory.getSpecificPool<PooledB>(false) == b);
+			CHECK(memory.getSpecificPool(TypeName::create<PooledA>())->getView<PooledA>() == a);
+		}
+
+		SUBCASE("destroyPool invalidates cached lookups")
+		{
+			PooledA* obj = memory.create<PooledA>();
+			REQUIRE(obj);
+			memory.destroy(obj);
+			REQUIRE(memory.getSpecificPool<PooledA>(false)); //Prime cache
+
+			memory.destroyPool<PooledA>();
+			CHECK(memory.getSpecificPool<PooledA>(false) == nullptr);
+			CHECK(memory.getSpecificPool(TypeName::create<PooledA>()) == nullptr);
+
+			//Recreating must not hand back the destroyed pool
+			CHECK(memory.create<PooledA>()->val == 1);
+			CHECK(memory.getSpecificPool(TypeName::create<PooledA>()));
+		}
+
+		SUBCASE("Cache isn't shared between managers")
+		{
+			MemoryManager other;
+			TypedMemoryPool<PooledA>* mine = memory.getSpecificPool<PooledA>(true);
+			CHECK(other.getSpecificPool<PooledA>(false) == nullptr);
+			TypedMemoryPool<PooledA>* theirs = other.getSpecificPool<PooledA>(true);
+			CHECK(mine != theirs);
+			CHECK(memory.getSpecificPool<PooledA>(false) == mine);
+		}
+	}
+
+	TEST_CASE("findOwner")
+	{
+		MemoryManager memory;
+		memory.createPool<PooledA>(RawMemoryPool::StorageMode::Paged); //Grows, unlike the default
+		PooledA* a = memory.create<PooledA>();
+		PooledB* b = memory.create<PooledB>();
+		REQUIRE(a);
+		REQUIRE(b);
+
+		SUBCASE("Finds owning pool")
+		{
+			CHECK(memory.findOwner(a) == memory.getSpecificPool(TypeName::create<PooledA>()));
+			CHECK(memory.findOwner(b) == memory.getSpecificPool(TypeName::create<PooledB>()));
+
+			int notPooled;
+			CHECK(memory.findOwner(&notPooled) == nullptr);
+			CHECK(memory.findOwner(nullptr) == nullptr);
+		}
+
+		SUBCASE("Stays current as pools grow")
+		{
+			REQUIRE(memory.findOwner(a)); //Build index
+
+			//Grow past first page
+			std::vector<PooledA*> objs;
+			for (int i = 0; i < 100000; ++i) objs.push_back(memory.create<PooledA>());
+
+			GenericTypedMemoryPool* pool = memory.getSpecificPool(TypeName::create<PooledA>());
+			CHECK(memory.findOwner(objs.front()) == pool);
+			CHECK(memory.findOwner(objs.back()) == pool);
+			CHECK(memory.findOwner(b) == memory.getSpecificPool(TypeName::create<PooledB>()));
+		}
+
+		SUBCASE("Forgets destroyed pools")
+		{
+			REQUIRE(memory.findOwner(b));
+			memory.destroyPool<PooledB>();
+			CHECK(memory.findOwner(b) == nullptr);
+			CHECK(memory.findOwner(a));
+		}
+	}
+
+	TEST_CASE("Handles")
+	{
+		MemoryManager memory;
+		PooledA* a = memory.create<PooledA>();
+		REQUIRE(a);
+
+		Handle<PooledA> handle = memory.getHandle(a);
+		CHECK(!handle.isNull());
+		CHECK(handle.get() == a);
+		CHECK(handle->val == 1);
+		CHECK(memory.getSpecificPool<PooledA>(false)->resolve(handle) == a);
+		CHECK(memory.getSpecificPool<PooledA>(false)->getHandle(a) == handle);
+
+		//Check: not in PooledA's pool
+		int notPooled;
+		CHECK(memory.getHandle(&notPooled).isNull());
+
+		//Check: released
+		memory.destroy(a);
+		CHECK(!handle);
+		CHECK(handle.get() == nullptr);
+
+		//Check: pool destroyed
+		handle = memory.getHandle(memory.create<PooledA>());
+		CHECK(handle);
+		memory.destroyPool<PooledA>();
+		CHECK(!handle);
+	}
+
+	TEST_CASE("Spawning from worker threads")
+	{
+		MemoryManager memory;
+		memory.createPool<PooledA>(RawMemoryPool::StorageMode::Paged, false, true);
+
+		//Act: every thread spawns into a thread-safe pool, and races the others to make a pool that doesn't exist yet
+		constexpr size_t nThreads = 8;
+		constexpr size_t nPerThread = 1000;
+		std::vector<std::vector<PooledA*>> objs(nThreads);
+		std::vector<std::vector<Handle<PooledA>>> handles(nThreads);
+		std::vector<TypedMemoryPool<PooledB>*> racedPools(nThreads);
+		std::vector<std::thread> threads;
+		for (size_t t = 0; t < nThreads; ++t)
+		{
+			threads.emplace_back(
+				[&, t]()
+				{
+					racedPools[t] = memory.getSpecificPool<PooledB>(true);
+					for (size_t i = 0; i < nPerThread; ++i)
+					{
+						objs[t].push_back(memory.create<PooledA>());
+						handles[t].push_back(memory.getHandle(objs[t].back()));
+					}
+				}
+			);
+		}
+		for (std::thread& t : threads) t.join();
+
+		//Check: only one pool was kept
+		for (TypedMemoryPool<PooledB>* p : racedPools) CHECK(p == memory.getSpecificPool<PooledB>(false));
+
+		//Check: handles were issued before publish, and resolve after
+		CHECK(!handles[0][0]);
+		memory.flushDeferred();
+		for (size_t t = 0; t < nThreads; ++t)
+		{
+			for (size_t i = 0; i < nPerThread; ++i)
+			{
+				REQUIRE(!handles[t][i].isNull());
+				CHECK(handles[t][i].get() == objs[t][i]);
+			}
+		}
+		CHECK(memory.getSpecificPool(TypeName::create<PooledA>())->getNumAllocatedObjects() == nThreads*nPerThread);
+
+		//Cleanup
+		for (const std::vector<PooledA*>& i : objs) for (PooledA* obj : i) memory.destroy(obj);
+	}
+
+	TEST_CASE("Thread-safe pools are opt-in")
+	{
+		MemoryManager memory;
+
+		//Check: plain types allocate and release immediately
+		PooledA* a = memory.create<PooledA>();
+		CHECK(!memory.getSpecificPool(TypeName::create<PooledA>())->isThreadSafe());
+		CHECK(memory.getSpecificPool(TypeName::create<PooledA>())->isAlive(a));
+
+		//Act: marked type is spawned from tasks, past what the default pool size would hold
+		constexpr size_t nObjs = 1000;
+		std::vector<SpawnedConcurrently*> objs(nObjs);
+		{
+			JobSystem jobs(3);
+			jobs.parallelFor(nObjs, [&](size_t i) { objs[i] = memory.create<SpawnedConcurrently>(); });
+		}
+
+		//Check: deferred until the sync point, then all there
+		GenericTypedMemoryPool* pool = memory.getSpecificPool(TypeName::create<SpawnedConcurrently>());
+		REQUIRE(pool);
+		CHECK(pool->isThreadSafe());
+		CHECK(pool->getStorageMode() == RawMemoryPool::StorageMode::Paged);
+		memory.flushDeferred();
+		CHECK(pool->getNumAllocatedObjects() == nObjs);
+		bool allAlive = true;
+		for (SpawnedConcurrently* obj : objs) if (!obj || !pool->isAlive(obj)) allAlive = false;
+		CHECK(allAlive);
+
+		//Cleanup
+		for (SpawnedConcurrently* obj : objs) memory.destroy(obj);
+		memory.destroy(a);
+	}
+
+	TEST_CASE("Pools created while walking")
+	{
+		MemoryManager memory;
+		memory.createPool<PooledA>(RawMemoryPool::StorageMode::Paged, false, true);
+
+		//Act: workers keep creating pools for new types while this thread walks the pool list
+		std::atomic<bool> done = false;
+		std::thread creator(
+			[&]()
+			{
+				createRacerPools(memory, std::make_index_sequence<64>());
+				done = true;
+			}
+		);
+		size_t nWalks = 0;
+		while (!done || nWalks == 0)
+		{
+			size_t nSeen = 0;
+			memory.foreachPool([&](const GenericTypedMemoryPool*) { ++nSeen; });
+			memory.flushDeferred();
+			CHECK(nSeen >= 1);
+			++nWalks;
+		}
+		creator.join();
+
+		//Check
+		size_t nPools = 0;
+		memory.foreachPool([&](const GenericTypedMemoryPool*) { ++nPools; });
+		CHECK(nPools == 64+1);
+	}
+
+	TEST_CASE("snapshot")
+	{
+		MemoryManager memory;
+		memory.createPool<PooledA>(RawMemoryPool::StorageMode::Paged);
+		std::vector<PooledA*> objs;
+		for (int i = 0; i < 1000; ++i)
+		{
+			objs.push_back(memory.create<PooledA>());
+			objs.back()->val = i;
+		}
+		PooledB* b = memory.create<PooledB>();
+		Handle<PooledA> handle = memory.getHandle(objs[10]);
+
+		MemorySnapshot full = memory.snapshot();
+		CHECK(full.getOwnBytes() >= 1001 * sizeof(int));
+
+		SUBCASE("Restore")
+		{
+			//Act: mutate, release, create
+			objs[0]->val = -1;
+			memory.destroy(objs[10]);
+			PooledA* created = memory.create<PooledA>();
+			b->val = 99;
+
+			memory.restore(full);
+
+			//Check: values and liveness are back
+			GenericTypedMemoryPool* pool = memory.getSpecificPool(TypeName::create<PooledA>());
+			CHECK(pool->getNumAllocatedObjects() == 1000);
+			for (int i = 0; i < 1000; ++i)
+			{
+				REQUIRE(pool->isAlive(objs[i]));
+				CHECK(objs[i]->val == i);
+			}
+			CHECK(b->val == 2);
+			CHECK(!handle.get()); //Released since capture, so its handles are retired for good
+			CHECK(memory.getHandle(objs[10]).get() == objs[10]);
+			if (created != objs[10]) CHECK(!pool->isAlive(created));
+
+			//Check: pool still works
+			PooledA* more = memory.create<PooledA>();
+			CHECK(more);
+			CHECK(pool->getNumAllocatedObjects() == 1001);
+		}
+
+		SUBCASE("Delta")
+		{
+			//Act: small change
+			objs[500]->val = -500;
+			MemorySnapshot delta = memory.snapshot(&full);
+
+			//Check: only the changed chunk was copied
+			CHECK(delta.getOwnBytes() > 0);
+			CHECK(delta.getOwnBytes() < full.getOwnBytes() / 4);
+
+			//Check: restores both ways, even once base is gone
+			memory.restore(full);
+			CHECK(objs[500]->val == 500);
+			full = MemorySnapshot();
+			memory.restore(delta);
+			CHECK(objs[500]->val == -500);
+			CHECK(objs[499]->val == 499);
+			CHECK(b->val == 2);
+		}
+
+		SUBCASE("Across growth")
+		{
+			//Act: grow past capacity, then roll back
+			for (int i = 0; i < 5000; ++i) memory.create<PooledA>();
+			memory.restore(full);
+
+			//Check
+			GenericTypedMemoryPool* pool = memory.getSpecificPool(TypeName::create<PooledA>());
+			CHECK(pool->getNumAllocatedObjects() == 1000);
+			for (int i = 0; i < 1000; ++i) CHECK(objs[i]->val == i);
+		}
+
+		SUBCASE("Handles issued since don't come back")
+		{
+			//Act: recycle a slot, take a handle to the new object, then roll back
+			Handle<PooledA> untouched = memory.getHandle(objs[20]);
+			memory.destroy(objs[10]);
+			PooledA* created = memory.create<PooledA>();
+			Handle<PooledA> stale = memory.getHandle(created);
+			REQUIRE(stale.get() == created);
+			memory.restore(full);
+
+			//Check: handles to untouched objects still resolve, ones into the recycled slot don't
+			CHECK(untouched.get() == objs[20]);
+			CHECK(!stale.get());
+			CHECK(!handle.get());
+
+			//Check: not even once the same slot cycles through the same number of releases again
+			Handle<PooledA> fresh = memory.getHandle(objs[10]);
+			CHECK(fresh.get() == objs[10]);
+			memory.destroy(objs[10]);
+			PooledA* again = memory.create<PooledA>();
+			CHECK(!stale.get());
+			CHECK(!handle.get());
+			CHECK(!fresh.get());
+			CHECK(memory.getHandle(again).get() == again);
+		}
+	}
+
+	TEST_CASE("snapshot with write tracking")
+	{
+		MemoryManager memory;
+		memory.createPool<PooledA>(RawMemoryPool::StorageMode::Reserved);
+		GenericTypedMemoryPool* pool = memory.getSpecificPool(TypeName::create<PooledA>());
+		std::vector<PooledA*> objs;
+		for (int i = 0; i < 10000; ++i)
+		{
+			objs.push_back(memory.create<PooledA>());
+			objs.back()->val = i;
+		}
+
+		MemorySnapshot s0 = memory.snapshot();
+		objs[5000]->val = -1;
+		MemorySnapshot s1 = memory.snapshot(&s0);
+		objs[6000]->val = -2;
+		MemorySnapshot s2 = memory.snapshot(&s1);
+
+		//Check: deltas only copy what changed. Exact where the OS can track writes, otherwise still deduped by comparing.
+		CHECK(s1.getOwnBytes() < s0.getOwnBytes() / 4);
+		CHECK(s2.getOwnBytes() < s0.getOwnBytes() / 4);
+
+		//Act: delta against something other than the last capture, so writes since then aren't known
+		objs[7000]->val = -3;
+		MemorySnapshot s3 = memory.snapshot(&s0);
+		CHECK(s3.getOwnBytes() < s0.getOwnBytes() / 4);
+
+		//Check: every one restores exactly
+		auto check = [&](int v5000, int v6000, int v7000)
+		{
+			CHECK(pool->getNumAllocatedObjects() == 10000);
+			CHECK(objs[5000]->val == v5000);
+			CHECK(objs[6000]->val == v6000);
+			CHECK(objs[7000]->val == v7000);
+			bool othersMatch = true;
+			for (int i = 0; i < 10000; ++i) if (i != 5000 && i != 6000 && i != 7000 && objs[i]->val != i) othersMatch = false;
+			CHECK(othersMatch);
+		};
+		memory.restore(s0);
+		check(5000, 6000, 7000);
+		memory.restore(s2);
+		check(-1, -2, 7000);
+		memory.restore(s1);
+		check(-1, 6000, 7000);
+		memory.restore(s3);
+		check(-1, -2, -3);
+
+		//Act: capture after restoring, then write only to one object
+		MemorySnapshot s4 = memory.snapshot(&s3);
+		objs[5000]->val = -4;
+		MemorySnapshot s5 = memory.snapshot(&s4);
+		CHECK(s5.getOwnBytes() < s0.getOwnBytes() / 4);
+		memory.restore(s0);
+		memory.restore(s5);
+		check(-4, -2, -3);
+
+		for (PooledA* obj : objs) memory.destroy(obj);
+	}
+
+	TEST_CASE("Capacity profile")
+	{
+		std::filesystem::path path = std::filesystem::temp_directory_path() / "TestMemoryManager_profile.txt";
+
+		//Setup: last session had a type we won't see this time
+		{
+			std::ofstream file(path, std::ios::trunc);
+			file << "# comment\n" << "123 SomeRemovedType\n" << "not a number\n";
+		}
+
+		//Act 1: run a session
+		{
+			MemoryManager memory;
+			CHECK(memory.loadCapacityProfile(path));
+			memory.createPool<PooledA>(RawMemoryPool::StorageMode::Paged);
+
+			std::vector<PooledA*> as;
+			for (int i = 0; i < 300; ++i) as.push_back(memory.create<PooledA>());
+			for (int i = 0; i < 200; ++i) memory.destroy(as[i]); //Peak stays at 300
+			memory.create<PooledB>();
+			memory.destroyPool<PooledB>(); //Destroyed pools still count
+
+			CHECK(memory.saveCapacityProfile(path));
+		}
+
+		//Act 2: next session
+		MemoryManager memory;
+		CHECK(memory.loadCapacityProfile(path));
+
+		//Check: pools start pre-sized, and unseen types are kept
+		CHECK(memory.getSpecificPool(TypeName::create<PooledA>()) == nullptr);
+		memory.getSpecificPool<PooledA>(true);
+		GenericTypedMemoryPool* a = memory.getSpecificPool(TypeName::create<PooledA>());
+		REQUIRE(a);
+		CHECK(a->getMaxNumObjects() >= 300);
+		memory.getSpecificPool<PooledB>(true);
+		CHECK(memory.getSpecificPool(TypeName::create<PooledB>())->getMaxNumObjects() >= 1);
+
+		std::ifstream file(path);
+		std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		CHECK(contents.find("123 SomeRemovedType") != std::string::npos);
+
+		//Check: missing file
+		CHECK(!memory.loadCapacityProfile(path.string() + ".missing"));
+		file.close();
+		std::filesystem::remove(path);
+	}
+
+	TEST_CASE("updatePointers")
+	{
+		//Prepare clean RTTI state
+		{
+			GlobalTypeRegistry::clear();
+			ModuleTypeRegistry m;
+			TypeBuilder b = TypeBuilder::create<Linked>();
+			b.addConstructor(stix::StaticFunction::make(&thunk_utils<Linked>::thunk_newInPlace<>), MemberVisibility::Public);
+			b.addField<int>("val", [](const void*) { return ptrdiff_t(offsetof(Linked, val)); });
+			b.addField<Linked*>("next", [](const void*) { return ptrdiff_t(offsetof(Linked, next)); });
+			b.captureClassImage_v2<Linked>();
+			b.registerType(&m);
+			GlobalTypeRegistry::loadModule("MemoryManager dummies", m);
+		}
+
+		//Setup: two objects pointing at each other
+		MemoryManager memory;
+		Linked* a = memory.create<Linked>();
+		Linked* b = memory.create<Linked>();
+		a->val = 1;
+		b->val = 2;
+		a->next = b;
+		b->next = a;
+		memory.ensureFresh();
+
+		//Act: move b by hand
+		Linked* moved = memory.create<Linked>();
+		MemoryMapper remapper;
+		remapper.rawMove(moved, b, sizeof(Linked));
+		memory.destroy(b);
+		memory.updatePointers(remapper);
+
+		//Check
+		CHECK(a->next == moved);
+		CHECK(moved->next == a);
+		CHECK(moved->val == 2);
+
+		GlobalTypeRegistry::clear();
+	}
+
+	TEST_CASE("compact")
+	{
+		//Prepare clean RTTI state
+		{
+			GlobalTypeRegistry::clear();
+			ModuleTypeRegistry m;
+			TypeBuilder b = TypeBuilder::create<Linked>();
+			b.addConstructor(stix::StaticFunction::make(&thunk_utils<Linked>::thunk_newInPlace<>), MemberVisibility::Public);
+			b.addField<int>("val", [](const void*) { return ptrdiff_t(offsetof(Linked, val)); });
+			b.addField<Linked*>("next", [](const void*) { return ptrdiff_t(offsetof(Linked, next)); });
+			b.captureClassImage_v2<Linked>();
+			b.registerType(&m);
+			GlobalTypeRegistry::loadModule("MemoryManager dummies", m);
+		}
+
+		//Setup: list threaded through a pool, then every other node removed
+		MemoryManager memory;
+		memory.createPool<Linked>(RawMemoryPool::StorageMode::Paged);
+		constexpr int nObjs = 1000;
+		std::vector<Linked*> objs;
+		for (int i = 0; i < nObjs; ++i)
+		{
+			objs.push_back(memory.create<Linked>());
+			objs.back()->val = i;
+		}
+		memory.ensureFresh();
+		Linked* head = nullptr;
+		for (int i = nObjs-1; i >= 0; --i)
+		{
+			if (i%2 == 0)
+			{
+				objs[i]->next = head;
+				head = objs[i];
+			}
+			else memory.destroy(objs[i]);
+		}
+		GenericTypedMemoryPool* pool = memory.getSpecificPool(TypeName::create<Linked>());
+		REQUIRE(pool->getFragmentation() > 0.25f);
+
+		SUBCASE("Below threshold does nothing")
+		{
+			MemoryMapper remapper;
+			CHECK(memory.compact(0.9f, std::chrono::seconds(1), &remapper));
+			CHECK(remapper.isEmpty());
+		}
+
+		SUBCASE("Runs to completion")
+		{
+			//Act
+			MemoryMapper remapper;
+			while (!memory.compact(0.25f, std::chrono::seconds(1), &remapper)) {}
+			head = remapper.transformAddress(head); //External pointer, fixed by caller
+
+			//Check
+			CHECK(pool->getFragmentation() == 0);
+			int expected = 0;
+			for (Linked* i = head; i; i = i->next)
+			{
+				REQUIRE(pool->contains(i));
+				CHECK(i->val == expected);
+				expected += 2;
+			}
+			CHECK(expected == nObjs);
+		}
+
+		SUBCASE("Zero budget does no work")
+		{
+			MemoryMapper remapper;
+			CHECK(!memory.compact(0.25f, std::chrono::nanoseconds(0), &remapper));
+			CHECK(remapper.isEmpty());
+		}
+
+		//Cleanup
+		pool->foreachLive([&](void* obj) { objs.push_back((Linked*)obj); }); //Collect before releasing, so iteration isn't disturbed
+		objs.erase(objs.begin(), objs.begin()+nObjs);
+		for (Linked* obj : objs) memory.destroy(obj);
+		GlobalTypeRegistry::clear();
+	}
+}
@@ -29,6 +29,13 @@ public:
 	virtual void virtFn() override { ++canary2; }
 };
 
+class ParallelCallable : public MyCallable
+{
+public:
+	virtual ~ParallelCallable() {}
+};
+template<> struct is_parallel_safe<ParallelCallable> : std::true_type {};
+
 void buildDummyRTTI(ModuleTypeRegistry* m)
 {
 	{
@@ -45,6 +52,14 @@ void buildDummyRTTI(ModuleTypeRegistry* m)
 		b.captureClassImage_v2<ChildCallable>();
 		b.registerType(m);
 	}
+
+	{
+		TypeBuilder b = TypeBuilder::create<ParallelCallable>();
+		b.addConstructor(stix::StaticFunction::make(&thunk_utils<ParallelCallable>::thunk_newInPlace<>), MemberVisibility::Public);
+		b.addParent<ParallelCallable, MyCallable>(MemberVisibility::Public, ParentInfo::Virtualness::NonVirtual);
+		b.captureClassImage_v2<ParallelCallable>();
+		b.registerType(m);
+	}
 }
 
 TEST_CASE("PoolCallBatcher")
@@ -101,4 +116,50 @@ TEST_CASE("PoolCallBatcher")
 		batcher.memberCall(&MyCallable::memFn);
 		CHECK(c5->canary == 1);
 	}
+
+	SUBCASE("Parallel call")
+	{
+		//Enough to span several chunks, with holes
+		memory.createPool<ParallelCallable>(RawMemoryPool::StorageMode::Paged);
+		std::vector<ParallelCallable*> parallel;
+		for (int i = 0; i < 5000; ++i) parallel.push_back(memory.create<ParallelCallable>());
+		for (int i = 0; i < 5000; i += 7) memory.destroy(parallel[i]);
+		memory.ensureFresh();
+		batcher.ensureFresh(&memory);
+
+		JobSystem jobs(3);
+		batcher.parallelMemberCall(&jobs, &MyCallable::virtFn);
+
+		//Unsafe types still called exactly once
+		CHECK(c1->canary == 1);
+		CHECK(c2->canary == 1);
+		CHECK(c3->canary2 == 1);
+		CHECK(c4->canary2 == 1);
+
+		bool allOnce = true;
+		for (int i = 0; i < 5000; ++i) if (i%7 != 0 && parallel[i]->canary != 1) allOnce = false;
+		CHECK(allOnce);
+
+		//Halves only cover their own pools
+		batcher.serialMemberCall(&MyCallable::virtFn);
+		CHECK(c1->canary == 2);
+		CHECK(c3->canary2 == 2);
+		CHECK(parallel[1]->canary == 1);
+		batcher.parallelSafeMemberCall(&jobs, &MyCallable::virtFn);
+		CHECK(c1->canary == 2);
+		allOnce = true;
+		for (int i = 0; i < 5000; ++i) if (i%7 != 0 && parallel[i]->canary != 2) allOnce = false;
+		CHECK(allOnce);
+
+		//Pool by pool, as the frame graph does. Unchanged, so indices are still valid.
+		CHECK(!batcher.ensureFresh(&memory));
+		for (size_t i = 0; i < batcher.count(); ++i) batcher.poolMemberCall(&jobs, i, &MyCallable::virtFn);
+		CHECK(c1->canary == 3);
+		CHECK(c3->canary2 == 3);
+		allOnce = true;
+		for (int i = 0; i < 5000; ++i) if (i%7 != 0 && parallel[i]->canary != 3) allOnce = false;
+		CHECK(allOnce);
+
+		for (int i = 0; i < 5000; ++i) if (i%7 != 0) memory.destroy(parallel[i]);
+	}
 }
@@ -1,5 +1,8 @@
 #include <doctest/doctest.h>
 
+#include <thread>
+#include <set>
+
 #include "RawMemoryPool.hpp"
 
 TEST_SUITE("RawMemoryPool")
@@ -54,8 +57,466 @@ TEST_SUITE("RawMemoryPool")
 			CHECK(pool.getNumAllocatedObjects() == nObjs-1);
 			CHECK(pool.getNumFreeObjects() == 1);
 		}
+
+		SUBCASE("Freed slots are reused")
+		{
+			//Setup: enough objects to span multiple living list words
+			constexpr size_t nObjs = 200;
+			RawMemoryPool pool(nObjs, sizeof(int), alignof(int));
+			void* objs[nObjs];
+			for (int i = 0; i < nObjs; ++i) objs[i] = pool.allocate();
+			REQUIRE(pool.allocate() == nullptr);
+
+			//Act
+			pool.release(objs[130]);
+			pool.release(objs[7]);
+			void* reuse1 = pool.allocate();
+			void* reuse2 = pool.allocate();
+
+			//Check: lowest free slot is always chosen first
+			CHECK(reuse1 == objs[7]);
+			CHECK(reuse2 == objs[130]);
+			CHECK(pool.allocate() == nullptr);
+		}
+
+		SUBCASE("Bulk allocate")
+		{
+			//Setup
+			constexpr size_t nObjs = 100;
+			RawMemoryPool pool(nObjs, sizeof(int), alignof(int));
+			void* first = pool.allocate();
+
+			//Act: ask for more than will fit
+			void* objs[nObjs];
+			size_t nAllocated = pool.allocate(nObjs, objs);
+
+			//Check
+			CHECK(nAllocated == nObjs-1);
+			CHECK(pool.getNumFreeObjects() == 0);
+			for (size_t i = 0; i < nAllocated; ++i)
+			{
+				CHECK(objs[i] != first);
+				CHECK(pool.isAlive(objs[i]));
+			}
+			for (size_t i = 1; i < nAllocated; ++i) CHECK(objs[i-1] < objs[i]); //Unique and ordered
+		}
 	}
 
+	TEST_CASE("Capacity")
+	{
+		SUBCASE("Contiguous setMaxNumObjects")
+		{
+			//Setup
+			RawMemoryPool pool(4, sizeof(int), alignof(int));
+			for (int i = 0; i < 4; ++i) REQUIRE(pool.allocate());
+			REQUIRE(pool.allocate() == nullptr);
+
+			//Act: grow
+			pool.setMaxNumObjects(100);
+
+			//Check
+			CHECK(pool.getMaxNumObjects() == 100);
+			CHECK(pool.getNumAllocatedObjects() == 4);
+			for (int i = 4; i < 100; ++i) CHECK(pool.allocate());
+			CHECK(pool.allocate() == nullptr);
+
+			//Act: shrink
+			pool.setMaxNumObjects(10);
+
+			//Check: objects that didn't fit were released
+			CHECK(pool.getMaxNumObjects() == 10);
+			CHECK(pool.getNumAllocatedObjects() == 10);
+			CHECK(pool.allocate() == nullptr);
+		}
+
+		SUBCASE("Paged growth is address-stable")
+		{
+			//Setup: starts empty, must grow on demand
+			constexpr size_t nObjs = 100000; //Past old 16-bit ID limit
+			RawMemoryPool pool(0, sizeof(size_t), alignof(size_t), RawMemoryPool::StorageMode::Paged);
+			CHECK(pool.getMaxNumObjects() == 0);
+
+			//Act
+			std::vector<size_t*> objs;
+			objs.reserve(nObjs);
+			for (size_t i = 0; i < nObjs; ++i)
+			{
+				size_t* obj = (size_t*)pool.allocate();
+				REQUIRE(obj);
+				*obj = i;
+				objs.push_back(obj);
+			}
+
+			//Check: Nothing moved
+			CHECK(pool.getNumAllocatedObjects() == nObjs);
+			CHECK(pool.getMaxNumObjects() >= nObjs);
+			CHECK(pool.getMaxNumObjects() % pool.getObjectsPerPage() == 0);
+			for (size_t i = 0; i < nObjs; ++i)
+			{
+				CHECK(*objs[i] == i);
+				CHECK(pool.contains(objs[i]));
+				CHECK(pool.isAlive(objs[i]));
+			}
+
+			//Check: Freed slots are still reused before growing
+			size_t capacity = pool.getMaxNumObjects();
+			pool.release(objs[nObjs/2]);
+			CHECK(!pool.isAlive(objs[nObjs/2]));
+			CHECK(pool.allocate() == objs[nObjs/2]);
+			CHECK(pool.getMaxNumObjects() == capacity);
+
+			//Check: Pages holding living objects are never dropped
+			pool.setMaxNumObjects(0);
+			CHECK(pool.getMaxNumObjects() == capacity);
+			for (size_t* obj : objs) pool.release(obj);
+			pool.setMaxNumObjects(0);
+			CHECK(pool.getMaxNumObjects() == 0);
+		}
+
+		SUBCASE("Reserved growth is address-stable")
+		{
+			//Setup: starts empty, must grow on demand
+			constexpr size_t nObjs = 100000;
+			RawMemoryPool pool(0, sizeof(size_t), alignof(size_t), RawMemoryPool::StorageMode::Reserved);
+			pool.requestHugePages(); //Only a hint, result doesn't matter
+
+			//Act
+			std::vector<size_t*> objs;
+			objs.reserve(nObjs);
+			for (size_t i = 0; i < nObjs; ++i)
+			{
+				size_t* obj = (size_t*)pool.allocate();
+				REQUIRE(obj);
+				*obj = i;
+				objs.push_back(obj);
+			}
+
+			//Check: Nothing moved
+			CHECK(pool.getNumAllocatedObjects() == nObjs);
+			CHECK(pool.getMaxNumObjects() >= nObjs);
+			for (size_t i = 0; i < nObjs; ++i)
+			{
+				CHECK(*objs[i] == i);
+				CHECK(pool.contains(objs[i]));
+				CHECK(pool.isAlive(objs[i]));
+			}
+
+			//Check: Shrinking releases objects that no longer fit
+			pool.setMaxNumObjects(10);
+			CHECK(pool.getMaxNumObjects() >= 10);
+			CHECK(pool.getMaxNumObjects() < nObjs);
+			CHECK(pool.getNumAllocatedObjects() == pool.getMaxNumObjects());
+			CHECK(*objs[9] == 9);
+		}
+	}
+
+
+	TEST_CASE("Iteration")
+	{
+		RawMemoryPool::StorageMode storageMode;
+		SUBCASE("Contiguous") { storageMode = RawMemoryPool::StorageMode::Contiguous; }
+		SUBCASE("Paged"     ) { storageMode = RawMemoryPool::StorageMode::Paged;      }
+
+		//Setup: sparse pool spanning several words, with slot 0 dead
+		constexpr size_t nObjs = 1000;
+		RawMemoryPool pool(nObjs, sizeof(int), alignof(int), storageMode);
+		void* objs[nObjs];
+		REQUIRE(pool.allocate(nObjs, objs) == nObjs);
+		std::vector<void*> expected;
+		for (size_t i = 0; i < nObjs; ++i)
+		{
+			bool keep = (i%3 == 1) || (200 <= i && i < 700); //Short runs, then one long run crossing many words
+			if (keep) expected.push_back(objs[i]);
+			else pool.release(objs[i]);
+		}
+
+		SUBCASE("const_iterator")
+		{
+			std::vector<void*> visited;
+			for (auto it = pool.cbegin(); it != pool.cend(); ++it) visited.push_back(*it);
+			CHECK(visited == expected);
+		}
+
+		SUBCASE("foreachLive")
+		{
+			std::vector<void*> visited;
+			pool.foreachLive([&](void* obj) { visited.push_back(obj); });
+			CHECK(visited == expected);
+		}
+
+		SUBCASE("foreachLiveSpan")
+		{
+			std::vector<void*> visited;
+			size_t nSpans = 0;
+			pool.foreachLiveSpan(
+				[&](const RawMemoryPool::LiveSpan& span)
+				{
+					REQUIRE(span.count > 0);
+					for (size_t i = 0; i < span.count; ++i) visited.push_back(((char*)span.first) + i*pool.getMaxObjectSize());
+					++nSpans;
+				}
+			);
+			CHECK(visited == expected);
+			CHECK(nSpans < expected.size()); //Long run was merged
+		}
+
+		SUBCASE("Empty pool")
+		{
+			for (void* obj : expected) pool.release(obj);
+			CHECK(!(pool.cbegin() != pool.cend()));
+			pool.foreachLiveSpan([](const RawMemoryPool::LiveSpan&) { FAIL("Visited dead object"); });
+		}
+	}
+
+	TEST_CASE("Compaction")
+	{
+		RawMemoryPool::StorageMode storageMode;
+		SUBCASE("Contiguous") { storageMode = RawMemoryPool::StorageMode::Contiguous; }
+		SUBCASE("Paged"     ) { storageMode = RawMemoryPool::StorageMode::Paged;      }
+
+		//Setup: sparse pool, tagged with original index
+		constexpr size_t nObjs = 1000;
+		RawMemoryPool pool(nObjs, sizeof(size_t), alignof(size_t), storageMode);
+		size_t* objs[nObjs];
+		REQUIRE(pool.allocate(nObjs, (void**)objs) == nObjs);
+		std::vector<size_t*> kept;
+		for (size_t i = 0; i < nObjs; ++i)
+		{
+			*objs[i] = i;
+			if (i%3 == 0 || i > 900) kept.push_back(objs[i]);
+			else pool.release(objs[i]);
+		}
+		size_t nKept = kept.size();
+		CHECK(pool.getFragmentation() > 0.5f);
+
+		//Act: a few moves at a time
+		MemoryMapper remapper;
+		size_t nSteps = 0;
+		while (!pool.compact(16, &remapper)) ++nSteps;
+
+		//Check: work was split up
+		CHECK(nSteps > 1);
+
+		//Check: dense prefix
+		CHECK(pool.getFragmentation() == 0);
+		CHECK(pool.getNumAllocatedObjects() == nKept);
+		for (size_t i = 0; i < nObjs; ++i) CHECK(pool.isAlive(objs[i]) == (i < nKept));
+
+		//Check: every object can be found, with its value intact
+		std::vector<bool> found(nObjs, false);
+		for (size_t* obj : kept)
+		{
+			size_t* moved = remapper.transformAddress(obj);
+			REQUIRE(pool.isAlive(moved));
+			size_t i = *moved;
+			CHECK(!found[i]);
+			found[i] = true;
+		}
+
+		//Check: already-compact pool does nothing
+		MemoryMapper noop;
+		CHECK(pool.compact(16, &noop));
+		CHECK(noop.isEmpty());
+	}
+
+	TEST_CASE("Handles")
+	{
+		RawMemoryPool::StorageMode storageMode;
+		SUBCASE("Contiguous") { storageMode = RawMemoryPool::StorageMode::Contiguous; }
+		SUBCASE("Paged"     ) { storageMode = RawMemoryPool::StorageMode::Paged;      }
+		SUBCASE("Reserved"  ) { storageMode = RawMemoryPool::StorageMode::Reserved;   }
+
+		SUBCASE("Resolve and release")
+		{
+			RawMemoryPool pool(4, sizeof(int), alignof(int), storageMode);
+			void* obj = pool.allocate();
+			RawMemoryPool::RawHandle handle = pool.getHandle(obj);
+			CHECK(handle.pool == pool.getPoolId());
+			CHECK(pool.resolve(handle) == obj);
+			CHECK(RawMemoryPool::resolveAny(handle) == obj);
+
+			//Check: released object doesn't resolve, even once its slot is reused
+			pool.release(obj);
+			CHECK(pool.resolve(handle) == nullptr);
+			void* reused = pool.allocate();
+			REQUIRE(reused == obj);
+			CHECK(pool.resolve(handle) == nullptr);
+			CHECK(pool.getHandle(reused) != handle);
+			CHECK(pool.resolve(pool.getHandle(reused)) == reused);
+
+			//Check: reset invalidates too
+			RawMemoryPool::RawHandle reusedHandle = pool.getHandle(reused);
+			pool.reset();
+			CHECK(pool.resolve(reusedHandle) == nullptr);
+		}
+
+		SUBCASE("Other pools")
+		{
+			RawMemoryPool::RawHandle handle;
+			CHECK(RawMemoryPool::resolveAny(handle) == nullptr); //Null handle
+
+			RawMemoryPool other(4, sizeof(int), alignof(int), storageMode);
+			{
+				RawMemoryPool pool(4, sizeof(int), alignof(int), storageMode);
+				handle = pool.getHandle(pool.allocate());
+				CHECK(other.resolve(handle) == nullptr);
+				pool.reset();
+			}
+			CHECK(RawMemoryPool::resolveAny(handle) == nullptr); //Pool destroyed
+		}
+
+		SUBCASE("Survives compaction and growth")
+		{
+			//Setup: sparse pool, tagged with original index
+			constexpr size_t nObjs = 500;
+			RawMemoryPool pool(nObjs, sizeof(size_t), alignof(size_t), storageMode);
+			size_t* objs[nObjs];
+			REQUIRE(pool.allocate(nObjs, (void**)objs) == nObjs);
+			std::vector<std::pair<RawMemoryPool::RawHandle, size_t>> kept;
+			std::vector<RawMemoryPool::RawHandle> dropped;
+			for (size_t i = 0; i < nObjs; ++i)
+			{
+				*objs[i] = i;
+				if (i%4 == 0) kept.emplace_back(pool.getHandle(objs[i]), i);
+				else
+				{
+					dropped.push_back(pool.getHandle(objs[i]));
+					pool.release(objs[i]);
+				}
+			}
+
+			//Act
+			MemoryMapper remapper;
+			while (!pool.compact(16, &remapper)) {}
+			pool.setMaxNumObjects(nObjs*4, &remapper);
+			for (size_t i = 0; i < nObjs; ++i) (void)pool.allocate(); //Refill holes
+
+			//Check: no pointer chasing needed
+			for (const auto& [handle, i] : kept)
+			{
+				size_t* obj = (size_t*)pool.resolve(handle);
+				REQUIRE(obj);
+				CHECK(*obj == i);
+			}
+			for (const RawMemoryPool::RawHandle& handle : dropped) CHECK(pool.resolve(handle) == nullptr);
+		}
+
+		SUBCASE("First handle after moves and restore")
+		{
+			//Setup: objects move and get captured before the pool has issued any handle
+			constexpr size_t nObjs = 100;
+			RawMemoryPool pool(nObjs, sizeof(size_t), alignof(size_t), storageMode);
+			size_t* objs[nObjs];
+			REQUIRE(pool.allocate(nObjs, (void**)objs) == nObjs);
+			for (size_t i = 0; i < nObjs; ++i) *objs[i] = i;
+			for (size_t i = 0; i < nObjs; i += 2) pool.release(objs[i]);
+			MemoryMapper remapper;
+			while (!pool.compact(16, &remapper)) {}
+			std::vector<std::pair<size_t, size_t>> runs = { { 0, sizeof(size_t) } };
+			RawMemoryPool::State state;
+			pool.captureState(state, runs);
+
+			//Act
+			size_t* kept = nullptr;
+			pool.foreachLive([&](void* obj) { if (!kept) kept = (size_t*)obj; });
+			REQUIRE(kept);
+			RawMemoryPool::RawHandle keptHandle = pool.getHandle(kept);
+			RawMemoryPool::RawHandle createdHandle = pool.getHandle(pool.allocate());
+			pool.restoreState(state, runs);
+
+			//Check: object alive at capture still resolves, object created since doesn't
+			CHECK(pool.resolve(keptHandle) == kept);
+			CHECK(pool.resolve(createdHandle) == nullptr);
+		}
+	}
+
+	TEST_CASE("Thread safety")
+	{
+		RawMemoryPool::StorageMode storageMode;
+		SUBCASE("Paged"   ) { storageMode = RawMemoryPool::StorageMode::Paged;    }
+		SUBCASE("Reserved") { storageMode = RawMemoryPool::StorageMode::Reserved; }
+
+		RawMemoryPool pool(0, sizeof(size_t), alignof(size_t), storageMode);
+		pool.setThreadSafe(true);
+		REQUIRE(pool.isThreadSafe());
+
+		SUBCASE("Deferred publish and release")
+		{
+			size_t* obj = (size_t*)pool.allocate();
+			REQUIRE(obj);
+			CHECK(!pool.isAlive(obj));
+
+			//Check: handle can be taken before publish, but only resolves after
+			RawMemoryPool::RawHandle handle = pool.tryGetHandle(obj);
+			CHECK(handle != RawMemoryPool::RawHandle());
+			CHECK(pool.resolve(handle) == nullptr);
+
+			CHECK(pool.flushDeferred());
+			CHECK(pool.isAlive(obj));
+			CHECK(pool.resolve(handle) == obj);
+
+			pool.release(obj);
+			CHECK(pool.isAlive(obj));
+			CHECK(pool.flushDeferred());
+			CHECK(!pool.isAlive(obj));
+			CHECK(!pool.flushDeferred());
+			CHECK(pool.resolve(handle) == nullptr);
+			CHECK(pool.tryGetHandle(obj) == RawMemoryPool::RawHandle());
+		}
+
+		SUBCASE("Many threads")
+		{
+			//Act: every thread allocates, frees half, then allocates more
+			constexpr size_t nThreads = 8;
+			constexpr size_t nPerThread = 5000;
+			std::vector<std::vector<size_t*>> kept(nThreads);
+			std::vector<std::vector<RawMemoryPool::RawHandle>> handles(nThreads);
+			std::vector<std::thread> threads;
+			for (size_t t = 0; t < nThreads; ++t)
+			{
+				threads.emplace_back(
+					[&, t]()
+					{
+						for (size_t i = 0; i < nPerThread; ++i)
+						{
+							size_t* obj = (size_t*)pool.allocate();
+							*obj = t*nPerThread + i;
+							if (i%2) pool.release(obj);
+							else
+							{
+								kept[t].push_back(obj);
+								handles[t].push_back(pool.tryGetHandle(obj)); //Overlaps with other threads growing the pool
+							}
+						}
+					}
+				);
+			}
+			for (std::thread& t : threads) t.join();
+			pool.flushDeferred();
+
+			//Check: nothing was handed out twice, and values weren't clobbered
+			std::set<size_t*> unique;
+			for (size_t t = 0; t < nThreads; ++t)
+			{
+				for (size_t i = 0; i < kept[t].size(); ++i)
+				{
+					CHECK(*kept[t][i] == t*nPerThread + i*2);
+					CHECK(pool.isAlive(kept[t][i]));
+					CHECK(pool.resolve(handles[t][i]) == kept[t][i]);
+					unique.insert(kept[t][i]);
+				}
+			}
+			CHECK(unique.size() == nThreads*nPerThread/2);
+			CHECK(pool.getNumAllocatedObjects() == nThreads*nPerThread/2);
+
+			//Check: turning it off returns cached slots
+			pool.setThreadSafe(false);
+			CHECK(!pool.isThreadSafe());
+			CHECK(pool.getNumAllocatedObjects() == nThreads*nPerThread/2);
+			size_t nFree = pool.getNumFreeObjects();
+			for (size_t i = 0; i < nFree; ++i) CHECK(unique.count((size_t*)pool.allocate()) == 0);
+		}
+	}
 
 	void* hookedObj = nullptr;
 	void hookTester(void* obj) { hookedObj = obj; }
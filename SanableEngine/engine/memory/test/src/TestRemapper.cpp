@@ -5,8 +5,24 @@
 
 #include "TypedMemoryPool.hpp"
 #include "MemoryMapper.hpp"
+#include "ObjectPatch.hpp"
 #include "MoveTester.hpp"
 
+struct PatchV1
+{
+	int a = 1;
+	int b = 2;
+	int c = 3;
+};
+
+//Reordered, one field dropped and one added
+struct PatchV2
+{
+	int c;
+	int a;
+	double d;
+};
+
 TEST_SUITE("MemoryMapper")
 {
 	TEST_CASE("Minimal")
@@ -23,6 +39,46 @@ TEST_SUITE("MemoryMapper")
 		CHECK(remapper.transformAddress(&x) == &y);
 	}
 
+	TEST_CASE("Chained moves")
+	{
+		//Setup
+		int x = 123;
+		int y;
+		int z;
+
+		//Act
+		MemoryMapper remapper;
+		remapper.move(&y, &x);
+		remapper.move(&z, &y);
+
+		//Check: later moves apply to where earlier ones left things
+		CHECK(remapper.transformAddress(&x) == &z);
+		CHECK(remapper.transformAddress(&y) == &z);
+	}
+
+	TEST_CASE("Many independent moves")
+	{
+		//Setup
+		constexpr size_t nObjs = 1000;
+		int src[nObjs];
+		int dst[nObjs];
+		int untouched;
+
+		//Act: log out of order, so compile has to sort
+		MemoryMapper remapper;
+		for (size_t i = 0; i < nObjs; i += 2) remapper.logMove(&dst[i], &src[i], sizeof(int));
+		for (size_t i = 1; i < nObjs; i += 2) remapper.logMove(&dst[i], &src[i], sizeof(int));
+
+		//Check
+		for (size_t i = 0; i < nObjs; ++i) CHECK(remapper.transformAddress(&src[i]) == &dst[i]);
+		CHECK(remapper.transformAddress(&untouched) == &untouched);
+
+		//Check: logging after a lookup still works
+		int late;
+		remapper.logMove(&late, &untouched, sizeof(int));
+		CHECK(remapper.transformAddress(&untouched) == &late);
+	}
+
 	TEST_CASE("Mapper is null")
 	{
 		//Setup
@@ -154,5 +210,48 @@ TEST_SUITE("MemoryMapper")
 		delete poolBackend;
 	}
 
+	TEST_CASE("ObjectPatch field migration")
+	{
+		//Setup: Two versions of the same type
+		ModuleTypeRegistry m;
+		{
+			TypeBuilder b = TypeBuilder::create<PatchV1>();
+			b.addField<int>("a", [](const void*) { return ptrdiff_t(offsetof(PatchV1, a)); });
+			b.addField<int>("b", [](const void*) { return ptrdiff_t(offsetof(PatchV1, b)); });
+			b.addField<int>("c", [](const void*) { return ptrdiff_t(offsetof(PatchV1, c)); });
+			b.registerType(&m);
+		}
+		{
+			TypeBuilder b = TypeBuilder::create<PatchV2>();
+			b.addField<int   >("c", [](const void*) { return ptrdiff_t(offsetof(PatchV2, c)); });
+			b.addField<int   >("a", [](const void*) { return ptrdiff_t(offsetof(PatchV2, a)); });
+			b.addField<double>("d", [](const void*) { return ptrdiff_t(offsetof(PatchV2, d)); });
+			b.registerType(&m);
+		}
+		TypeInfo oldType = *m.lookupType(TypeName::create<PatchV1>());
+		TypeInfo newType = *m.lookupType(TypeName::create<PatchV2>());
+		newType.name = oldType.name; //Pretend it's the same type, post-reload
+
+		//Setup: Object in old layout, with room for new layout
+		alignas(PatchV2) char buf[std::max(sizeof(PatchV1), sizeof(PatchV2))];
+		memset(buf, 0xCD, sizeof(buf));
+		PatchV1* before = new (buf) PatchV1();
+		int* oldA = &before->a;
+		int* oldC = &before->c;
+
+		//Act
+		ObjectPatch patch = ObjectPatch::create(oldType, newType);
+		MemoryMapper remapper;
+		patch.apply(buf, &remapper);
 
+		//Check: Values carried over, new field zeroed
+		PatchV2* after = (PatchV2*)buf;
+		CHECK(after->a == 1);
+		CHECK(after->c == 3);
+		CHECK(after->d == 0.0);
+
+		//Check: Pointers to moved fields can follow them
+		CHECK(remapper.transformAddress(oldA) == &after->a);
+		CHECK(remapper.transformAddress(oldC) == &after->c);
+	}
 }
@@ -0,0 +1,121 @@
+#include <doctest/doctest.h>
+
+#include <set>
+
+#include "SizeClassAllocator.hpp"
+#include "MemoryManager.hpp"
+
+struct SmallA { int val = 1; };
+struct SmallB { int val = 2; }; //Same size class as SmallA
+struct SmallC { double vals[5] = { 3 }; };
+struct alignas(64) SmallAligned { char c = 4; };
+
+struct DtorCounter
+{
+	static inline int nDestroyed = 0;
+	~DtorCounter() { ++nDestroyed; }
+};
+
+TEST_SUITE("SizeClassAllocator")
+{
+	TEST_CASE("Allocation")
+	{
+		SizeClassAllocator alloc;
+
+		SUBCASE("Similar types share a class")
+		{
+			SmallA* a = alloc.create<SmallA>();
+			SmallB* b = alloc.create<SmallB>();
+			SmallC* c = alloc.create<SmallC>();
+			REQUIRE(a);
+			REQUIRE(b);
+			REQUIRE(c);
+			CHECK(a->val == 1);
+			CHECK(b->val == 2);
+			CHECK(c->vals[0] == 3);
+			CHECK(alloc.getTypeCount() == 3);
+			CHECK(alloc.getSizeClassCount() == 2);
+
+			//Check: tags
+			CHECK(*alloc.getTypeOf(a) == TypeName::create<SmallA>());
+			CHECK(*alloc.getTypeOf(b) == TypeName::create<SmallB>());
+			CHECK(*alloc.getTypeOf(c) == TypeName::create<SmallC>());
+			int notOurs;
+			CHECK(alloc.getTypeOf(&notOurs) == nullptr);
+		}
+
+		SUBCASE("Alignment")
+		{
+			SmallAligned* objs[10];
+			for (SmallAligned*& o : objs)
+			{
+				o = alloc.create<SmallAligned>();
+				REQUIRE(o);
+				CHECK(uintptr_t(o) % 64 == 0);
+			}
+		}
+
+		SUBCASE("Dtors")
+		{
+			DtorCounter::nDestroyed = 0;
+			{
+				SizeClassAllocator local;
+				DtorCounter* d = local.create<DtorCounter>();
+				local.create<DtorCounter>();
+				local.destroy(d);
+				CHECK(DtorCounter::nDestroyed == 1);
+			}
+			CHECK(DtorCounter::nDestroyed == 2); //Leftovers destroyed at shutdown
+		}
+	}
+
+	TEST_CASE("Per-type iteration")
+	{
+		SizeClassAllocator alloc;
+
+		//Setup: interleave two types in the same class
+		std::set<SmallA*> as;
+		std::set<SmallB*> bs;
+		for (int i = 0; i < 500; ++i)
+		{
+			as.insert(alloc.create<SmallA>());
+			bs.insert(alloc.create<SmallB>());
+		}
+
+		//Act: release some
+		int n = 0;
+		for (auto it = as.begin(); it != as.end(); )
+		{
+			if (n++ % 3 == 0)
+			{
+				alloc.release(*it);
+				it = as.erase(it);
+			}
+			else ++it;
+		}
+
+		//Check: each type only sees its own living objects
+		CHECK(alloc.count<SmallA>() == as.size());
+		CHECK(alloc.count<SmallB>() == bs.size());
+		std::set<SmallA*> seen;
+		alloc.foreach<SmallA>([&](SmallA* a) { CHECK(a->val == 1); seen.insert(a); });
+		CHECK(seen == as);
+		CHECK(alloc.count<SmallC>() == 0);
+
+		//Check: freed slots are reused
+		SmallB* reused = alloc.create<SmallB>();
+		CHECK(*alloc.getTypeOf(reused) == TypeName::create<SmallB>());
+	}
+
+	TEST_CASE("MemoryManager integration")
+	{
+		MemoryManager memory;
+		SmallA* a = memory.createShared<SmallA>();
+		REQUIRE(a);
+		CHECK(memory.getSpecificPool<SmallA>(false) == nullptr); //No pool of its own
+		CHECK(memory.getSizeClasses()->count<SmallA>() == 1);
+
+		memory.destroy(a);
+		CHECK(memory.getSizeClasses()->count<SmallA>() == 0);
+	}
+}
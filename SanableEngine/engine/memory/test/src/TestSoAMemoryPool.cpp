@@ -0,0 +1,182 @@
+#include <doctest/doctest.h>
+
+#include <cstddef>
+#include <cstring>
+
+#include "ModuleTypeRegistry.hpp"
+#include "TypeBuilder.hpp"
+
+#include "SoAMemoryPool.hpp"
+
+struct SoAParticle
+{
+	float x = 0;
+	float y = 0;
+	int id = 0;
+	char tag[12] = {};
+};
+
+static TypeInfo buildParticleType(ModuleTypeRegistry& m)
+{
+	TypeBuilder b = TypeBuilder::create<SoAParticle>();
+	b.addField<float>("x"  , [](const void*) { return ptrdiff_t(offsetof(SoAParticle, x  )); });
+	b.addField<float>("y"  , [](const void*) { return ptrdiff_t(offsetof(SoAParticle, y  )); });
+	b.addField<int  >("id" , [](const void*) { return ptrdiff_t(offsetof(SoAParticle, id )); });
+	b.addField<char[12]>("tag", [](const void*) { return ptrdiff_t(offsetof(SoAParticle, tag)); });
+	b.registerType(&m);
+	return *m.lookupType(TypeName::create<SoAParticle>());
+}
+
+TEST_SUITE("SoAMemoryPool")
+{
+	TEST_CASE("Columns")
+	{
+		ModuleTypeRegistry m;
+		TypeInfo type = buildParticleType(m);
+
+		SUBCASE("Every field split")
+		{
+			SoAMemoryPool pool(type);
+			CHECK(pool.getColumns().size() == 4);
+			for (int i = 0; i < 100; ++i)
+			{
+				SoAParticle p;
+				p.x = (float)i;
+				p.y = (float)-i;
+				p.id = i;
+				pool.insert(&p);
+			}
+
+			//Check: columns are dense and typed
+			SoAMemoryPool::ColumnView<float> xs = pool.getColumn<float>("x");
+			SoAMemoryPool::ColumnView<int> ids = pool.getColumn<int>("id");
+			REQUIRE(xs.isValid());
+			REQUIRE(ids.isValid());
+			CHECK(xs.count == 100);
+			for (int i = 0; i < 100; ++i)
+			{
+				CHECK(xs[i] == (float)i);
+				CHECK(ids[i] == i);
+			}
+			CHECK(!pool.getColumn<float>("nonexistent").isValid());
+
+			//Check: round trip
+			SoAParticle out;
+			pool.gather(42, &out);
+			CHECK(out.x == 42);
+			CHECK(out.y == -42);
+			CHECK(out.id == 42);
+		}
+
+		SUBCASE("Hot fields only")
+		{
+			SoAMemoryPool pool(type, { "x", "y" });
+			REQUIRE(pool.getColumns().size() == 3); //x, y, cold
+			CHECK(pool.getColumns().back().size == sizeof(int) + sizeof(char[12])); //Only cold fields are stored
+			CHECK(pool.getColumn<float>("x").isValid());
+			CHECK(!pool.getColumn<int>("id").isValid());
+
+			SoAParticle p;
+			p.id = 7;
+			strcpy(p.tag, "cold");
+			pool.emplace<SoAParticle>(p);
+
+			//Act: write through column
+			pool.getColumn<float>("y")[0] = 3;
+
+			//Check: hot writes win over stale cold copy, cold fields survive
+			SoAParticle out;
+			pool.gather(0, &out);
+			CHECK(out.y == 3);
+			CHECK(out.id == 7);
+			CHECK(strcmp(out.tag, "cold") == 0);
+		}
+
+		SUBCASE("Cold fields around a hot one")
+		{
+			SoAMemoryPool pool(type, { "y" });
+			REQUIRE(pool.getColumns().size() == 2); //y, cold
+			CHECK(pool.getColumns().back().size == sizeof(float) + sizeof(int) + sizeof(char[12]));
+
+			for (int i = 0; i < 10; ++i)
+			{
+				SoAParticle p;
+				p.x = (float)i;
+				p.y = (float)-i;
+				p.id = i;
+				strcpy(p.tag, "cold");
+				pool.insert(&p);
+			}
+			pool.release(pool.getHandle(2));
+
+			//Check: round trip, including the row moved into the hole
+			SoAParticle out;
+			pool.gather(2, &out);
+			CHECK(out.x == 9);
+			CHECK(out.y == -9);
+			CHECK(out.id == 9);
+			CHECK(strcmp(out.tag, "cold") == 0);
+
+			//Act: overwrite in place
+			out.x = 100;
+			out.id = 200;
+			pool.scatter(2, &out);
+
+			//Check
+			SoAParticle again;
+			pool.gather(2, &again);
+			CHECK(again.x == 100);
+			CHECK(again.y == -9);
+			CHECK(again.id == 200);
+			CHECK(pool.getColumn<float>("y")[2] == -9);
+		}
+	}
+
+	TEST_CASE("Handles")
+	{
+		ModuleTypeRegistry m;
+		SoAMemoryPool pool(buildParticleType(m), {}, 4);
+
+		//Setup: enough to force growth
+		std::vector<SoAMemoryPool::RowHandle> handles;
+		for (int i = 0; i < 10; ++i)
+		{
+			SoAParticle p;
+			p.id = i;
+			handles.push_back(pool.insert(&p));
+		}
+		CHECK(pool.size() == 10);
+		CHECK(pool.getCapacity() >= 10);
+
+		//Act: release from the middle
+		pool.release(handles[3]);
+		pool.release(handles[0]);
+
+		//Check: rows stay dense, and surviving handles follow their rows
+		CHECK(pool.size() == 8);
+		CHECK(!pool.isAlive(handles[3]));
+		CHECK(!pool.isAlive(handles[0]));
+		SoAMemoryPool::ColumnView<int> ids = pool.getColumn<int>("id");
+		for (int i = 0; i < 10; ++i)
+		{
+			if (i == 0 || i == 3) continue;
+			size_t row = pool.resolve(handles[i]);
+			REQUIRE(row != SoAMemoryPool::npos);
+			CHECK(ids[row] == i);
+		}
+
+		//Check: reused rows don't revive old handles
+		SoAParticle p;
+		SoAMemoryPool::RowHandle fresh = pool.insert(&p);
+		CHECK(pool.isAlive(fresh));
+		CHECK(!pool.isAlive(handles[3]));
+		CHECK(!pool.isAlive(handles[0]));
+		CHECK(!pool.isAlive(SoAMemoryPool::RowHandle()));
+
+		//Check: clear
+		pool.clear();
+		CHECK(pool.size() == 0);
+		CHECK(!pool.isAlive(fresh));
+		CHECK(!pool.isAlive(handles[9]));
+	}
+}
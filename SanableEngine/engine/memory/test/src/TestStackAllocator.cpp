@@ -0,0 +1,173 @@
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <thread>
+
+#include "StackAllocator.hpp"
+#include "FrameAllocator.hpp"
+#include "HeapCounter.hpp"
+
+TEST_SUITE("StackAllocator")
+{
+	TEST_CASE("Alignment")
+	{
+		StackAllocator stack(256);
+
+		for (size_t align = 1; align <= 256; align *= 2)
+		{
+			stack.allocRaw(1, 1); //Knock cursor off any natural alignment
+			void* p = stack.allocRaw(3, align);
+			CHECK(((uintptr_t)p % align) == 0);
+		}
+
+		struct alignas(64) Wide { char data[64]; };
+		Wide* w = stack.alloc<Wide>(4);
+		CHECK(((uintptr_t)w % 64) == 0);
+	}
+
+	TEST_CASE("Growth")
+	{
+		StackAllocator stack(64);
+
+		SUBCASE("Chaining keeps old allocations valid")
+		{
+			int* ints[100];
+			for (int i = 0; i < 100; ++i)
+			{
+				ints[i] = stack.alloc<int>(4);
+				ints[i][0] = i;
+			}
+			CHECK(stack.getBlockCount() > 1);
+			for (int i = 0; i < 100; ++i) CHECK(ints[i][0] == i);
+		}
+
+		SUBCASE("Oversized allocation")
+		{
+			char* big = stack.alloc<char>(100000);
+			big[99999] = 1;
+			CHECK(stack.getCapacity() >= 100000);
+		}
+
+		SUBCASE("Blocks merge once empty")
+		{
+			for (int i = 0; i < 100; ++i) stack.alloc<int>(4);
+			size_t peak = stack.getHighWaterMark();
+			CHECK(peak >= 100*4*sizeof(int));
+
+			stack.reset();
+			CHECK(stack.getUsed() == 0);
+			CHECK(stack.getBlockCount() == 1);
+			CHECK(stack.getCapacity() >= peak);
+
+			//Same workload again fits in one block
+			for (int i = 0; i < 100; ++i) stack.alloc<int>(4);
+			CHECK(stack.getBlockCount() == 1);
+		}
+	}
+
+	TEST_CASE("Checkpoints")
+	{
+		StackAllocator stack(64);
+
+		stack.alloc<int>(4);
+		StackAllocator::Checkpoint mark = stack.markCheckpoint();
+		size_t usedAtMark = stack.getUsed();
+
+		for (int i = 0; i < 50; ++i) stack.alloc<int>(4); //Spills into further blocks
+		CHECK(stack.getBlockCount() > 1);
+
+		stack.restoreCheckpoint(mark);
+		CHECK(stack.getUsed() == usedAtMark);
+
+		//Spare blocks are reused rather than reallocated
+		size_t blocks = stack.getBlockCount();
+		for (int i = 0; i < 50; ++i) stack.alloc<int>(4);
+		CHECK(stack.getBlockCount() == blocks);
+	}
+
+	TEST_CASE("Memory resource")
+	{
+		StackAllocator stack(64);
+		StackMemoryResource resource(&stack);
+
+		std::pmr::vector<int> vec(&resource);
+		for (int i = 0; i < 1000; ++i) vec.push_back(i);
+		for (int i = 0; i < 1000; ++i) CHECK(vec[i] == i);
+		CHECK(stack.getUsed() >= 1000*sizeof(int));
+	}
+}
+
+TEST_SUITE("FrameAllocator")
+{
+	TEST_CASE("Lifetimes")
+	{
+		FrameAllocator frames(64);
+
+		int* shortLived = frames.thisFrame()->alloc<int>();
+		int* longLived = frames.untilNextFrame()->alloc<int>();
+		CHECK(frames.thisFrame()->getUsed() > 0);
+		StackAllocator* firstTwoFrame = frames.untilNextFrame();
+		*longLived = 123;
+
+		frames.beginFrame();
+		CHECK(frames.thisFrame()->getUsed() == 0); //Single-frame memory freed
+		CHECK(firstTwoFrame->getUsed() > 0); //Last frame's memory still alive
+		CHECK(*longLived == 123);
+		CHECK(frames.untilNextFrame() != firstTwoFrame);
+
+		frames.beginFrame();
+		CHECK(firstTwoFrame->getUsed() == 0); //Now freed
+		CHECK(frames.untilNextFrame() == firstTwoFrame);
+		(void)shortLived;
+	}
+
+	TEST_CASE("Per-thread arenas")
+	{
+		FrameAllocator frames(64);
+		StackAllocator* mainArena = frames.thisFrame();
+		StackAllocator* workerArena = nullptr;
+
+		std::thread worker([&]() {
+			workerArena = frames.thisFrame();
+			for (int i = 0; i < 100; ++i) workerArena->alloc<int>(4);
+			CHECK(frames.thisFrame() == workerArena); //Stable within thread
+		});
+		worker.join();
+
+		CHECK(workerArena != mainArena);
+		CHECK(workerArena->getUsed() > 0);
+		CHECK(mainArena->getUsed() == 0);
+
+		frames.beginFrame(); //Resets every thread's arenas
+		CHECK(workerArena->getUsed() == 0);
+		CHECK(frames.getHighWaterMark() >= 100*4*sizeof(int));
+	}
+
+	TEST_CASE("Steady state doesn't touch heap")
+	{
+		if (!HeapCounter::isAvailable()) return;
+
+		size_t before = HeapCounter::getAllocCount();
+		int* canary = new int(1);
+		CHECK(HeapCounter::getAllocCount() == before+1);
+		delete canary;
+
+		FrameAllocator frames(64);
+		auto frame = [&](size_t nAllocs)
+		{
+			frames.beginFrame();
+			for (size_t i = 0; i < nAllocs; ++i)
+			{
+				frames.thisFrame()->alloc<int>(4);
+				frames.untilNextFrame()->alloc<double>(2);
+			}
+		};
+
+		//Warm up: arenas grow to fit, then merge next time they're reset. Double buffered arenas are only reset every other frame.
+		for (int i = 0; i < 4; ++i) frame(500);
+
+		before = HeapCounter::getAllocCount();
+		for (int i = 0; i < 10; ++i) frame(500);
+		CHECK(HeapCounter::getAllocCount() == before);
+	}
+}
@@ -0,0 +1,220 @@
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <thread>
+
+#include "TaskGraph.hpp"
+#include "JobSystem.hpp"
+
+TEST_SUITE("TaskGraph")
+{
+	TEST_CASE("Dependencies respected")
+	{
+		for (size_t nWorkers : { 0, 1, 4 })
+		{
+			JobSystem jobs(nWorkers);
+			TaskGraph graph;
+
+			//Diamond of layers: each task in layer L depends on every task in layer L-1
+			constexpr size_t nLayers = 5;
+			constexpr size_t width = 6;
+			std::vector<std::atomic<int>> runs(nLayers*width);
+			std::atomic<bool> ordered = true;
+
+			std::vector<TaskGraph::id_t> prevLayer;
+			for (size_t layer = 0; layer < nLayers; ++layer)
+			{
+				std::vector<TaskGraph::id_t> thisLayer;
+				for (size_t i = 0; i < width; ++i)
+				{
+					size_t index = layer*width + i;
+					std::vector<TaskGraph::id_t> deps = prevLayer;
+					TaskGraph::id_t id = graph.add("task"+std::to_string(index), [&, index, deps]() {
+						for (TaskGraph::id_t d : deps) if (runs[d] == 0) ordered = false;
+						runs[index]++;
+					}, deps);
+					REQUIRE(id == index);
+					thisLayer.push_back(id);
+				}
+				prevLayer = thisLayer;
+			}
+
+			for (int frame = 0; frame < 3; ++frame) graph.run(&jobs);
+
+			CHECK(ordered);
+			bool allThrice = true;
+			for (std::atomic<int>& r : runs) if (r != 3) allThrice = false;
+			CHECK(allThrice);
+		}
+	}
+
+	TEST_CASE("Independent tasks overlap")
+	{
+		JobSystem jobs(3);
+		TaskGraph graph;
+
+		//Each task waits for the other to arrive. Both only see it if they were running at once.
+		std::atomic<int> arrived = 0;
+		std::atomic<int> met = 0;
+		auto rendezvous = [&]() {
+			arrived++;
+			for (int i = 0; i < 10000000 && arrived < 2; ++i) std::this_thread::yield();
+			if (arrived == 2) met++;
+		};
+		graph.add("a", rendezvous);
+		graph.add("b", rendezvous);
+		graph.run(&jobs);
+		CHECK(met == 2);
+	}
+
+	TEST_CASE("Frame-shaped graph overlaps")
+	{
+		JobSystem jobs(3);
+		TaskGraph graph;
+
+		//Same shape as Application's frame: pinned sync and serial update, then per-pool updates as siblings.
+		//Render queue waits only for the renderable pool's update, and layout waits for nothing.
+		std::atomic<bool> layoutRan = false;
+		std::atomic<bool> serialSawLayout = false;
+		std::atomic<int> poolsArrived = 0;
+		std::atomic<int> poolsMet = 0;
+		std::atomic<bool> renderQueueRan = false;
+		std::atomic<bool> otherPoolSawRenderQueue = false;
+		std::atomic<int> joined = 0;
+
+		auto spinUntil = [](const std::atomic<bool>& flag) {
+			for (int i = 0; i < 10000000 && !flag; ++i) std::this_thread::yield();
+			return flag.load();
+		};
+		auto poolRendezvous = [&]() {
+			poolsArrived++;
+			for (int i = 0; i < 10000000 && poolsArrived < 2; ++i) std::this_thread::yield();
+			if (poolsArrived == 2) poolsMet++;
+		};
+
+		TaskGraph::id_t sync = graph.add("sync", []() {});
+		TaskGraph::id_t serial = graph.add("serialUpdate", [&]() { serialSawLayout = spinUntil(layoutRan); }, { sync });
+		TaskGraph::id_t renderablePool = graph.add("update/Renderable", poolRendezvous, { serial });
+		TaskGraph::id_t otherPool = graph.add("update/Other", [&]() { poolRendezvous(); otherPoolSawRenderQueue = spinUntil(renderQueueRan); }, { serial });
+		graph.add("update", [&]() { joined++; }, { renderablePool, otherPool });
+		graph.add("buildRenderQueue", [&]() { renderQueueRan = true; }, { serial, renderablePool });
+		graph.add("layoutHUDs", [&]() { layoutRan = true; });
+		graph.setCallingThreadOnly(sync, true);
+		graph.setCallingThreadOnly(serial, true);
+
+		graph.run(&jobs);
+		CHECK(serialSawLayout); //Layout ran alongside pinned work
+		CHECK(poolsMet == 2); //Pool updates ran at the same time
+		CHECK(otherPoolSawRenderQueue); //Render queue didn't wait for unrelated Update
+		CHECK(joined == 1);
+	}
+
+	TEST_CASE("Calling thread helps while waiting")
+	{
+		JobSystem jobs(1);
+		TaskGraph graph;
+
+		//Only one worker, so the rendezvous needs the calling thread to pick up the other task
+		std::atomic<int> arrived = 0;
+		auto rendezvous = [&]() {
+			arrived++;
+			for (int i = 0; i < 10000000 && arrived < 2; ++i) std::this_thread::yield();
+		};
+		graph.add("a", rendezvous);
+		graph.add("b", rendezvous);
+		graph.run(&jobs);
+		CHECK(arrived == 2);
+
+		//Pinned task mustn't be stuck behind unpinned work that the calling thread picked up
+		std::atomic<bool> pinnedRan = false;
+		std::atomic<bool> sawPinned = false;
+		graph.clear();
+		graph.add("waits", [&]() {
+			for (int i = 0; i < 10000000 && !pinnedRan; ++i) std::this_thread::yield();
+			sawPinned = pinnedRan.load();
+		});
+		graph.setCallingThreadOnly(graph.add("pinned", [&]() { pinnedRan = true; }), true);
+		graph.run(&jobs);
+		CHECK(sawPinned);
+	}
+
+	TEST_CASE("Calling thread only")
+	{
+		JobSystem jobs(3);
+		TaskGraph graph;
+		std::thread::id caller = std::this_thread::get_id();
+		std::atomic<int> nOffThread = 0;
+		std::atomic<int> nRun = 0;
+
+		//Pinned tasks mixed in at the root, middle and end of the graph
+		std::vector<TaskGraph::id_t> prev;
+		for (int layer = 0; layer < 4; ++layer)
+		{
+			std::vector<TaskGraph::id_t> cur;
+			for (int i = 0; i < 4; ++i)
+			{
+				bool pinned = (i == layer);
+				TaskGraph::id_t id = graph.add(std::to_string(layer)+"_"+std::to_string(i), [&, pinned]() {
+					if (pinned && std::this_thread::get_id() != caller) nOffThread++;
+					nRun++;
+				}, prev);
+				graph.setCallingThreadOnly(id, pinned);
+				cur.push_back(id);
+			}
+			prev = cur;
+		}
+
+		for (int frame = 0; frame < 20; ++frame) graph.run(&jobs);
+		CHECK(nRun == 16*20);
+		CHECK(nOffThread == 0);
+	}
+
+	TEST_CASE("Nested parallelFor")
+	{
+		JobSystem jobs(3);
+		TaskGraph graph;
+		std::atomic<size_t> total = 0;
+		TaskGraph::id_t a = graph.add("a", [&]() { jobs.parallelFor(100, [&](size_t) { total++; }); });
+		graph.add("b", [&]() { jobs.parallelFor(100, [&](size_t) { total++; }); });
+		graph.add("c", [&]() { CHECK(total >= 100); }, { a });
+		graph.run(&jobs);
+		CHECK(total == 200);
+	}
+
+	TEST_CASE("Editing")
+	{
+		TaskGraph graph;
+		std::vector<std::string> log;
+		TaskGraph::id_t a = graph.add("a", [&]() { log.push_back("a"); });
+		TaskGraph::id_t b = graph.add("b", [&]() { log.push_back("b"); }, { a });
+
+		//Bad adds
+		CHECK(graph.add("a", [&]() {}) == TaskGraph::npos);
+		CHECK(graph.add("x", [&]() {}, { 1234 }) == TaskGraph::npos);
+		CHECK(graph.find("b") == b);
+		CHECK(graph.find("nope") == TaskGraph::npos);
+
+		//Insert before existing task
+		TaskGraph::id_t early = graph.add("early", [&]() { log.push_back("early"); });
+		CHECK(graph.addDependency(a, early));
+		CHECK(!graph.addDependency(early, b)); //Cycle
+		CHECK(!graph.addDependency(a, a));
+
+		graph.run(nullptr);
+		CHECK(log == std::vector<std::string>{ "early", "a", "b" });
+
+		//Removal drops edges, and the id gets reused
+		graph.remove(a);
+		CHECK(graph.getTaskCount() == 2);
+		log.clear();
+		graph.run(nullptr);
+		CHECK(log.size() == 2);
+		CHECK(graph.add("a2", [&]() { log.push_back("a2"); }) == a);
+
+		graph.clear();
+		CHECK(graph.getTaskCount() == 0);
+		graph.run(nullptr);
+	}
+}
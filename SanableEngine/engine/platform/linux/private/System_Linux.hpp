@@ -0,0 +1,46 @@
+#pragma once
+
+#include "System.hpp"
+
+#include <cstdio>
+#include <cstdint>
+
+class Application;
+
+namespace gpr460
+{
+
+	//Console-only backend. Pair with Application::initHeadless to run without a display, ie. on servers or for soak tests.
+	class System_Linux : public System
+	{
+	private:
+		FILE* logFile;
+		const char* logFileName = "GameErrors.txt";
+
+		uint64_t maxFrames; //0 = run until quit
+		uint64_t frameCount;
+
+		friend class ::Application;
+	protected:
+		void Init(Application*) override;
+		void DoMainLoop() override;
+		void Shutdown() override;
+
+	public:
+		System_Linux();
+		~System_Linux();
+
+		void SetTargetFps(float fps); //0 = uncapped
+		void SetMaxFrames(uint64_t count); //0 = run until quit
+		uint64_t GetFrameCount() const;
+
+		void DebugPause() override;
+
+		void ShowError(const std::wstring& message) override;
+		void LogToErrorFile(const std::wstring& message) override;
+
+		std::vector<std::filesystem::path> ListPlugins(std::filesystem::path path) const override;
+		std::filesystem::path GetBaseDir() const override;
+	};
+
+}
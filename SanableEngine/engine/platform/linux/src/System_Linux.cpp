@@ -0,0 +1,162 @@
+#include "System_Linux.hpp"
+
+#include <cassert>
+#include <csignal>
+#include <sstream>
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+#include <unistd.h>
+
+#include "application/Application.hpp"
+
+//Set by SIGINT/SIGTERM, so soak tests can be stopped without skipping shutdown
+static volatile std::sig_atomic_t stopRequested = 0;
+static void requestStop(int) { stopRequested = 1; }
+
+gpr460::System_Linux::System_Linux()
+{
+	logFile = nullptr;
+	maxFrames = 0;
+	frameCount = 0;
+}
+
+gpr460::System_Linux::~System_Linux()
+{
+	assert(!isAlive);
+}
+
+void gpr460::System_Linux::Init(Application* engine)
+{
+	System::Init(engine);
+
+	assert(!isAlive);
+	isAlive = true;
+
+	stopRequested = 0;
+	std::signal(SIGINT , requestStop);
+	std::signal(SIGTERM, requestStop);
+}
+
+void gpr460::System_Linux::DoMainLoop()
+{
+	typedef std::chrono::steady_clock clock;
+
+	frameCount = 0;
+	clock::time_point loopStart = clock::now();
+	clock::time_point nextFrame = loopStart;
+
+	while (true)
+	{
+		engine->frameStep(engine);
+		++frameCount;
+		if (engine->quit || stopRequested || (maxFrames && frameCount >= maxFrames)) break;
+
+		if (targetFps > 0)
+		{
+			//Sleep until an absolute deadline, so oversleeping doesn't drift the tick rate
+			nextFrame += std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+			clock::time_point now = clock::now();
+			if (nextFrame > now) std::this_thread::sleep_until(nextFrame);
+			else nextFrame = now; //Fell behind: don't try to catch up with a burst of frames
+		}
+	}
+
+	double elapsed = std::chrono::duration<double>(clock::now() - loopStart).count();
+	printf("Ran %llu frames in %.2fs (%.1f fps)\n", (unsigned long long)frameCount, elapsed, elapsed > 0 ? frameCount/elapsed : 0);
+}
+
+void gpr460::System_Linux::Shutdown()
+{
+	assert(isAlive);
+	isAlive = false;
+
+	std::signal(SIGINT , SIG_DFL);
+	std::signal(SIGTERM, SIG_DFL);
+
+	if (logFile)
+	{
+		fclose(logFile);
+		logFile = nullptr;
+	}
+}
+
+void gpr460::System_Linux::SetTargetFps(float fps)
+{
+	targetFps = fps;
+}
+
+void gpr460::System_Linux::SetMaxFrames(uint64_t count)
+{
+	maxFrames = count;
+}
+
+uint64_t gpr460::System_Linux::GetFrameCount() const
+{
+	return frameCount;
+}
+
+void gpr460::System_Linux::DebugPause()
+{
+#ifdef _DEBUG
+	//Pause so we can read console, unless running unattended
+	if (!isatty(STDIN_FILENO)) return;
+	printf("\nDEBUG Paused, type any key in console to continue\n");
+	std::cin.get();
+#endif
+}
+
+void gpr460::System_Linux::ShowError(const std::wstring& message)
+{
+	//No message boxes without a display
+	fprintf(stderr, "ERROR: %ls\n", message.c_str());
+}
+
+void gpr460::System_Linux::LogToErrorFile(const std::wstring& message)
+{
+	//Lazy init logfile
+	if (!logFile)
+	{
+		logFile = fopen((GetBaseDir()/logFileName).c_str(), "w");
+		if (!logFile)
+		{
+			fprintf(stderr, "Failed to create error file\n");
+			return;
+		}
+	}
+
+	fprintf(logFile, "%ls", message.c_str());
+	fflush(logFile);
+}
+
+std::vector<std::filesystem::path> gpr460::System_Linux::ListPlugins(std::filesystem::path path) const
+{
+	std::vector<std::filesystem::path> contents;
+
+	if (!std::filesystem::exists(path))
+	{
+		printf("Plugins folder does not exist, creating\n");
+		std::filesystem::create_directory(path);
+	}
+
+	for (const std::filesystem::path& entry : std::filesystem::directory_iterator(path))
+	{
+		if (!std::filesystem::is_directory(entry)) continue;
+
+		std::ostringstream joiner;
+		joiner << entry.filename().string() << PLATFORM_DLL_EXTENSION; //Build .so name
+		contents.push_back(entry / joiner.str());
+	}
+
+	return contents;
+}
+
+std::filesystem::path gpr460::System_Linux::GetBaseDir() const
+{
+	//Directory of host executable, not working directory
+	std::error_code err;
+	std::filesystem::path exe = std::filesystem::read_symlink("/proc/self/exe", err);
+	assert(!err);
+	return exe.parent_path();
+}
@@ -0,0 +1,66 @@
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+
+#include <SDL.h>
+
+#include "application/Application.hpp"
+#include "game/Game.hpp"
+#include "game/GameWindowRenderPipeline.hpp"
+#include "game/GameWindowInputProcessor.hpp"
+#include "System_Linux.hpp"
+
+//Usage: engine-linux [--window] [--fps N] [--frames N] [--check-heap N]
+// --window: open a main window. Otherwise runs headless, without SDL video.
+// --fps: fixed tick rate, or 0 for uncapped (default 60)
+// --frames: stop after N frames (default: run until quit or Ctrl+C)
+// --check-heap: fail if any frame after the first N touches heap. Needs a SANABLE_COUNT_HEAP_ALLOCS build.
+int main(int argc, char* argv[])
+{
+    const int WIDTH = 640;
+    const int HEIGHT = 480;
+
+    gpr460::System_Linux system;
+    Application engine;
+    Game game;
+
+    bool windowed = false;
+    long long heapCheckWarmup = -1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--window")) windowed = true;
+        else if (!strcmp(argv[i], "--fps") && i+1 < argc) system.SetTargetFps((float)atof(argv[++i]));
+        else if (!strcmp(argv[i], "--frames") && i+1 < argc) system.SetMaxFrames(strtoull(argv[++i], nullptr, 10));
+        else if (!strcmp(argv[i], "--check-heap") && i+1 < argc) heapCheckWarmup = atoll(argv[++i]);
+        else
+        {
+            printf("Usage: %s [--window] [--fps N] [--frames N] [--check-heap N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    //Init
+    if (windowed)
+    {
+        GLSettings glSettings;
+        WindowBuilder mainWindow = engine.buildWindow("Sanable Engine", WIDTH, HEIGHT, new GameWindowRenderPipeline(&game));
+        mainWindow.setInputProcessor(new GameWindowInputProcessor(&game));
+        engine.init(&game, glSettings, mainWindow, system, nullptr);
+    }
+    else engine.initHeadless(&game, system, nullptr);
+
+    if (heapCheckWarmup >= 0) engine.expectZeroHeapAllocs((size_t)heapCheckWarmup);
+
+    //Loop
+    engine.doMainLoop();
+    size_t heapCheckFailedFrames = engine.getHeapCheckFailedFrames();
+
+    //Shutdown
+    engine.shutdown();
+    SDL_Quit();
+
+    //Pause so we can read console
+    system.DebugPause();
+
+    return heapCheckFailedFrames == 0 ? 0 : 1;
+}
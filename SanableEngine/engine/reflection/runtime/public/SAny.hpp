@@ -49,8 +49,5 @@ namespace stix
 	};
 
 
-	namespace detail
-	{
-		static inline decltype(auto) _getRepresentedType(const SAnyRef& v) { return v.getType(); }
-	}
+	static inline decltype(auto) _getRepresentedType(const SAnyRef& v) { return v.getType(); } //See TypeName::staticEqualsDynamic_many
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 #include <utility>
 
 #include "dllapi.h"
@@ -46,11 +49,11 @@ public:
 		
 	#pragma region Destructor
 
-	template<bool has_destructor>
+	template<bool has_destructor, int _unused = 0> //Dummy parameter: full specializations aren't allowed at class scope, partial ones are
 	struct _dtor { _dtor() = delete; };
 
-	template<>
-	struct _dtor<true>
+	template<int _unused>
+	struct _dtor<true, _unused>
 	{
 		//C++ forbids getting the address of a dtor, but we can still wrap it
 		inline static void call_dtor(void* obj) { static_cast<const T*>(obj)->~T(); }
@@ -58,14 +61,14 @@ public:
 		constexpr static dtor_t dtor = &call_dtor;
 	};
 
-	template<>
-	struct _dtor<false>
+	template<int _unused>
+	struct _dtor<false, _unused>
 	{
 		//Can't call a dtor that doesn't exist
 		constexpr static dtor_t dtor = nullptr;
 	};
 
-	constexpr static dtor_t dtor = ::thunk_utils<T>::_dtor<std::is_destructible<T>::value>::dtor;
+	constexpr static dtor_t dtor = ::thunk_utils<T>::template _dtor<std::is_destructible<T>::value>::dtor;
 
 	#pragma endregion
 };
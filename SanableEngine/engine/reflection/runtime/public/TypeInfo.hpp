@@ -80,6 +80,19 @@ public:
 		/// <param name="obj">Object to be updated</param>
 		ENGINE_RTTI_API void vptrJam(void* obj) const;
 
+		/// <summary>
+		/// Visit each run of implicitly generated bytes (read: vptrs), with the values vptrJam would write there.
+		/// </summary>
+		/// <param name="visitor">Function to run on every run. Receives offset, size, and values to write.</param>
+		ENGINE_RTTI_API void walkImplicitValues(std::function<void(size_t, size_t, const char*)> visitor) const;
+
+		/// <summary>
+		/// Visit each run of bytes that holds object state, skipping known padding and implicit values (read: vptrs).
+		/// If no class image was captured, the whole object is one run.
+		/// </summary>
+		/// <param name="visitor">Function to run on every run. Receives offset and size.</param>
+		ENGINE_RTTI_API void walkDataRuns(std::function<void(size_t, size_t)> visitor) const;
+
 		/// <summary>
 		/// Cast to a parent. Returns null if no parent found.
 		/// </summary>
@@ -189,6 +202,12 @@ public:
 											bool includeInherited = true,
 											bool makeComplete = true) const;
 
+	/// <summary>
+	/// Check if every ancestor has live type data.
+	/// If not, getParent can miss parents that are only reachable through an unresolved base.
+	/// </summary>
+	ENGINE_RTTI_API bool isParentChainResolved() const;
+
 	/// <summary>
 	/// INTERNAL USE ONLY. Currently used to finalize byteUsage, since we need to be able to look up our parents' fields.
 	/// </summary>
@@ -202,7 +221,7 @@ private:
 
 public:
 	/// <summary>
-	/// INTERNAL USE ONLY by TypeBuilder and TypedMemoryPool.
+	/// INTERNAL USE ONLY by TypeBuilder, TypedMemoryPool and ArchetypeStorage.
 	/// </summary>
 	template<typename TObj>
 	static TypeInfo createDummy()
@@ -94,7 +94,7 @@ public:
 	static bool staticEqualsDynamic_many(It it, const It& end)
 	{
 		return it != end
-			&& staticEqualsDynamic<THead, ignoreIncomplete>(stix::detail::_getRepresentedType(*it))
+			&& staticEqualsDynamic<THead, ignoreIncomplete>(_getRepresentedType(*it))
 			&& staticEqualsDynamic_many<It, ignoreIncomplete, Ts...>(it+1, end);
 	}
 	template<typename It, bool ignoreIncomplete> static bool staticEqualsDynamic_many(It it, const It& end) { return it == end; } //Tail case
@@ -129,10 +129,11 @@ namespace stix::detail
 		static TypeName exec() { return TypeName::incomplete_ref(); }
 	};
 
-
-	static inline decltype(auto) _getRepresentedType(const TypeName& t) { return t; }
 }
 
+//Found by ADL from staticEqualsDynamic_many, so overloads for other types (ie. SAnyRef) can be declared later, next to their type
+static inline decltype(auto) _getRepresentedType(const TypeName& t) { return t; }
+
 
 
 template <>
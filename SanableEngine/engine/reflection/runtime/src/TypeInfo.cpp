@@ -130,6 +130,16 @@ std::optional<ParentInfo> TypeInfo::getParent(const TypeName& name, MemberVisibi
 	return layout.getParent_internal(this->name, name, visibilityFlags, includeInherited, makeComplete);
 }
 
+bool TypeInfo::isParentChainResolved() const
+{
+	for (const ParentInfo& parent : layout.parents)
+	{
+		const TypeInfo* ti = parent.typeName.resolve();
+		if (!ti || !ti->isParentChainResolved()) return false;
+	}
+	return true;
+}
+
 void TypeInfo::Layout::walkFields(std::function<void(const FieldInfo&)> visitor, MemberVisibility visibilityFlags, bool includeInherited) const
 {
 	//Recurse into parents first
@@ -181,6 +191,47 @@ void TypeInfo::Layout::vptrJam(void* obj) const
 	}
 }
 
+void TypeInfo::Layout::walkImplicitValues(std::function<void(size_t, size_t, const char*)> visitor) const
+{
+	if (implicitValues.empty()) return;
+
+	for (size_t i = 0; i < size; )
+	{
+		if (byteUsage[i] == ByteUsage::ImplicitConst)
+		{
+			//Find end of run
+			size_t end = i+1;
+			while (end < size && byteUsage[end] == ByteUsage::ImplicitConst) ++end;
+			visitor(i, end-i, implicitValues.data()+i);
+			i = end;
+		}
+		else ++i;
+	}
+}
+
+void TypeInfo::Layout::walkDataRuns(std::function<void(size_t, size_t)> visitor) const
+{
+	if (implicitValues.empty() || byteUsage.empty())
+	{
+		if (size) visitor(0, size);
+		return;
+	}
+
+	auto isData = [&](size_t i) { return byteUsage[i] == ByteUsage::ExplicitField || byteUsage[i] == ByteUsage::Unknown; };
+	for (size_t i = 0; i < size; )
+	{
+		if (isData(i))
+		{
+			//Find end of run
+			size_t end = i+1;
+			while (end < size && isData(end)) ++end;
+			visitor(i, end-i);
+			i = end;
+		}
+		else ++i;
+	}
+}
+
 void* TypeInfo::Layout::upcast(void* obj, const TypeName& parentTypeName) const
 {
 	std::optional<ParentInfo> parent = getParent_internal(TypeName(), parentTypeName);
@@ -250,7 +301,7 @@ const stix::MemberFunction* TypeInfo::Capabilities::getMemberFunction(const std:
 			}
 		}
 		//Fast exit for looped checks and whatnot, clearer than break keyword
-	noMatch:
+	noMatch:;
 	}
 	return nullptr;
 }
@@ -281,7 +332,7 @@ const stix::StaticFunction* TypeInfo::Capabilities::getStaticFunction(const std:
 			}
 		}
 		//Fast exit for looped checks and whatnot, clearer than break keyword
-	noMatch:
+	noMatch:;
 	}
 	return nullptr;
 }
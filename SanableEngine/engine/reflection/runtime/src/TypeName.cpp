@@ -108,6 +108,11 @@ std::optional<TypeName> TypeName::cvUnwrap() const
 
 std::optional<TypeName> TypeName::dereference() const
 {
+#ifndef _MSC_VER
+    //Itanium ABI names are mangled, and pointers are prefixed with P
+    if (!name.empty() && name[0] == 'P') return TypeName(name.substr(1), flags);
+    return std::nullopt;
+#else
     //FIXME this won't work with function pointers. Too bad!
 
     size_t index = name.find_last_of("*");
@@ -123,6 +128,7 @@ std::optional<TypeName> TypeName::dereference() const
     std::string unwrappedName = name.substr(0, index);
     strip_trailing(unwrappedName, " ");
     return TypeName(unwrappedName, flags);
+#endif
 }
 
 bool TypeName::isValid() const
@@ -8,6 +8,8 @@ elseif(EMSCRIPTEN)
     message(" > Configuring SDL2 for Emscripten")
     add_compile_options("-sUSE_SDL=2")
     add_link_options("-sUSE_SDL=2")
+elseif(UNIX)
+    message(" > Configuring SDL2 for Linux") # Use system package (libsdl2-dev)
 else()
     message(ERROR "-> Could not configure SDL2: Unknown platform")
 endif()
@@ -30,6 +32,16 @@ elseif(EMSCRIPTEN)
     message(" > Configuring SDL2_image for Emscripten")
     add_compile_options("-sUSE_SDL_IMAGE=2 --use-preload-plugins")
     add_link_options("-sUSE_SDL_IMAGE=2 --use-preload-plugins")
+elseif(UNIX)
+    message(" > Configuring SDL2_image for Linux") # Use system package (libsdl2-image-dev)
+    find_package(SDL2_image CONFIG QUIET)
+    if(NOT TARGET SDL2_image::SDL2_image)
+        # Older distro packages only ship a pkg-config file
+        find_package(PkgConfig REQUIRED)
+        pkg_check_modules(SDL2_IMAGE REQUIRED IMPORTED_TARGET SDL2_image)
+        add_library(SDL2_image::SDL2_image INTERFACE IMPORTED)
+        target_link_libraries(SDL2_image::SDL2_image INTERFACE PkgConfig::SDL2_IMAGE)
+    endif()
 else()
     message(ERROR "-> Could not configure SDL2_image: Unknown platform")
 endif()
@@ -117,6 +129,12 @@ elseif(EMSCRIPTEN)
     message(" > Configuring GLEW for Emscripten")
     add_compile_options("-sUSE_GLEW=2 --use-preload-plugins")
     add_link_options("-sUSE_GLEW=2 --use-preload-plugins")
+elseif(UNIX)
+    message(" > Configuring GLEW for Linux") # Use system package (libglew-dev)
+    find_package(GLEW REQUIRED)
+    # Same target name as the Win32 build, so engine targets can link it unconditionally
+    add_library(glew INTERFACE)
+    target_link_libraries(glew INTERFACE GLEW::GLEW)
 else()
     message(ERROR "-> Could not configure GLEW: Unknown platform")
 endif()
@@ -145,8 +163,10 @@ if (SANABLE_DISASSEMBLER STREQUAL "Capstone")
     endforeach()
 
     # Detect our architecture
-    if(${CMAKE_SYSTEM_PROCESSOR} STREQUAL "AMD64")
+    if(${CMAKE_SYSTEM_PROCESSOR} MATCHES "^(AMD64|x86_64|i[3-6]86)$")
         set (TARGET_ARCH_GROUP X86)
+    elseif(${CMAKE_SYSTEM_PROCESSOR} MATCHES "^(aarch64|arm64|ARM64)$")
+        set (TARGET_ARCH_GROUP ARM64)
     else()
         set (TARGET_ARCH_GROUP ${CMAKE_SYSTEM_PROCESSOR})
     endif()